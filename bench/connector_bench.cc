@@ -0,0 +1,560 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      connector_bench.cc
+ * \brief     Loopback benchmark of the connector.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the benchmark run by "make bench". It starts the
+ * loopback stub server of the tests, drives the connector and the
+ * components built on it with several workloads and prints one JSON
+ * object per workload and line on the standard output, so the
+ * results can be collected and compared between revisions.
+ *
+ * Options: --calls N, --latency-ms N (delay added by the server),
+ * --response-bytes N (size of the response bodies), --threads N
+ * (maximum number of producer threads) and --only NAME (run only the
+ * workloads whose name starts with NAME).
+ *
+ * The http1 and http2 workloads run on their own servers and report
+ * the connections these opened; the h2 server ignores
+ * --response-bytes.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <curl/curl.h>
+#include "../src/libopenair/backlog_reader.hh"
+#include "../src/libopenair/curl_service_connector.hh"
+#include "../src/libopenair/outbound_queue.hh"
+#include "../src/libopenair/survey_batcher.hh"
+#include "../src/libopenair/survey_logger.hh"
+#include "../test/stub/http_stub_server.hh"
+#include "../test/stub/http2_stub_server.hh"
+
+namespace {
+    typedef std::chrono::steady_clock clock_type;
+
+    /* Allocations made by the C++ code and by libcurl. */
+    std::atomic<unsigned long long> allocations(0);
+
+    void *counted_malloc(size_t size) {
+        ++allocations;
+        return std::malloc(size);
+    }
+
+    void counted_free(void *pointer) {
+        std::free(pointer);
+    }
+
+    void *counted_realloc(void *pointer, size_t size) {
+        ++allocations;
+        return std::realloc(pointer, size);
+    }
+
+    char *counted_strdup(const char *text) {
+        ++allocations;
+        return strdup(text);
+    }
+
+    void *counted_calloc(size_t count, size_t size) {
+        ++allocations;
+        return std::calloc(count, size);
+    }
+
+    struct BenchOptions {
+        long calls;
+        long latency_ms;
+        std::size_t response_bytes;
+        int threads;
+        std::string only;
+    };
+
+    /* Outcome of a workload, printed as one JSON line. */
+    struct BenchResult {
+        std::string name;
+        int threads;
+        long operations;
+        long errors;
+        double seconds;
+        std::vector<long long> latencies_us;
+        unsigned long long allocations;
+        /* Connections opened by the server, zero when not counted. */
+        long connections;
+    };
+
+    long rss_kb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0) {
+                return std::atol(line.c_str() + 6);
+            }
+        }
+        return 0;
+    }
+
+    long peak_rss_kb() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+    long long percentile(const std::vector<long long>& sorted,
+                         double rank) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        std::size_t index = static_cast<std::size_t>(
+            rank * (sorted.size() - 1) + 0.5);
+        return sorted[index];
+    }
+
+    void print(BenchResult& result, const BenchOptions& options) {
+        std::sort(result.latencies_us.begin(), result.latencies_us.end());
+        double per_second = result.seconds > 0 ?
+            result.operations / result.seconds : 0;
+        std::printf(
+            "{\"bench\":\"%s\",\"threads\":%d,\"operations\":%ld,"
+            "\"errors\":%ld,\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+            "\"p50_us\":%lld,\"p99_us\":%lld,\"p999_us\":%lld,"
+            "\"allocs_per_op\":%.2f,\"rss_kb\":%ld,\"peak_rss_kb\":%ld,"
+            "\"latency_ms\":%ld,\"response_bytes\":%zu,"
+            "\"connections\":%ld}\n",
+            result.name.c_str(), result.threads, result.operations,
+            result.errors, result.seconds, per_second,
+            percentile(result.latencies_us, 0.50),
+            percentile(result.latencies_us, 0.99),
+            percentile(result.latencies_us, 0.999),
+            result.operations > 0 ?
+                static_cast<double>(result.allocations) /
+                result.operations : 0,
+            rss_kb(), peak_rss_kb(), options.latency_ms,
+            options.response_bytes, result.connections);
+        std::fflush(stdout);
+    }
+
+    bool selected(const BenchOptions& options, const std::string& name) {
+        return name.compare(0, options.only.size(), options.only) == 0;
+    }
+
+    long long elapsed_us(clock_type::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            clock_type::now() - start).count();
+    }
+
+    /*
+     * Runs calls split over threads, each call being timed. The call
+     * returns false on failure.
+     */
+    template <typename Call>
+    BenchResult run_calls(const std::string& name, int threads,
+                          long calls, Call call) {
+        BenchResult result = {name, threads, calls, 0, 0,
+                              std::vector<long long>(calls), 0, 0};
+        std::atomic<long> errors(0);
+        auto before = allocations.load();
+        auto start = clock_type::now();
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.push_back(std::thread([&, t]() {
+                for (long i = t; i < calls; i += threads) {
+                    auto begin = clock_type::now();
+                    if (!call()) {
+                        ++errors;
+                    }
+                    result.latencies_us[i] = elapsed_us(begin);
+                }
+            }));
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        result.seconds = elapsed_us(start) / 1e6;
+        result.allocations = allocations.load() - before;
+        result.errors = errors.load();
+        return result;
+    }
+
+    /* Keeps up to window async calls in flight. */
+    BenchResult run_async(const openair::CurlServiceConnector& connector,
+                          long calls, std::size_t window) {
+        BenchResult result = {"post_call_async", 1, calls, 0, 0,
+                              std::vector<long long>(calls), 0, 0};
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::size_t in_flight = 0;
+        long errors = 0;
+        auto before = allocations.load();
+        auto start = clock_type::now();
+        for (long i = 0; i < calls; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return in_flight < window; });
+                ++in_flight;
+            }
+            auto begin = clock_type::now();
+            connector.post_call_async(
+                "send/data", "{\"value\":1}",
+                [&, i, begin](openair::HttpResponse&&,
+                              const char *error) {
+                    result.latencies_us[i] = elapsed_us(begin);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error) {
+                        ++errors;
+                    }
+                    --in_flight;
+                    changed.notify_all();
+                });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return in_flight == 0; });
+        result.seconds = elapsed_us(start) / 1e6;
+        result.allocations = allocations.load() - before;
+        result.errors = errors;
+        return result;
+    }
+
+    BenchResult run_batcher(const openair::CurlServiceConnector& connector,
+                            long records) {
+        BenchResult result = {"survey_batcher", 1, records, 0, 0,
+                              std::vector<long long>(), 0, 0};
+        auto before = allocations.load();
+        auto start = clock_type::now();
+        {
+            openair::SurveyBatcher batcher(connector, "send/data");
+            for (long i = 0; i < records; ++i) {
+                batcher.add("{\"sensor\":\"pm10\",\"value\":12.5}");
+            }
+            batcher.shutdown();
+            result.errors = batcher.failed_batches();
+        }
+        result.seconds = elapsed_us(start) / 1e6;
+        result.allocations = allocations.load() - before;
+        return result;
+    }
+
+    void run_queue(const openair::CurlServiceConnector& connector,
+                   long calls, const BenchOptions& options) {
+        char directory[] = "/tmp/openair_bench_XXXXXX";
+        if (!mkdtemp(directory)) {
+            return;
+        }
+        std::string path = std::string(directory) + "/queue.db";
+        {
+            openair::OutboundQueue queue(path, connector);
+            BenchResult enqueue = {"outbound_queue_enqueue", 1, calls, 0,
+                                   0, std::vector<long long>(calls), 0, 0};
+            auto before = allocations.load();
+            auto start = clock_type::now();
+            for (long i = 0; i < calls; ++i) {
+                auto begin = clock_type::now();
+                queue.enqueue("send/data", "{\"value\":1}");
+                enqueue.latencies_us[i] = elapsed_us(begin);
+            }
+            queue.sync();
+            enqueue.seconds = elapsed_us(start) / 1e6;
+            enqueue.allocations = allocations.load() - before;
+            print(enqueue, options);
+
+            BenchResult drain = {"outbound_queue_drain", 1, calls, 0, 0,
+                                 std::vector<long long>(), 0, 0};
+            before = allocations.load();
+            start = clock_type::now();
+            while (queue.size() > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            drain.seconds = elapsed_us(start) / 1e6;
+            drain.allocations = allocations.load() - before;
+            drain.errors = queue.dropped();
+            print(drain, options);
+        }
+        std::remove(path.c_str());
+        std::remove((path + "-wal").c_str());
+        std::remove((path + "-shm").c_str());
+        rmdir(directory);
+    }
+
+    void run_logger(long rows, int threads, const BenchOptions& options) {
+        char directory[] = "/tmp/openair_bench_XXXXXX";
+        if (!mkdtemp(directory)) {
+            return;
+        }
+        std::string path = std::string(directory) + "/log.db";
+        {
+            openair::SurveyLogger logger(path);
+            BenchResult result = {"survey_logger", threads, rows, 0, 0,
+                                  std::vector<long long>(), 0, 0};
+            auto before = allocations.load();
+            auto start = clock_type::now();
+            std::vector<std::thread> producers;
+            for (int t = 0; t < threads; ++t) {
+                producers.emplace_back([&logger, rows, threads, t]() {
+                    for (long i = t; i < rows; i += threads) {
+                        logger.log_survey(
+                            "{\"sensor\":\"pm10\",\"value\":12.5}");
+                    }
+                });
+            }
+            for (auto& producer : producers) {
+                producer.join();
+            }
+            logger.flush();
+            result.seconds = elapsed_us(start) / 1e6;
+            result.allocations = allocations.load() - before;
+            result.errors = rows - logger.committed();
+            print(result, options);
+        }
+        std::remove(path.c_str());
+        std::remove((path + "-wal").c_str());
+        std::remove((path + "-shm").c_str());
+        rmdir(directory);
+    }
+
+    void run_drain(const openair::CurlServiceConnector& connector,
+                   long records, const BenchOptions& options) {
+        char directory[] = "/tmp/openair_bench_XXXXXX";
+        if (!mkdtemp(directory)) {
+            return;
+        }
+        std::string path = std::string(directory) + "/log.db";
+        {
+            openair::SurveyLogger logger(path);
+            for (long i = 0; i < records; ++i) {
+                logger.log_survey("{\"sensor\":\"pm10\",\"value\":12.5}");
+            }
+        }
+        // Each run has its own method, so it starts from an empty
+        // checkpoint.
+        std::vector<int> runs(1, 1);
+        if (options.threads > 1) {
+            runs.push_back(options.threads);
+        }
+        for (int connections : runs) {
+            openair::BacklogReaderOptions reader_options;
+            reader_options.connections = connections;
+            openair::BacklogReader reader(
+                path, connector, "send/data/" + std::to_string(connections),
+                reader_options);
+            BenchResult result = {"backlog_drain", connections, records,
+                                  0, 0, std::vector<long long>(), 0, 0};
+            auto before = allocations.load();
+            auto start = clock_type::now();
+            result.errors = records - reader.catch_up();
+            result.seconds = elapsed_us(start) / 1e6;
+            result.allocations = allocations.load() - before;
+            print(result, options);
+        }
+        std::remove(path.c_str());
+        std::remove((path + "-wal").c_str());
+        std::remove((path + "-shm").c_str());
+        rmdir(directory);
+    }
+
+    /*
+     * Runs the same concurrent POSTs on HTTP/1.1 and on h2, each on
+     * its own server and connector, counting the connections opened.
+     */
+    void run_http2(long calls, const BenchOptions& options) {
+        openair::CurlConnectorOptions connector_options;
+        connector_options.pool_size = options.threads;
+        const long latency = options.latency_ms;
+        {
+            openair_test::HttpStubServer server(
+                [latency](const openair_test::StubRequest&,
+                          openair_test::StubResponse& response) {
+                    response.delay_ms = latency;
+                });
+            server.record_requests(false);
+            openair::CurlServiceConnector connector(server.address(),
+                                                    connector_options);
+            auto result = run_calls("http1_concurrent", options.threads,
+                                    calls, [&]() {
+                return connector.post_call(
+                    "send/data", "{\"value\":1}").http_code == 200;
+            });
+            result.connections = server.connections();
+            print(result, options);
+        }
+        openair_test::Http2StubServer server(latency);
+        connector_options.http_version = openair::HTTP_VERSION_2;
+        connector_options.ca_file = server.ca_file();
+        openair::CurlServiceConnector connector(server.address(),
+                                                connector_options);
+        auto result = run_calls("http2_concurrent", options.threads,
+                                calls, [&]() {
+            return connector.post_call(
+                "send/data", "{\"value\":1}").http_code == 200;
+        });
+        result.connections = server.connections();
+        print(result, options);
+    }
+
+    BenchOptions parse(int argc, char **argv) {
+        BenchOptions options = {20000, 0, 2, 8, ""};
+        for (int i = 1; i + 1 < argc; i += 2) {
+            std::string name(argv[i]);
+            if (name == "--calls") {
+                options.calls = std::atol(argv[i + 1]);
+            } else if (name == "--latency-ms") {
+                options.latency_ms = std::atol(argv[i + 1]);
+            } else if (name == "--response-bytes") {
+                options.response_bytes = std::atol(argv[i + 1]);
+            } else if (name == "--threads") {
+                options.threads = std::atoi(argv[i + 1]);
+            } else if (name == "--only") {
+                options.only = argv[i + 1];
+            }
+        }
+        return options;
+    }
+}
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    void *pointer = std::malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions options = parse(argc, argv);
+    // Registered before any connector so libcurl allocations are
+    // counted too.
+    curl_global_init_mem(CURL_GLOBAL_DEFAULT, counted_malloc,
+                         counted_free, counted_realloc, counted_strdup,
+                         counted_calloc);
+
+    const std::string body = options.response_bytes <= 2 ?
+        std::string("{}") :
+        "\"" + std::string(options.response_bytes - 2, 'x') + "\"";
+    const long latency = options.latency_ms;
+    openair_test::HttpStubServer server(
+        [&body, latency](const openair_test::StubRequest&,
+                         openair_test::StubResponse& response) {
+            response.body = body;
+            response.delay_ms = latency;
+        });
+    server.record_requests(false);
+
+    openair::CurlConnectorOptions connector_options;
+    connector_options.pool_size = options.threads;
+    openair::CurlServiceConnector connector(server.address(),
+                                            connector_options);
+    const long calls = options.calls;
+
+    if (selected(options, "get_call")) {
+        auto result = run_calls("get_call", 1, calls, [&]() {
+            return connector.get_call("settings", "id=1").http_code == 200;
+        });
+        print(result, options);
+    }
+    if (selected(options, "post_call")) {
+        auto result = run_calls("post_call", 1, calls, [&]() {
+            return connector.post_call(
+                "send/data", "{\"value\":1}").http_code == 200;
+        });
+        print(result, options);
+    }
+    if (selected(options, "prepared_call")) {
+        auto prepared = connector.prepare("send/data");
+        auto result = run_calls("prepared_call", 1, calls, [&]() {
+            return prepared.post("{\"value\":1}").http_code == 200;
+        });
+        print(result, options);
+    }
+    if (selected(options, "post_call_concurrent")) {
+        for (int threads = 2; threads <= options.threads; threads *= 2) {
+            auto result = run_calls("post_call_concurrent", threads,
+                                    calls, [&]() {
+                return connector.post_call(
+                    "send/data", "{\"value\":1}").http_code == 200;
+            });
+            print(result, options);
+        }
+    }
+    if (selected(options, "post_call_async")) {
+        auto result = run_async(connector, calls, 64);
+        print(result, options);
+    }
+    if (selected(options, "post_call_unreachable")) {
+        openair::CurlServiceConnector unreachable("http://127.0.0.1:1");
+        auto result = run_calls("post_call_unreachable", 1, calls / 10,
+                                [&]() {
+            try {
+                unreachable.post_call("send/data", "{}");
+                return true;
+            } catch (const char *) {
+                return false;
+            }
+        });
+        print(result, options);
+    }
+    if (selected(options, "try_post_call_unreachable")) {
+        openair::CurlServiceConnector unreachable("http://127.0.0.1:1");
+        auto result = run_calls("try_post_call_unreachable", 1,
+                                calls / 10, [&]() {
+            return unreachable.try_post_call("send/data", "{}").ok();
+        });
+        print(result, options);
+    }
+    if (selected(options, "http1_concurrent") ||
+        selected(options, "http2_concurrent")) {
+        run_http2(calls, options);
+    }
+    if (selected(options, "survey_batcher")) {
+        auto result = run_batcher(connector, calls * 10);
+        print(result, options);
+    }
+    if (selected(options, "outbound_queue")) {
+        run_queue(connector, calls, options);
+    }
+    if (selected(options, "backlog_drain")) {
+        run_drain(connector, calls * 10, options);
+    }
+    if (selected(options, "survey_logger")) {
+        run_logger(calls * 50, 1, options);
+        run_logger(calls * 50, options.threads, options);
+    }
+    curl_global_cleanup();
+    return 0;
+}
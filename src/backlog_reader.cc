@@ -0,0 +1,259 @@
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "libopenair/backlog_reader.hh"
+#include "log_tables.hh"
+#include "sqlite_support.hh"
+
+namespace __BACKLOG_READER_INTERNAL__ {
+    const char *CREATE_TABLE =
+        "CREATE TABLE IF NOT EXISTS backlog_checkpoint ("
+        " method TEXT PRIMARY KEY,"
+        " last_id INTEGER NOT NULL)";
+
+    const char *LOAD =
+        "SELECT last_id FROM backlog_checkpoint WHERE method = ?1";
+
+    const char *SAVE =
+        "INSERT OR REPLACE INTO backlog_checkpoint (method, last_id)"
+        " VALUES (?1, ?2)";
+
+    // The primary key walks the pages: no OFFSET, so the cost of a
+    // page does not grow with the backlog.
+    const char *SELECT =
+        "SELECT id, record FROM survey_log WHERE id > ?1"
+        " ORDER BY id LIMIT ?2";
+
+    const char *COUNT = "SELECT COUNT(*) FROM survey_log WHERE id > ?1";
+
+    /*
+     * Only a 2xx answer confirms the records are stored: a 3xx is not
+     * followed by the POST calls.
+     */
+    bool accepted(long http_code) {
+        return http_code >= 200 && http_code < 300;
+    }
+}
+
+openair::BacklogReaderOptions::BacklogReaderOptions()
+    : page_records(500),
+      page_bytes(256 * 1024),
+      connections(1) { }
+
+openair::BacklogPage::BacklogPage()
+    : after(0), last(0), records(0) { }
+
+openair::BacklogReader::BacklogReader(
+    const std::string& database_path,
+    const CurlServiceConnector& connector,
+    const std::string& method,
+    const BacklogReaderOptions& options)
+    : _connector(connector),
+      _method(method),
+      _options(options),
+      _db(new SqliteDatabase(database_path)),
+      _checkpoint(0),
+      _position(0) {
+    using namespace __BACKLOG_READER_INTERNAL__;
+    _db->exec(CREATE_LOG_TABLES);
+    _db->exec(CREATE_TABLE);
+    _select.reset(new SqliteStatement(*_db, SELECT));
+    _save.reset(new SqliteStatement(*_db, SAVE));
+    _count.reset(new SqliteStatement(*_db, COUNT));
+    SqliteStatement load(*_db, LOAD);
+    load.bind(1, _method);
+    if (load.step()) {
+        _checkpoint = load.column_int64(0);
+    }
+    _position = _checkpoint;
+}
+
+openair::BacklogReader::~BacklogReader() { }
+
+bool openair::BacklogReader::next(BacklogPage& page) {
+    page.after = _position;
+    page.last = _position;
+    page.records = 0;
+    page.json.assign(1, '[');
+    _select->bind(1, _position);
+    _select->bind(2, static_cast<std::int64_t>(_options.page_records));
+    try {
+        while (_select->step()) {
+            std::string record = _select->column_text(1);
+            if (page.records > 0 &&
+                page.json.size() + record.size() + 2 >
+                _options.page_bytes) {
+                break;
+            }
+            if (page.records > 0) {
+                page.json.push_back(',');
+            }
+            page.json.append(record);
+            page.last = _select->column_int64(0);
+            ++page.records;
+        }
+    } catch (const char *) {
+        _select->reset();
+        throw;
+    }
+    _select->reset();
+    page.json.push_back(']');
+    _position = page.last;
+    return page.records > 0;
+}
+
+void openair::BacklogReader::acknowledge(const BacklogPage& page) {
+    if (page.after != _checkpoint) {
+        throw "The page does not follow the checkpoint";
+    }
+    _save->bind(1, _method);
+    _save->bind(2, page.last);
+    try {
+        _save->step();
+    } catch (const char *) {
+        _save->reset();
+        throw;
+    }
+    _save->reset();
+    _checkpoint = page.last;
+}
+
+void openair::BacklogReader::rewind() {
+    _position = _checkpoint;
+}
+
+std::size_t openair::BacklogReader::catch_up() {
+    if (_options.connections > 1) {
+        return _parallel_catch_up();
+    }
+    std::size_t uploaded = 0;
+    BacklogPage page;
+    rewind();
+    while (next(page)) {
+        try {
+            HttpResponse response =
+                _connector.post_call(_method, page.json);
+            if (!__BACKLOG_READER_INTERNAL__::accepted(
+                    response.http_code)) {
+                break;
+            }
+        } catch (const char *) {
+            break;
+        }
+        acknowledge(page);
+        uploaded += page.records;
+    }
+    rewind();
+    return uploaded;
+}
+
+std::size_t openair::BacklogReader::_parallel_catch_up() {
+    // A page sent by a worker, waiting for the pages before it.
+    struct Slot {
+        BacklogPage page;
+        bool done;
+        bool accepted;
+    };
+    std::mutex mutex;
+    std::condition_variable progress;
+    std::deque<Slot> window;
+    const std::size_t max_window = 4 * _options.connections;
+    std::size_t uploaded = 0;
+    bool stopped = false;
+    const char *error = NULL;
+
+    rewind();
+    auto work = [&]() {
+        // Each worker reuses its page: the memory does not depend on
+        // the size of the backlog.
+        BacklogPage page;
+        for (;;) {
+            Slot *slot = NULL;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                progress.wait(lock, [&]() {
+                    return stopped || window.size() < max_window;
+                });
+                if (stopped) {
+                    return;
+                }
+                try {
+                    if (!next(page)) {
+                        return;
+                    }
+                } catch (const char *message) {
+                    error = message;
+                    stopped = true;
+                    progress.notify_all();
+                    return;
+                }
+                window.push_back(Slot{BacklogPage(), false, false});
+                slot = &window.back();
+                slot->page.after = page.after;
+                slot->page.last = page.last;
+                slot->page.records = page.records;
+            }
+
+            bool accepted = false;
+            try {
+                accepted = __BACKLOG_READER_INTERNAL__::accepted(
+                    _connector.post_call(_method, page.json).http_code);
+            } catch (const char *) {
+                // A curl error fails the page, as a refusal.
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            slot->done = true;
+            slot->accepted = accepted;
+            if (!accepted) {
+                stopped = true;
+            }
+            try {
+                while (!window.empty() && window.front().done &&
+                       window.front().accepted) {
+                    acknowledge(window.front().page);
+                    uploaded += window.front().page.records;
+                    window.pop_front();
+                }
+            } catch (const char *message) {
+                error = message;
+                stopped = true;
+            }
+            progress.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < _options.connections; ++i) {
+        workers.emplace_back(work);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    rewind();
+    if (error) {
+        throw error;
+    }
+    return uploaded;
+}
+
+std::int64_t openair::BacklogReader::checkpoint() const {
+    return _checkpoint;
+}
+
+std::size_t openair::BacklogReader::remaining() {
+    _count->bind(1, _checkpoint);
+    std::size_t count = 0;
+    try {
+        if (_count->step()) {
+            count = _count->column_int64(0);
+        }
+    } catch (const char *) {
+        _count->reset();
+        throw;
+    }
+    _count->reset();
+    return count;
+}
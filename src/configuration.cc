@@ -19,6 +19,19 @@ namespace __CONFIGURATION__INTERNAL__NS__ {
         }
         return result;
     }
+
+    std::vector<std::string> split_list(const std::string& source) {
+        std::vector<std::string> result;
+        std::stringstream stream(source);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            item = trim(item);
+            if (!item.empty()) {
+                result.push_back(item);
+            }
+        }
+        return result;
+    }
 }
 
 std::string openair::get_configuration_file_path() {
@@ -38,8 +51,17 @@ std::ostream& operator<<(std::ostream& os,
     os << openair::DATABASE_PATH_KEY << "="
        << config.database_path << "\n"
        << openair::SERVICE_ADDRESS_KEY << "="
-       << config.service_address << "\n"
-       << openair::VPN_REGISTRATION_METHOD_KEY << "="
+       << config.service_address << "\n";
+    // Printed only when set, so single address files are unchanged.
+    if (!config.service_endpoints.empty()) {
+        os << openair::SERVICE_ENDPOINTS_KEY << "=";
+        for (std::size_t i = 0; i < config.service_endpoints.size();
+             ++i) {
+            os << (i ? "," : "") << config.service_endpoints[i];
+        }
+        os << "\n";
+    }
+    os << openair::VPN_REGISTRATION_METHOD_KEY << "="
        << config.vpn_registration_method << "\n"
        << openair::SEND_DATA_METHOD_KEY << "="
        << config.send_data_method << "\n"
@@ -68,6 +90,9 @@ std::istream& operator>>(std::istream& is,
         } else if (key == openair::SERVICE_ADDRESS_KEY) {
             config.service_address =
                 __CONFIGURATION__INTERNAL__NS__::trim(value);
+        } else if (key == openair::SERVICE_ENDPOINTS_KEY) {
+            config.service_endpoints =
+                __CONFIGURATION__INTERNAL__NS__::split_list(value);
         } else if (
             key == openair::VPN_REGISTRATION_METHOD_KEY) {
             config.vpn_registration_method =
@@ -91,6 +116,7 @@ bool operator==(const openair::ConfigurationData& a,
                 const openair::ConfigurationData& b) {
     return a.database_path == b.database_path &&
         a.service_address == b.service_address &&
+        a.service_endpoints == b.service_endpoints &&
         a.vpn_registration_method == b.vpn_registration_method &&
         a.send_data_method == b.send_data_method &&
         a.send_errors_method == b.send_errors_method;
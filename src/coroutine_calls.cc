@@ -0,0 +1,87 @@
+#include "libopenair/coroutine_calls.hh"
+
+namespace __COROUTINE_CALLS_INTERNAL__ {
+    /* Coroutine owning itself: its frame is freed when it ends. */
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() const noexcept {
+                return Detached();
+            }
+            std::suspend_never initial_suspend() const noexcept {
+                return std::suspend_never();
+            }
+            std::suspend_never final_suspend() const noexcept {
+                return std::suspend_never();
+            }
+            void return_void() const noexcept { }
+            void unhandled_exception() const noexcept {
+                // Only a throwing done handler gets here.
+                std::terminate();
+            }
+        };
+    };
+
+    Detached run(openair::Task<void> task,
+                 std::function<void(std::exception_ptr)> done) {
+        std::exception_ptr error;
+        try {
+            co_await task;
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (done) {
+            done(error);
+        }
+    }
+}
+
+openair::CallAwaiter::CallAwaiter(const CurlServiceConnector& connector,
+                                  std::string method,
+                                  std::string params)
+    : _connector(&connector),
+      _method(std::move(method)),
+      _payload(std::move(params)),
+      _post(false),
+      _error(NULL),
+      _ended(false) { }
+
+openair::CallAwaiter::CallAwaiter(const CurlServiceConnector& connector,
+                                  std::string method,
+                                  std::string json,
+                                  bool post)
+    : _connector(&connector),
+      _method(std::move(method)),
+      _payload(std::move(json)),
+      _post(post),
+      _error(NULL),
+      _ended(false) { }
+
+bool openair::CallAwaiter::await_suspend(std::coroutine_handle<> caller) {
+    _caller = caller;
+    // Only a pointer is captured: the completion needs no allocation.
+    auto completion = [this](HttpResponse&& response, const char *error) {
+        _response.emplace(std::move(response));
+        _error = error;
+        if (_ended.exchange(true)) {
+            _caller.resume();
+        }
+    };
+    if (_post) {
+        _connector->post_call_async(_method, _payload, completion);
+    } else {
+        _connector->get_call_async(_method, _payload, completion);
+    }
+    return !_ended.exchange(true);
+}
+
+openair::HttpResponse openair::CallAwaiter::await_resume() {
+    if (_error) {
+        throw _error;
+    }
+    return std::move(*_response);
+}
+
+void openair::spawn(Task<void> task,
+                    std::function<void(std::exception_ptr)> done) {
+    ::__COROUTINE_CALLS_INTERNAL__::run(std::move(task), std::move(done));
+}
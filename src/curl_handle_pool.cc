@@ -0,0 +1,151 @@
+#include "curl_handle_pool.hh"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace __CURL_HANDLE_POOL_INTERNAL__ {
+    std::once_flag global_init_flag;
+
+    void global_init() {
+        std::call_once(global_init_flag, []() {
+            curl_global_init(CURL_GLOBAL_DEFAULT);
+        });
+    }
+
+    /* Counter used to spread the threads over the shards. */
+    std::atomic<std::size_t> next_thread(0);
+}
+
+openair::CurlHandlePool::Lease::Lease(const CurlHandlePool& pool,
+                                      CURL *handle)
+    : _pool(&pool), _handle(handle) { }
+
+openair::CurlHandlePool::Lease::Lease(Lease&& other)
+    : _pool(other._pool), _handle(other._handle) {
+    other._handle = NULL;
+}
+
+openair::CurlHandlePool::Lease::~Lease() {
+    if (_handle) {
+        _pool->_release(_handle);
+    }
+}
+
+openair::CurlHandlePool::CurlHandlePool(std::size_t pool_size,
+                                        long idle_timeout)
+    : CurlHandlePool(pool_size, idle_timeout, setup_t()) { }
+
+openair::CurlHandlePool::CurlHandlePool(std::size_t pool_size,
+                                        long idle_timeout,
+                                        const setup_t& setup)
+    : _idle_timeout(idle_timeout), _setup(setup) {
+    __CURL_HANDLE_POOL_INTERNAL__::global_init();
+    std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t count = std::min(pool_size, cores);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::unique_ptr<Shard> shard(new Shard());
+        // Spread pool_size over the shards, the first ones take the
+        // remainder.
+        shard->capacity = pool_size / count + (i < pool_size % count);
+        shard->idle.reserve(shard->capacity);
+        _shards.push_back(std::move(shard));
+    }
+}
+
+openair::CurlHandlePool::~CurlHandlePool() {
+    for (auto& shard : _shards) {
+        for (auto& entry : shard->idle) {
+            curl_easy_cleanup(entry.handle);
+        }
+    }
+}
+
+openair::CurlHandlePool::Lease openair::CurlHandlePool::acquire() const {
+    CURL *handle = NULL;
+    std::vector<CURL*> expired;
+    std::size_t home = _home();
+    for (std::size_t i = 0; i < _shards.size() && !handle; ++i) {
+        handle = _take(*_shards[(home + i) % _shards.size()], expired);
+    }
+    for (CURL *stale : expired) {
+        curl_easy_cleanup(stale);
+    }
+    if (handle) {
+        if (_setup) {
+            return Lease(*this, handle);
+        }
+        // Reset clears the options of the previous call but keeps
+        // live connections, DNS cache and TLS session cache.
+        curl_easy_reset(handle);
+        _apply_defaults(handle);
+        return Lease(*this, handle);
+    }
+    handle = curl_easy_init();
+    if (!handle) {
+        throw "Unable to initialize curl handle";
+    }
+    Lease lease(*this, handle);
+    _apply_defaults(handle);
+    if (_setup) {
+        _setup(handle);
+    }
+    return lease;
+}
+
+std::size_t openair::CurlHandlePool::idle() const {
+    std::size_t count = 0;
+    for (auto& shard : _shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        count += shard->idle.size();
+    }
+    return count;
+}
+
+std::size_t openair::CurlHandlePool::_home() const {
+    // Each thread keeps the same home shard for its whole life.
+    thread_local std::size_t thread_index =
+        __CURL_HANDLE_POOL_INTERNAL__::next_thread++;
+    return _shards.empty() ? 0 : thread_index % _shards.size();
+}
+
+CURL *openair::CurlHandlePool::_take(Shard& shard,
+                                     std::vector<CURL*>& expired) const {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto limit = std::chrono::seconds(_idle_timeout);
+    // Entries are ordered by release time: the stale ones are at the
+    // front, the warmest handle is at the back.
+    auto it = shard.idle.begin();
+    while (it != shard.idle.end() && now - it->released > limit) {
+        expired.push_back(it->handle);
+        ++it;
+    }
+    shard.idle.erase(shard.idle.begin(), it);
+    if (shard.idle.empty()) {
+        return NULL;
+    }
+    CURL *handle = shard.idle.back().handle;
+    shard.idle.pop_back();
+    return handle;
+}
+
+void openair::CurlHandlePool::_release(CURL *handle) const {
+    std::size_t home = _home();
+    for (std::size_t i = 0; i < _shards.size(); ++i) {
+        Shard& shard = *_shards[(home + i) % _shards.size()];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.idle.size() < shard.capacity) {
+            shard.idle.push_back({handle,
+                                  std::chrono::steady_clock::now()});
+            return;
+        }
+    }
+    curl_easy_cleanup(handle);
+}
+
+void openair::CurlHandlePool::_apply_defaults(CURL *handle) const {
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_MAXAGE_CONN, _idle_timeout);
+}
@@ -0,0 +1,160 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_handle_pool.hh
+ * \brief     Pool of reusable curl easy handles.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the pool used by the connector to keep curl easy handles,
+ * and so their open connections, DNS and TLS caches, alive between
+ * calls.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <curl/curl.h>
+
+#ifndef CURL_HANDLE_POOL_INCLUDE_GUARD_HH
+#define CURL_HANDLE_POOL_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Pool of curl easy handles.
+    *
+    * Handles are created on demand and given back to the pool when
+    * the call ends. The pool keeps at most pool_size idle handles:
+    * exceeding handles are cleaned up. Idle handles unused for more
+    * than idle_timeout seconds are cleaned up on the next acquire.
+    *
+    * The pool is safe to use from many threads. Idle handles are split
+    * in shards, each one with its own lock: a thread gives back and
+    * takes handles from its home shard, and only visits the other
+    * shards when its own is full or empty, so concurrent callers
+    * rarely wait on the same lock.
+    *
+    * A pool built with a setup function keeps the options of its
+    * handles between the leases: the setup runs once, on each new
+    * handle, and the caller only sets what changes between its calls.
+    */
+    class CurlHandlePool {
+    public:
+        /*! Typedefinition of the setup of a new handle. */
+        typedef std::function<void(CURL *handle)> setup_t;
+
+        /*!
+         * \brief Scoped lease of a pooled handle.
+         *
+         * The handle goes back to the pool when the lease is
+         * destroyed.
+         */
+        class Lease {
+        public:
+            /*!
+             * \brief Constructor with two parameters.
+             * \param pool   - Pool owning the handle.
+             * \param handle - Leased handle.
+             */
+            Lease(const CurlHandlePool& pool, CURL *handle);
+
+            /*! Move constructor. */
+            Lease(Lease&& other);
+
+            /*! Gives back the handle to the pool. */
+            ~Lease();
+
+            /*! \return The leased handle. */
+            CURL *get() const { return _handle; }
+
+        private:
+            Lease(const Lease&);
+            Lease& operator=(const Lease&);
+
+            const CurlHandlePool *_pool;
+            CURL *_handle;
+        };
+
+        /*!
+         * \brief Constructor with two parameters.
+         * \param pool_size    - Maximum number of idle handles kept.
+         * \param idle_timeout - Seconds after which an idle handle,
+         *                       and its connections, are dropped.
+         */
+        CurlHandlePool(std::size_t pool_size, long idle_timeout);
+
+        /*!
+         * \brief Constructor with three parameters.
+         * \param pool_size    - Maximum number of idle handles kept.
+         * \param idle_timeout - Seconds after which an idle handle,
+         *                       and its connections, are dropped.
+         * \param setup        - Applied once to each new handle, whose
+         *                       options are then never reset.
+         */
+        CurlHandlePool(std::size_t pool_size, long idle_timeout,
+                       const setup_t& setup);
+
+        /*! Cleans up every idle handle. */
+        ~CurlHandlePool();
+
+        /*!
+         * \brief Gets a ready to use handle.
+         * \return A lease on a handle reset to the pool defaults, or
+         *         keeping the options of its last lease when the pool
+         *         has a setup function.
+         *
+         * The returned handle keeps its connection cache, DNS cache
+         * and TLS session cache from the previous calls.
+         */
+        Lease acquire() const;
+
+        /*! \return The number of idle handles in the pool. */
+        std::size_t idle() const;
+
+    private:
+        /*! Idle handle with the time it was released. */
+        struct Entry {
+            CURL *handle;
+            std::chrono::steady_clock::time_point released;
+        };
+
+        /*! Idle handles guarded by their own lock. */
+        struct Shard {
+            std::mutex mutex;
+            std::vector<Entry> idle;
+            std::size_t capacity;
+        };
+
+        std::size_t _home() const;
+        CURL *_take(Shard& shard, std::vector<CURL*>& expired) const;
+        void _release(CURL *handle) const;
+        void _apply_defaults(CURL *handle) const;
+
+        CurlHandlePool(const CurlHandlePool&);
+        CurlHandlePool& operator=(const CurlHandlePool&);
+
+        long _idle_timeout;
+        setup_t _setup;
+        std::vector<std::unique_ptr<Shard>> _shards;
+    };
+}
+#endif
@@ -0,0 +1,227 @@
+#include "curl_multi_engine.hh"
+
+openair::CurlTransfer::CurlTransfer(CurlHandlePool::Lease&& lease)
+    : handle(std::move(lease)) {
+    curl_easy_setopt(handle.get(), CURLOPT_PRIVATE, this);
+}
+
+openair::CurlMultiEngine::CurlMultiEngine()
+    : _multi(curl_multi_init()), _event_loop(NULL), _running(true),
+      _in_flight(0), _cancel_requested(false) {
+    _setup();
+    _thread = std::thread(&CurlMultiEngine::_loop, this);
+}
+
+openair::CurlMultiEngine::CurlMultiEngine(EventLoop& loop)
+    : _multi(curl_multi_init()), _event_loop(&loop), _running(true),
+      _in_flight(0), _cancel_requested(false) {
+    _setup();
+    curl_multi_setopt(_multi, CURLMOPT_SOCKETFUNCTION, _socket_callback);
+    curl_multi_setopt(_multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(_multi, CURLMOPT_TIMERFUNCTION, _timer_callback);
+    curl_multi_setopt(_multi, CURLMOPT_TIMERDATA, this);
+}
+
+openair::CurlMultiEngine::~CurlMultiEngine() {
+    _running = false;
+    if (_event_loop) {
+        std::unordered_set<CurlTransfer*> active;
+        active.swap(_active);
+        for (CurlTransfer *transfer : active) {
+            curl_multi_remove_handle(_multi, transfer->handle.get());
+            _finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+        }
+        _event_loop->schedule(*this, -1);
+    } else {
+        curl_multi_wakeup(_multi);
+        _thread.join();
+    }
+    curl_multi_cleanup(_multi);
+}
+
+void openair::CurlMultiEngine::submit(
+    std::unique_ptr<CurlTransfer> transfer) {
+    ++_in_flight;
+    if (_event_loop) {
+        // Already on the loop thread: the handle is added now, and
+        // curl asks the loop for a timer to start the transfer.
+        CurlTransfer *added = transfer.release();
+        if (curl_multi_add_handle(_multi, added->handle.get()) !=
+            CURLM_OK) {
+            _finish(added, CURLE_FAILED_INIT);
+            return;
+        }
+        _active.insert(added);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.push_back(transfer.release());
+    }
+    curl_multi_wakeup(_multi);
+}
+
+std::size_t openair::CurlMultiEngine::in_flight() const {
+    return _in_flight.load();
+}
+
+void openair::CurlMultiEngine::cancel() {
+    if (_event_loop) {
+        _abort_cancelled(_active);
+        return;
+    }
+    _cancel_requested = true;
+    curl_multi_wakeup(_multi);
+}
+
+bool openair::CurlMultiEngine::on_engine_thread() const {
+    return !_event_loop && std::this_thread::get_id() == _thread.get_id();
+}
+
+void openair::CurlMultiEngine::on_socket(int fd, int events) {
+    int flags = 0;
+    if (events & SOCKET_READ) {
+        flags |= CURL_CSELECT_IN;
+    }
+    if (events & SOCKET_WRITE) {
+        flags |= CURL_CSELECT_OUT;
+    }
+    if (events & SOCKET_ERROR) {
+        flags |= CURL_CSELECT_ERR;
+    }
+    int running = 0;
+    curl_multi_socket_action(_multi, fd, flags, &running);
+    _read_done(_active);
+}
+
+void openair::CurlMultiEngine::on_timeout() {
+    int running = 0;
+    curl_multi_socket_action(_multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    _read_done(_active);
+}
+
+void openair::CurlMultiEngine::_setup() {
+    if (!_multi) {
+        throw "Unable to initialize curl multi handle";
+    }
+    // Transfers to the same host share one connection when the
+    // server speaks HTTP/2.
+    curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+}
+
+void openair::CurlMultiEngine::_loop() {
+    std::vector<CurlTransfer*> incoming;
+    std::unordered_set<CurlTransfer*> active;
+    while (_running) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            incoming.swap(_pending);
+        }
+        for (CurlTransfer *transfer : incoming) {
+            if (curl_multi_add_handle(_multi, transfer->handle.get()) !=
+                CURLM_OK) {
+                _finish(transfer, CURLE_FAILED_INIT);
+                continue;
+            }
+            active.insert(transfer);
+        }
+        incoming.clear();
+        if (_cancel_requested.exchange(false)) {
+            _abort_cancelled(active);
+        }
+
+        int running = 0;
+        curl_multi_perform(_multi, &running);
+        _read_done(active);
+        curl_multi_poll(_multi, NULL, 0, 1000, NULL);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        incoming.swap(_pending);
+    }
+    for (CurlTransfer *transfer : active) {
+        curl_multi_remove_handle(_multi, transfer->handle.get());
+        _finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+    }
+    for (CurlTransfer *transfer : incoming) {
+        _finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+void openair::CurlMultiEngine::_read_done(
+    std::unordered_set<CurlTransfer*>& active) {
+    int queued = 0;
+    CURLMsg *message;
+    while ((message = curl_multi_info_read(_multi, &queued))) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        CURL *easy = message->easy_handle;
+        CURLcode result = message->data.result;
+        CurlTransfer *transfer = NULL;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &transfer);
+        curl_multi_remove_handle(_multi, easy);
+        active.erase(transfer);
+        _finish(transfer, result);
+    }
+}
+
+void openair::CurlMultiEngine::_abort_cancelled(
+    std::unordered_set<CurlTransfer*>& active) {
+    // Collected first: a handler may submit a new transfer.
+    std::vector<CurlTransfer*> cancelled;
+    for (auto it = active.begin(); it != active.end(); ) {
+        CurlTransfer *transfer = *it;
+        if (transfer->cancelled && *transfer->cancelled) {
+            curl_multi_remove_handle(_multi, transfer->handle.get());
+            it = active.erase(it);
+            cancelled.push_back(transfer);
+        } else {
+            ++it;
+        }
+    }
+    for (CurlTransfer *transfer : cancelled) {
+        _finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+    }
+}
+
+void openair::CurlMultiEngine::_finish(CurlTransfer *transfer,
+                                       CURLcode result) {
+    std::unique_ptr<CurlTransfer> owned(transfer);
+    if (owned->done) {
+        try {
+            owned->done(*owned, result);
+        } catch (...) {
+            // A failing handler must not stop the engine.
+        }
+    }
+    --_in_flight;
+}
+
+int openair::CurlMultiEngine::_socket_callback(CURL *, curl_socket_t fd,
+                                               int what, void *engine,
+                                               void *) {
+    CurlMultiEngine *self = static_cast<CurlMultiEngine*>(engine);
+    int events = SOCKET_NONE;
+    if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) {
+        events |= SOCKET_READ;
+    }
+    if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) {
+        events |= SOCKET_WRITE;
+    }
+    try {
+        self->_event_loop->watch(*self, fd, events);
+    } catch (const char *) {
+        // Makes curl fail the transfers on this socket.
+        return -1;
+    }
+    return 0;
+}
+
+int openair::CurlMultiEngine::_timer_callback(CURLM *, long timeout_ms,
+                                              void *engine) {
+    CurlMultiEngine *self = static_cast<CurlMultiEngine*>(engine);
+    self->_event_loop->schedule(*self, timeout_ms);
+    return 0;
+}
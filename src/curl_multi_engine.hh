@@ -0,0 +1,180 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_multi_engine.hh
+ * \brief     Background curl_multi event loop.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the engine used by the connector to keep many transfers
+ * in flight from a single background thread.
+ */
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <curl/curl.h>
+#include "curl_handle_pool.hh"
+#include "libopenair/curl_service_connector.hh"
+#include "libopenair/event_loop.hh"
+
+#ifndef CURL_MULTI_ENGINE_INCLUDE_GUARD_HH
+#define CURL_MULTI_ENGINE_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief A transfer handled by the multi engine.
+    *
+    * The transfer owns everything curl reads during the call: the
+    * leased handle, the url and the request body.
+    */
+    struct CurlTransfer {
+        /*! Typedefinition of the completion handler. */
+        typedef std::function<void(CurlTransfer&, CURLcode)> done_t;
+
+        /*! Leased handle, already configured for the call. */
+        CurlHandlePool::Lease handle;
+        /*! Url of the call, referenced by the handle. */
+        std::string url;
+        /*! Request body, referenced by the handle. */
+        std::string body;
+        /*! Encoded request body, referenced by the handle. */
+        std::string encoded;
+        /*! Response filled by the transfer. */
+        HttpResponse response;
+        /*!
+         * Handler called on the engine thread when the transfer
+         * ends, with the curl result of the transfer.
+         */
+        done_t done;
+        /*!
+         * Optional flag: once set, a call to CurlMultiEngine::cancel
+         * aborts the transfer. It can be shared by many transfers.
+         */
+        std::shared_ptr<std::atomic<bool> > cancelled;
+
+        /*!
+         * \brief Constructor with one parameter.
+         * \param lease - Handle used by the transfer.
+         */
+        explicit CurlTransfer(CurlHandlePool::Lease&& lease);
+    };
+
+   /*!
+    * \brief Background curl_multi event loop.
+    *
+    * The engine owns a curl multi handle driven by one thread: all
+    * the submitted transfers are multiplexed on it, so many requests
+    * can be in flight without a thread per request.
+    *
+    * Created on an EventLoop of the application, the engine has no
+    * thread: it hands its sockets and its timer to the loop and
+    * performs the transfers from the loop callbacks. Every method
+    * must then be called on the loop thread.
+    */
+    class CurlMultiEngine : public EventLoopClient {
+    public:
+        /*! Starts the engine thread. */
+        CurlMultiEngine();
+
+        /*!
+         * \brief Constructor with one parameter.
+         * \param loop - Loop driving the engine, that must outlive
+         *               it.
+         */
+        explicit CurlMultiEngine(EventLoop& loop);
+
+        /*!
+         * \brief Stops the engine thread.
+         *
+         * Transfers still in flight are aborted: their handler is
+         * called with CURLE_ABORTED_BY_CALLBACK.
+         */
+        ~CurlMultiEngine();
+
+        /*!
+         * \brief Submits a transfer.
+         * \param transfer - Transfer to perform. The handle must be
+         *                   fully configured.
+         *
+         * The call does not block. With the engine thread, any
+         * thread can submit: the transfer is added to the multi
+         * handle by the engine thread, and its done handler is called
+         * on that thread when the transfer ends. With an event loop
+         * the transfer is added at once: it must be submitted on the
+         * loop thread, where its done handler is called too.
+         */
+        void submit(std::unique_ptr<CurlTransfer> transfer);
+
+        /*! \return The number of transfers submitted and not ended. */
+        std::size_t in_flight() const;
+
+        /*!
+         * \brief Aborts the transfers whose cancelled flag is set.
+         *
+         * The call does not block: the engine thread removes the
+         * transfers and calls their handler with
+         * CURLE_ABORTED_BY_CALLBACK.
+         */
+        void cancel();
+
+        /*!
+         * \return True when called from the engine thread, that is
+         *         from the done handler of a transfer.
+         */
+        bool on_engine_thread() const;
+
+        void on_socket(int fd, int events);
+        void on_timeout();
+
+    private:
+        void _setup();
+        void _loop();
+        void _read_done(std::unordered_set<CurlTransfer*>& active);
+        void _finish(CurlTransfer *transfer, CURLcode result);
+        void _abort_cancelled(std::unordered_set<CurlTransfer*>& active);
+
+        static int _socket_callback(CURL *easy, curl_socket_t fd,
+                                    int what, void *engine,
+                                    void *socket);
+        static int _timer_callback(CURLM *multi, long timeout_ms,
+                                   void *engine);
+
+        CurlMultiEngine(const CurlMultiEngine&);
+        CurlMultiEngine& operator=(const CurlMultiEngine&);
+
+        CURLM *_multi;
+        /*! Loop driving the engine, NULL with the engine thread. */
+        EventLoop *_event_loop;
+        /*! Transfers in the multi handle, with an event loop. */
+        std::unordered_set<CurlTransfer*> _active;
+        std::atomic<bool> _running;
+        std::atomic<std::size_t> _in_flight;
+        std::atomic<bool> _cancel_requested;
+        std::mutex _mutex;
+        std::vector<CurlTransfer*> _pending;
+        std::thread _thread;
+    };
+}
+#endif
@@ -0,0 +1,31 @@
+#include "curl_post_headers.hh"
+
+openair::CurlHeaderList::CurlHeaderList() : _list(NULL) { }
+
+openair::CurlHeaderList::~CurlHeaderList() {
+    curl_slist_free_all(_list);
+}
+
+void openair::CurlHeaderList::append(const std::string& header) {
+    curl_slist *list = curl_slist_append(_list, header.c_str());
+    if (!list) {
+        throw "Unable to append curl header";
+    }
+    _list = list;
+}
+
+openair::CurlPostHeaders::CurlPostHeaders(
+    const std::vector<std::string>& fixed) {
+    CurlHeaderList *lists[] = { &plain, &gzip, &chunked };
+    for (CurlHeaderList *list : lists) {
+        list->append("Content-Type: application/json");
+        // Without a server answering 100-continue, curl would wait a
+        // second before sending big bodies.
+        list->append("Expect:");
+        for (const auto& header : fixed) {
+            list->append(header);
+        }
+    }
+    gzip.append("Content-Encoding: gzip");
+    chunked.append("Transfer-Encoding: chunked");
+}
@@ -0,0 +1,86 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_post_headers.hh
+ * \brief     Header lists of the POST calls, built once.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the header lists handed to curl by the POST calls: they
+ * are built once per connector or prepared call and only read by the
+ * calls, so many threads can use them at the same time.
+ */
+
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+
+#ifndef CURL_POST_HEADERS_INCLUDE_GUARD_HH
+#define CURL_POST_HEADERS_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Owned curl header list.
+    */
+    class CurlHeaderList {
+    public:
+        /*! Constructor of an empty list. */
+        CurlHeaderList();
+
+        /*! Frees the list. */
+        ~CurlHeaderList();
+
+        /*!
+         * \brief Appends a header.
+         * \param header - Header line, without line terminator.
+         *
+         * It throws a const char* if the header can not be added.
+         */
+        void append(const std::string& header);
+
+        /*! \return The list, to be passed to CURLOPT_HTTPHEADER. */
+        curl_slist *get() const { return _list; }
+
+    private:
+        CurlHeaderList(const CurlHeaderList&);
+        CurlHeaderList& operator=(const CurlHeaderList&);
+
+        curl_slist *_list;
+    };
+
+   /*!
+    * \brief Header lists of the POST calls.
+    */
+    struct CurlPostHeaders {
+        /*! Headers of a JSON body sent as it is. */
+        CurlHeaderList plain;
+        /*! Headers of a gzip compressed JSON body. */
+        CurlHeaderList gzip;
+        /*! Headers of a JSON body streamed in chunks. */
+        CurlHeaderList chunked;
+
+        /*!
+         * \brief Constructor with one parameter.
+         * \param fixed - Headers added to every list.
+         */
+        explicit CurlPostHeaders(const std::vector<std::string>& fixed =
+                                     std::vector<std::string>());
+    };
+}
+#endif
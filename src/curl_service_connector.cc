@@ -1,31 +1,27 @@
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <thread>
+#include <strings.h>
+#include <exception>
 #include <sstream>
 #include <curl/curl.h>
 #include "libopenair/curl_service_connector.hh"
+#include "curl_handle_pool.hh"
+#include "curl_multi_engine.hh"
+#include "curl_post_headers.hh"
+#include "curl_share.hh"
+#include "endpoint_set.hh"
+#include "hedge_controller.hh"
+#include "response_cache.hh"
+#include "single_flight.hh"
+#include "gzip_codec.hh"
 
 namespace __CURL_SERVICE_CONNECTOR_INTERNAL__ {
-    class auto_curl {
-    public:
-#ifndef NDEBUG
-        FILE *devnull;
-#endif
-        CURL *ptr;
-        auto_curl() :
-#ifndef NDEBUG
-            devnull(fopen("/dev/null", "w+")),
-#endif
-            ptr(curl_easy_init()) {
-#ifndef NDEBUG
-            curl_easy_setopt(ptr, CURLOPT_WRITEDATA, devnull);
-#endif
-        }
-        ~auto_curl() {
-            curl_easy_cleanup(ptr);
-#ifndef NDEBUG
-            fclose(devnull);
-#endif
-        }
-    };
-    
     static int writer(
         char *data,
         size_t size,
@@ -35,93 +31,1350 @@ namespace __CURL_SERVICE_CONNECTOR_INTERNAL__ {
         return size * nmemb;  
     }
 
-    openair::HttpResponse perform_call(
-        CURL *curl, const std::string& url) {
-        openair::HttpResponse response;
+    /*
+     * Upper bound of the memory reserved from a Content-Length header,
+     * so a wrong header can not make the connector allocate too much.
+     */
+    const std::size_t MAX_RESERVE = 64 * 1024 * 1024;
+
+    /*
+     * Keeps a header line as a lower case name and a trimmed value. A
+     * status line starts a new response (after a redirect or a 100
+     * Continue), so the headers of the previous one are dropped.
+     */
+    void capture_header(const char *data, size_t length,
+                        openair::HttpResponse::http_headers_t& headers) {
+        static const char STATUS[] = "HTTP/";
+        if (length >= sizeof(STATUS) - 1 &&
+            std::strncmp(data, STATUS, sizeof(STATUS) - 1) == 0) {
+            headers.clear();
+            return;
+        }
+        const char *colon =
+            static_cast<const char*>(std::memchr(data, ':', length));
+        if (!colon) {
+            return;
+        }
+        const char *end = data + length;
+        const char *value = colon + 1;
+        while (value < end && (*value == ' ' || *value == '\t')) {
+            ++value;
+        }
+        while (end > value && std::isspace(
+                   static_cast<unsigned char>(end[-1]))) {
+            --end;
+        }
+        headers.emplace_back(std::string(data, colon),
+                             std::string(value, end));
+        std::string& name = headers.back().first;
+        std::transform(name.begin(), name.end(), name.begin(),
+                       [](unsigned char c) {
+                           return static_cast<char>(std::tolower(c));
+                       });
+    }
+
+    /*
+     * Header callback of the buffered calls: when the server sends the
+     * Content-Length, the body is reserved once instead of growing on
+     * each chunk.
+     */
+    size_t header_parser(char *data, size_t size, size_t nitems,
+                         void *userdata) {
+        static const char LENGTH[] = "content-length:";
+        static const char RETRY_AFTER[] = "retry-after:";
+        const size_t length = size * nitems;
+        openair::HttpResponse *response =
+            static_cast<openair::HttpResponse*>(userdata);
+        if (length > sizeof(LENGTH) - 1 &&
+            strncasecmp(data, LENGTH, sizeof(LENGTH) - 1) == 0) {
+            std::size_t expected = std::strtoull(
+                std::string(data + sizeof(LENGTH) - 1,
+                            length - sizeof(LENGTH) + 1).c_str(),
+                NULL, 10);
+            response->http_body.reserve(
+                std::min(expected, MAX_RESERVE));
+        } else if (length > sizeof(RETRY_AFTER) - 1 &&
+                   strncasecmp(data, RETRY_AFTER,
+                               sizeof(RETRY_AFTER) - 1) == 0) {
+            // Either a number of seconds or an http date.
+            std::string value(data + sizeof(RETRY_AFTER) - 1,
+                              length - sizeof(RETRY_AFTER) + 1);
+            char *end = NULL;
+            long seconds = std::strtol(value.c_str(), &end, 10);
+            if (end == value.c_str()) {
+                time_t date = curl_getdate(value.c_str(), NULL);
+                seconds = date < 0 ?
+                    -1 : std::max(0L, static_cast<long>(
+                                          date - std::time(NULL)));
+            }
+            response->retry_after_s = seconds < 0 ? -1 : seconds;
+        }
+        return length;
+    }
+
+    /*
+     * Header callback of the buffered calls keeping the headers: the
+     * parsing above, plus a copy of each header in the response.
+     */
+    size_t header_capturer(char *data, size_t size, size_t nitems,
+                           void *userdata) {
+        const size_t length = header_parser(data, size, nitems, userdata);
+        capture_header(data, length,
+                       static_cast<openair::HttpResponse*>(
+                           userdata)->http_headers);
+        return length;
+    }
+
+    /*
+     * The headers are copied only when asked: otherwise the callback
+     * allocates nothing per header.
+     */
+    void prepare_call(CURL *curl, const std::string& url,
+                      openair::HttpResponse *response,
+                      bool capture_headers) {
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &(response));
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
         curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writer);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, response);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION,
+                         capture_headers ? header_capturer : header_parser);
+    }
 
-        auto res = curl_easy_perform(curl);
-        if(res != CURLE_OK) {
-            throw curl_easy_strerror(res);
+    /* Write state of a body streamed to a sink. */
+    struct sink_body {
+        const openair::CurlServiceConnector::body_sink_t *sink;
+        std::exception_ptr error;
+    };
+
+    size_t write_sink(char *data, size_t size, size_t nmemb,
+                      void *userdata) {
+        sink_body *body = static_cast<sink_body*>(userdata);
+        try {
+            // Returning less than the chunk size aborts the transfer.
+            return (*body->sink)(data, size * nmemb) ? size * nmemb : 0;
+        } catch (...) {
+            body->error = std::current_exception();
+            return 0;
         }
+    }
 
+    long long info_off_t(CURL *curl, CURLINFO info) {
+        curl_off_t value = 0;
+        curl_easy_getinfo(curl, info, &value);
+        return value;
+    }
+
+    /*
+     * Fills the response code and the timing of a completed call. It
+     * only reads counters from the handle: nothing is allocated.
+     */
+    void finish_call(CURL *curl, openair::HttpResponse& response) {
         curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE,
                           &response.http_code);
-        return std::move(response);
+        openair::HttpTiming& timing = response.timing;
+        timing.namelookup_us =
+            info_off_t(curl, CURLINFO_NAMELOOKUP_TIME_T);
+        timing.connect_us = info_off_t(curl, CURLINFO_CONNECT_TIME_T);
+        timing.appconnect_us =
+            info_off_t(curl, CURLINFO_APPCONNECT_TIME_T);
+        timing.pretransfer_us =
+            info_off_t(curl, CURLINFO_PRETRANSFER_TIME_T);
+        timing.starttransfer_us =
+            info_off_t(curl, CURLINFO_STARTTRANSFER_TIME_T);
+        timing.total_us = info_off_t(curl, CURLINFO_TOTAL_TIME_T);
+        timing.bytes_sent = info_off_t(curl, CURLINFO_SIZE_UPLOAD_T);
+        timing.bytes_received =
+            info_off_t(curl, CURLINFO_SIZE_DOWNLOAD_T);
+        long connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        timing.connection_reused = connects == 0;
+        long version = 0;
+        curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &version);
+        switch (version) {
+        case CURL_HTTP_VERSION_1_0:
+            response.http_version = openair::HTTP_VERSION_1_0;
+            break;
+        case CURL_HTTP_VERSION_1_1:
+            response.http_version = openair::HTTP_VERSION_1_1;
+            break;
+        case CURL_HTTP_VERSION_2_0:
+            response.http_version = openair::HTTP_VERSION_2;
+            break;
+        default:
+            response.http_version = openair::HTTP_VERSION_UNKNOWN;
+        }
+    }
+
+    /*
+     * Performs a configured call and, when it succeeds, fills the
+     * response. Without an engine the call runs on the calling
+     * thread; otherwise the handle is moved to the engine, so it can
+     * share a multiplexed connection, and the call waits for its end.
+     */
+    CURLcode perform(openair::CurlHandlePool::Lease& curl,
+                     openair::HttpResponse& response,
+                     openair::CurlMultiEngine *engine) {
+        if (!engine) {
+            auto res = curl_easy_perform(curl.get());
+            if (res == CURLE_OK) {
+                finish_call(curl.get(), response);
+            }
+            return res;
+        }
+        std::promise<CURLcode> ended;
+        std::unique_ptr<openair::CurlTransfer> transfer(
+            new openair::CurlTransfer(std::move(curl)));
+        transfer->done = [&response, &ended](
+            openair::CurlTransfer& transfer, CURLcode result) {
+            if (result == CURLE_OK) {
+                finish_call(transfer.handle.get(), response);
+            }
+            {
+                // Given back before waking the caller: the pool may be
+                // the one of a prepared call, gone once it returns.
+                openair::CurlHandlePool::Lease released(
+                    std::move(transfer.handle));
+            }
+            ended.set_value(result);
+        };
+        auto result = ended.get_future();
+        engine->submit(std::move(transfer));
+        return result.get();
+    }
+
+    openair::CallError classify(CURLcode code) {
+        switch (code) {
+        case CURLE_OK:
+            return openair::CALL_OK;
+        case CURLE_OPERATION_TIMEDOUT:
+            return openair::CALL_TIMEOUT;
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_RESOLVE_PROXY:
+            return openair::CALL_RESOLVE_FAILED;
+        case CURLE_COULDNT_CONNECT:
+            return openair::CALL_CONNECT_FAILED;
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_PEER_FAILED_VERIFICATION:
+        case CURLE_SSL_CERTPROBLEM:
+        case CURLE_SSL_CIPHER:
+        case CURLE_SSL_CACERT_BADFILE:
+        case CURLE_SSL_ISSUER_ERROR:
+            return openair::CALL_TLS_FAILED;
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return openair::CALL_TRANSFER_FAILED;
+        case CURLE_ABORTED_BY_CALLBACK:
+        case CURLE_WRITE_ERROR:
+        case CURLE_READ_ERROR:
+            return openair::CALL_ABORTED;
+        default:
+            return openair::CALL_OTHER_ERROR;
+        }
+    }
+
+    void set_result(openair::CallResult& result, CURLcode code) {
+        result.curl_code = code;
+        result.error = classify(code);
+        result.message =
+            code == CURLE_OK ? NULL : curl_easy_strerror(code);
+    }
+
+    /*
+     * Marks a result as failed before reaching curl, e.g. when no
+     * handle could be created or the body could not be compressed.
+     */
+    void set_failure(openair::CallResult& result, const char *message) {
+        result.curl_code = CURLE_FAILED_INIT;
+        result.error = openair::CALL_OTHER_ERROR;
+        result.message = message;
+    }
+
+    openair::CallResult perform_call(
+        openair::CurlHandlePool::Lease& curl, const std::string& url,
+        openair::CurlMultiEngine *engine, bool capture_headers) {
+        openair::CallResult result;
+        prepare_call(curl.get(), url, &result.response, capture_headers);
+        set_result(result, perform(curl, result.response, engine));
+        return result;
+    }
+
+    /*
+     * Limits an attempt to the time left of the call: both the
+     * connect and the total timeouts are cut to it.
+     */
+    void limit_attempt(CURL *curl,
+                       const openair::CurlConnectorOptions& options,
+                       long left) {
+        if (left <= 0) {
+            return;
+        }
+        if (options.timeout_ms <= 0 || left < options.timeout_ms) {
+            curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, left);
+        }
+        if (options.connect_timeout_ms <= 0 ||
+            left < options.connect_timeout_ms) {
+            curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, left);
+        }
+    }
+
+    bool is_transient(const openair::CallResult& result) {
+        switch (result.error) {
+        case openair::CALL_OK:
+            switch (result.response.http_code) {
+            case 408: case 429: case 500: case 502: case 503: case 504:
+                return true;
+            default:
+                return false;
+            }
+        case openair::CALL_TIMEOUT:
+        case openair::CALL_RESOLVE_FAILED:
+        case openair::CALL_CONNECT_FAILED:
+        case openair::CALL_TRANSFER_FAILED:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /*
+     * True when the call failed before reaching the service: its body
+     * was not read, so even a POST or a streamed call can be sent
+     * again.
+     */
+    bool never_sent(const openair::CallResult& result) {
+        return result.error == openair::CALL_CONNECT_FAILED ||
+            result.error == openair::CALL_RESOLVE_FAILED;
+    }
+
+    /* Full jitter: a random wait up to the exponential backoff. */
+    long backoff_ms(const openair::RetryPolicy& policy, unsigned retry) {
+        double ceiling = policy.initial_backoff_ms;
+        for (unsigned i = 1; i < retry && ceiling < policy.max_backoff_ms;
+             ++i) {
+            ceiling *= policy.multiplier;
+        }
+        ceiling = std::min(ceiling,
+                           static_cast<double>(policy.max_backoff_ms));
+        thread_local std::mt19937 generator(std::random_device{}());
+        std::uniform_real_distribution<double> jitter(0, ceiling);
+        return static_cast<long>(jitter(generator));
+    }
+
+    /*
+     * State shared by the requests of a hedged call and its caller.
+     * Each request fills its own outcome, the first success decides
+     * the call.
+     */
+    struct HedgeRace {
+        std::mutex mutex;
+        std::condition_variable answered;
+        openair::CallResult outcomes[2];
+        /* Requests sent and not ended. */
+        unsigned pending;
+        /* Index of the winning request, -1 while undecided. */
+        int winner;
+        /* Index of the last request that failed. */
+        int failed;
+        /* Set to cancel the requests left. */
+        std::shared_ptr<std::atomic<bool> > cancelled;
+        /*
+         * Response revalidated by the requests: its conditional
+         * headers must live until the last request ends.
+         */
+        std::shared_ptr<const openair::CachedResponse> cached;
+
+        HedgeRace()
+            : pending(0), winner(-1), failed(-1),
+              cancelled(std::make_shared<std::atomic<bool> >(false)) { }
+    };
+
+    /* Adapts a result to the throwing interface. */
+    openair::HttpResponse response_or_throw(openair::CallResult&& result) {
+        if (!result.ok()) {
+            throw result.message;
+        }
+        return std::move(result.response);
+    }
+
+    /*
+     * Builds the done handler of an async transfer: it fills the
+     * response code and gives the outcome to the completion.
+     */
+    openair::CurlTransfer::done_t make_done(
+        const openair::CurlServiceConnector::completion_t& completion) {
+        return [completion](openair::CurlTransfer& transfer,
+                            CURLcode result) {
+            if (result != CURLE_OK) {
+                completion(std::move(transfer.response),
+                           curl_easy_strerror(result));
+                return;
+            }
+            finish_call(transfer.handle.get(), transfer.response);
+            completion(std::move(transfer.response), NULL);
+        };
+    }
+
+    openair::CurlServiceConnector::completion_t make_completion(
+        std::shared_ptr<std::promise<openair::HttpResponse> > promise) {
+        return [promise](openair::HttpResponse&& response,
+                         const char *error) {
+            if (error) {
+                promise->set_exception(std::make_exception_ptr(error));
+            } else {
+                promise->set_value(std::move(response));
+            }
+        };
+    }
+
+    /* Applies the options of the connector to a handle. */
+    void apply_options(CURL *curl,
+                       const openair::CurlConnectorOptions& options) {
+        if (options.accept_encoding) {
+            // An empty string asks for every encoding libcurl can
+            // decode.
+            curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+        }
+        if (options.share_caches) {
+            openair::CurlShare::instance().attach(curl);
+        }
+        if (!options.ca_file.empty()) {
+            curl_easy_setopt(curl, CURLOPT_CAINFO,
+                             options.ca_file.c_str());
+        }
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS,
+                         options.connect_timeout_ms);
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS,
+                         options.timeout_ms);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT,
+                         options.low_speed_limit);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME,
+                         options.low_speed_time);
+        if (options.http_version == openair::HTTP_VERSION_2) {
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                             CURL_HTTP_VERSION_2TLS);
+            // Wait for a connection that may multiplex instead of
+            // opening a new one.
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        }
     }
 
-    void prepare_post_call(CURL *curl) {        
+    /*
+     * Gets a handle from the pool with the options of the connector
+     * applied.
+     */
+    openair::CurlHandlePool::Lease acquire(
+        const openair::CurlHandlePool& pool,
+        const openair::CurlConnectorOptions& options) {
+        auto lease = pool.acquire();
+        apply_options(lease.get(), options);
+        return lease;
+    }
+
+    /*
+     * Gets the handle of an attempt limited to the milliseconds left:
+     * from the pool of the connector, or from the handles of a
+     * prepared call when passed. Those keep the options of the
+     * connector, so only the limits cut by their last attempt are
+     * given back.
+     */
+    openair::CurlHandlePool::Lease acquire_attempt(
+        const openair::CurlHandlePool& pool,
+        const openair::CurlHandlePool *prepared,
+        const openair::CurlConnectorOptions& options,
+        long left) {
+        if (!prepared) {
+            auto lease = acquire(pool, options);
+            limit_attempt(lease.get(), options, left);
+            return lease;
+        }
+        auto lease = prepared->acquire();
+        if (left > 0) {
+            curl_easy_setopt(lease.get(), CURLOPT_CONNECTTIMEOUT_MS,
+                             options.connect_timeout_ms);
+            curl_easy_setopt(lease.get(), CURLOPT_TIMEOUT_MS,
+                             options.timeout_ms);
+            limit_attempt(lease.get(), options, left);
+        }
+        return lease;
+    }
+
+    void prepare_post_call(CURL *curl,
+                           const openair::CurlHeaderList& headers) {
         curl_easy_setopt(curl, CURLOPT_POST, 1);
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers,
-                                    "Content-Type: application/json");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers.get());
     }
 
-    void prepare_post_call(CURL *curl, const std::string& json) {
-        prepare_post_call(curl);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json.c_str());
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, -1L);
+    /*
+     * Prepares a POST call with the body passed, without copying it.
+     * When the options ask for compression and the body is big
+     * enough, the compressed body is stored in buffer, that must live
+     * until the call ends.
+     */
+    void prepare_post_call(CURL *curl,
+                           const openair::CurlConnectorOptions& options,
+                           const openair::CurlPostHeaders& headers,
+                           const char *data,
+                           std::size_t size,
+                           std::string& buffer) {
+        if (options.request_encoding == openair::GZIP_ENCODING &&
+            size >= options.compression_threshold) {
+            openair::gzip_compress(data, size, buffer);
+            data = buffer.data();
+            size = buffer.size();
+            prepare_post_call(curl, headers.gzip);
+        } else {
+            prepare_post_call(curl, headers.plain);
+        }
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                         static_cast<curl_off_t>(size));
+    }
+
+    /* Read state of a body made of many buffers. */
+    struct scatter_body {
+        const std::vector<openair::ConstBuffer> *buffers;
+        std::size_t index;
+        std::size_t offset;
+    };
+
+    size_t read_scatter(char *dest, size_t size, size_t nmemb,
+                        void *userdata) {
+        scatter_body *body = static_cast<scatter_body*>(userdata);
+        size_t capacity = size * nmemb;
+        size_t written = 0;
+        while (written < capacity &&
+               body->index < body->buffers->size()) {
+            const openair::ConstBuffer& current =
+                (*body->buffers)[body->index];
+            size_t chunk = std::min(capacity - written,
+                                    current.size - body->offset);
+            std::memcpy(dest + written, current.data + body->offset,
+                        chunk);
+            written += chunk;
+            body->offset += chunk;
+            if (body->offset == current.size) {
+                ++body->index;
+                body->offset = 0;
+            }
+        }
+        return written;
+    }
+
+    /* Read state of a body pulled from a producer. */
+    struct produced_body {
+        const openair::CurlServiceConnector::body_producer_t *producer;
+        std::exception_ptr error;
+    };
+
+    size_t read_produced(char *dest, size_t size, size_t nmemb,
+                         void *userdata) {
+        produced_body *body = static_cast<produced_body*>(userdata);
+        try {
+            return (*body->producer)(dest, size * nmemb);
+        } catch (...) {
+            // Exceptions can not cross libcurl: keep it for later.
+            body->error = std::current_exception();
+            return CURL_READFUNC_ABORT;
+        }
     }
 }
 
-openair::HttpResponse::HttpResponse() { }
-openair::HttpResponse::HttpResponse(const HttpResponse&& response)
+openair::HttpTiming::HttpTiming()
+    : namelookup_us(0),
+      connect_us(0),
+      appconnect_us(0),
+      pretransfer_us(0),
+      starttransfer_us(0),
+      total_us(0),
+      bytes_sent(0),
+      bytes_received(0),
+      connection_reused(false) { }
+
+openair::HttpResponse::HttpResponse()
+    : http_code(0), http_version(HTTP_VERSION_UNKNOWN), retry_after_s(-1),
+      from_cache(false) { }
+openair::HttpResponse::HttpResponse(HttpResponse&& response)
     : http_code(response.http_code),
-      http_body(std::move(response.http_body)){ }
+      http_body(std::move(response.http_body)),
+      timing(response.timing),
+      http_version(response.http_version),
+      retry_after_s(response.retry_after_s),
+      http_headers(std::move(response.http_headers)),
+      from_cache(response.from_cache) { }
 openair::HttpResponse::~HttpResponse() { }
 
+std::string openair::HttpResponse::header(const std::string& name) const {
+    for (const auto& header : http_headers) {
+        if (header.first == name) {
+            return header.second;
+        }
+    }
+    return std::string();
+}
+
+
+openair::CallResult::CallResult()
+    : curl_code(0), error(CALL_OK), message(NULL), attempts(0) { }
+openair::CallResult::CallResult(CallResult&& result)
+    : curl_code(result.curl_code),
+      error(result.error),
+      message(result.message),
+      response(std::move(result.response)),
+      attempts(result.attempts) { }
+
+openair::RetryPolicy::RetryPolicy()
+    : max_attempts(1),
+      initial_backoff_ms(200),
+      max_backoff_ms(10000),
+      multiplier(2),
+      honor_retry_after(true) { }
+
+openair::HedgingPolicy::HedgingPolicy()
+    : enabled(false),
+      percentile(0.95),
+      min_delay_ms(5),
+      initial_delay_ms(100),
+      max_extra_load(0.05) { }
+
+openair::HedgingStats::HedgingStats()
+    : calls(0),
+      hedges_sent(0),
+      hedges_denied(0),
+      hedges_won(0),
+      delay_ms(0) { }
+
+openair::EndpointPolicy::EndpointPolicy()
+    : ewma_alpha(0.3),
+      max_failures(3),
+      ejection_ms(30000),
+      explore(0.02) { }
+
+openair::EndpointStats::EndpointStats()
+    : latency_ms(0), requests(0), failures(0), healthy(false) { }
+
+openair::CurlConnectorOptions::CurlConnectorOptions()
+    : pool_size(4),
+      idle_timeout(60),
+      request_encoding(IDENTITY_ENCODING),
+      compression_threshold(1024),
+      accept_encoding(true),
+      share_caches(false),
+      http_version(HTTP_VERSION_1_1),
+      ca_file(),
+      connect_timeout_ms(10000),
+      timeout_ms(0),
+      low_speed_limit(1),
+      low_speed_time(60),
+      deadline_ms(0),
+      coalesce_gets(false),
+      capture_headers(false),
+      event_loop(NULL) { }
 
 openair::CurlServiceConnector::CurlServiceConnector(
     const std::string& address)
-    : _address(address)  { }
+    : CurlServiceConnector(address, CurlConnectorOptions()) { }
 
-openair::CurlServiceConnector::~CurlServiceConnector() { }
+openair::CurlServiceConnector::CurlServiceConnector(
+    const std::string& address, const CurlConnectorOptions& options)
+    : _address(address),
+      _options(options),
+      _pool(new CurlHandlePool(options.pool_size,
+                               options.idle_timeout)),
+      _headers(new CurlPostHeaders()),
+      // A hedged call waits on the engine: not on the loop thread.
+      _hedge(options.hedging.enabled && !options.event_loop ?
+             new HedgeController(options.hedging) : NULL),
+      _cache(options.cache.enabled ?
+             new ResponseCache(options.cache) : NULL),
+      _flights(options.coalesce_gets ? new SingleFlight() : NULL) {
+    // The cache reads the validators of the responses.
+    _options.capture_headers = options.capture_headers ||
+                               options.cache.enabled;
+}
+
+openair::CurlServiceConnector::CurlServiceConnector(
+    const std::vector<std::string>& addresses,
+    const CurlConnectorOptions& options)
+    : CurlServiceConnector(addresses.empty() ?
+                           std::string() : addresses.front(),
+                           options) {
+    if (addresses.empty()) {
+        throw "No service address";
+    }
+    if (addresses.size() > 1) {
+        _endpoints.reset(new EndpointSet(addresses, options.endpoints));
+    }
+}
+
+openair::CurlServiceConnector::~CurlServiceConnector() {
+    // The engine leases handles from the pool: stop it first.
+    _engine.reset();
+}
+
+openair::PreparedCall openair::CurlServiceConnector::prepare(
+    const std::string& method,
+    const std::vector<std::string>& headers) const {
+    return PreparedCall(*this, _get_url(method), headers);
+}
+
+const openair::CurlConnectorOptions&
+openair::CurlServiceConnector::options() const {
+    return _options;
+}
+
+openair::HedgingStats openair::CurlServiceConnector::hedging_stats()
+    const {
+    return _hedge ? _hedge->stats() : HedgingStats();
+}
+
+openair::ResponseCacheStats openair::CurlServiceConnector::cache_stats()
+    const {
+    return _cache ? _cache->stats() : ResponseCacheStats();
+}
+
+unsigned long long openair::CurlServiceConnector::coalesced_calls() const {
+    return _flights ? _flights->coalesced() : 0;
+}
+
+std::vector<openair::EndpointStats>
+openair::CurlServiceConnector::endpoint_stats() const {
+    if (_endpoints) {
+        return _endpoints->stats();
+    }
+    std::vector<EndpointStats> stats(1);
+    stats[0].address = _address;
+    stats[0].healthy = true;
+    return stats;
+}
 
 openair::HttpResponse openair::CurlServiceConnector::get_call(
     const std::string& method) const {
-    __CURL_SERVICE_CONNECTOR_INTERNAL__::auto_curl curl;
-    return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
-        curl.ptr,
-        _get_url(method));
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        _get(_get_url(method), _options.deadline_ms));
 }
 
 openair::HttpResponse openair::CurlServiceConnector::get_call(
     const std::string& method, const std::string& params) const {
-    __CURL_SERVICE_CONNECTOR_INTERNAL__::auto_curl curl;
-    return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
-        curl.ptr,
-        _get_url(method, params));
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        _get(_get_url(method, params), _options.deadline_ms));
 }
 
 openair::HttpResponse openair::CurlServiceConnector::post_call(
     const std::string& method) const {
-    __CURL_SERVICE_CONNECTOR_INTERNAL__::auto_curl curl;
-    __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(curl.ptr);
-    return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
-        curl.ptr,
-        _get_url(method));
+    auto curl = __CURL_SERVICE_CONNECTOR_INTERNAL__::acquire(*_pool,
+                                                             _options);
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(
+        curl.get(), _headers->plain);
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
+            curl, _route(_get_url(method)), _sync_engine(),
+            _options.capture_headers));
+}
+
+openair::HttpResponse openair::CurlServiceConnector::post_call(
+    const std::string& method, const std::string& json) const {
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        _post(_get_url(method), *_headers, json.data(), json.size(),
+              _options.deadline_ms));
 }
 
 openair::HttpResponse openair::CurlServiceConnector::post_call(
+    const std::string& method, const char *data, std::size_t size) const {
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        _post(_get_url(method), *_headers, data, size,
+              _options.deadline_ms));
+}
+
+openair::CallResult openair::CurlServiceConnector::try_post_call(
     const std::string& method, const std::string& json) const {
-    __CURL_SERVICE_CONNECTOR_INTERNAL__::auto_curl curl;
-    __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(curl.ptr,
-                                                           json);
-    return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
-        curl.ptr,
-        _get_url(method));
+    return _post(_get_url(method), *_headers, json.data(), json.size(),
+                 _options.deadline_ms);
+}
+
+openair::CallResult openair::CurlServiceConnector::try_post_call(
+    const std::string& method, const char *data, std::size_t size) const {
+    return _post(_get_url(method), *_headers, data, size,
+                 _options.deadline_ms);
+}
+
+openair::CallResult openair::CurlServiceConnector::try_get_call(
+    const std::string& method, const std::string& params) const {
+    return _get(params.empty() ?
+                _get_url(method) : _get_url(method, params),
+                _options.deadline_ms);
+}
+
+openair::CallResult openair::CurlServiceConnector::try_post_call(
+    const std::string& method,
+    const std::string& json,
+    std::chrono::milliseconds deadline) const {
+    return _post(_get_url(method), *_headers, json.data(), json.size(),
+                 deadline.count());
+}
+
+openair::CallResult openair::CurlServiceConnector::try_get_call(
+    const std::string& method,
+    const std::string& params,
+    std::chrono::milliseconds deadline) const {
+    return _get(params.empty() ?
+                _get_url(method) : _get_url(method, params),
+                deadline.count());
+}
+
+openair::HttpResponse openair::CurlServiceConnector::post_call(
+    const std::string& method,
+    const std::vector<ConstBuffer>& buffers) const {
+    curl_off_t size = 0;
+    for (const auto& buffer : buffers) {
+        size += buffer.size;
+    }
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::scatter_body body;
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        _with_retries(_get_url(method), false, false, [&](
+            const std::string& target, long left) {
+        try {
+            auto curl = __CURL_SERVICE_CONNECTOR_INTERNAL__::
+                acquire_attempt(*_pool, NULL, _options, left);
+            // Each attempt sends the buffers from the start.
+            body = __CURL_SERVICE_CONNECTOR_INTERNAL__::scatter_body{
+                &buffers, 0, 0
+            };
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(
+                curl.get(), _headers->plain);
+            curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE_LARGE, size);
+            curl_easy_setopt(
+                curl.get(), CURLOPT_READFUNCTION,
+                __CURL_SERVICE_CONNECTOR_INTERNAL__::read_scatter);
+            curl_easy_setopt(curl.get(), CURLOPT_READDATA, &body);
+            return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
+                curl, target, _sync_engine(), _options.capture_headers);
+        } catch (const char *error) {
+            CallResult result;
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_failure(result,
+                                                             error);
+            return result;
+        }
+    }, _options.deadline_ms));
+}
+
+openair::HttpResponse openair::CurlServiceConnector::post_call(
+    const std::string& method, const body_producer_t& producer) const {
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::produced_body body = {
+        &producer, std::exception_ptr()
+    };
+    // The body can not be produced twice: the call is sent again only
+    // when it never reached the service.
+    auto result = _with_retries(_get_url(method), false, true, [&](
+        const std::string& target, long left) {
+        try {
+            auto curl = __CURL_SERVICE_CONNECTOR_INTERNAL__::
+                acquire_attempt(*_pool, NULL, _options, left);
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(
+                curl.get(), _headers->chunked);
+            curl_easy_setopt(
+                curl.get(), CURLOPT_READFUNCTION,
+                __CURL_SERVICE_CONNECTOR_INTERNAL__::read_produced);
+            curl_easy_setopt(curl.get(), CURLOPT_READDATA, &body);
+            return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
+                curl, target, _sync_engine(), _options.capture_headers);
+        } catch (const char *error) {
+            CallResult result;
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_failure(result,
+                                                             error);
+            return result;
+        }
+    }, _options.deadline_ms);
+    if (body.error) {
+        std::rethrow_exception(body.error);
+    }
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        std::move(result));
+}
+
+openair::HttpResponse openair::CurlServiceConnector::get_call(
+    const std::string& method,
+    const std::string& params,
+    const body_sink_t& sink) const {
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::sink_body body = {
+        &sink, std::exception_ptr()
+    };
+    // The sink may have received a part of the body: the call is sent
+    // again only when it never reached the service.
+    auto result = _with_retries(params.empty() ?
+        _get_url(method) : _get_url(method, params), false, true, [&](
+        const std::string& target, long left) {
+        CallResult result;
+        try {
+            auto curl = __CURL_SERVICE_CONNECTOR_INTERNAL__::
+                acquire_attempt(*_pool, NULL, _options, left);
+            curl_easy_setopt(curl.get(), CURLOPT_URL, target.c_str());
+            curl_easy_setopt(
+                curl.get(), CURLOPT_WRITEFUNCTION,
+                __CURL_SERVICE_CONNECTOR_INTERNAL__::write_sink);
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &body);
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_result(
+                result, __CURL_SERVICE_CONNECTOR_INTERNAL__::perform(
+                    curl, result.response, _sync_engine()));
+        } catch (const char *error) {
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_failure(result,
+                                                             error);
+        }
+        return result;
+    }, _options.deadline_ms);
+    if (body.error) {
+        std::rethrow_exception(body.error);
+    }
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        std::move(result));
+}
+
+openair::HttpResponse openair::CurlServiceConnector::get_call(
+    const std::string& method,
+    const std::string& params,
+    std::ostream& out) const {
+    return get_call(method, params,
+                    [&out](const char *data, std::size_t size) {
+                        out.write(data, size);
+                        return static_cast<bool>(out);
+                    });
+}
+
+openair::CallResult openair::CurlServiceConnector::_get(
+    const std::string& url, long deadline,
+    const CurlHandlePool *handles) const {
+    if (_flights) {
+        return _flights->run(url, deadline,
+                             [this, &url, deadline, handles]() {
+            return _perform_get(url, deadline, handles);
+        });
+    }
+    return _perform_get(url, deadline, handles);
+}
+
+openair::CallResult openair::CurlServiceConnector::_perform_get(
+    const std::string& url, long deadline,
+    const CurlHandlePool *handles) const {
+    std::shared_ptr<const CachedResponse> cached;
+    if (_cache) {
+        cached = _cache->find(url);
+    }
+    CallResult result = _with_retries(url, true, false, [&](
+        const std::string& target, long left) {
+        if (_hedge && !_get_engine().on_engine_thread()) {
+            return _hedged_get(target, cached, left);
+        }
+        try {
+            auto curl = __CURL_SERVICE_CONNECTOR_INTERNAL__::
+                acquire_attempt(*_pool, handles, _options, left);
+            if (handles) {
+                // The handle may have made a POST last time.
+                curl_easy_setopt(curl.get(), CURLOPT_HTTPGET, 1L);
+            }
+            if (cached || handles) {
+                curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER,
+                                 cached ? cached->validators.get() : NULL);
+            }
+            return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
+                curl, target, _sync_engine(), _options.capture_headers);
+        } catch (const char *error) {
+            CallResult result;
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_failure(result,
+                                                             error);
+            return result;
+        }
+    }, deadline);
+    if (_cache && result.ok()) {
+        _cache->update(url, cached, result.response);
+    }
+    return result;
+}
+
+openair::CallResult openair::CurlServiceConnector::_post(
+    const std::string& url,
+    const CurlPostHeaders& headers,
+    const char *data,
+    std::size_t size,
+    long deadline,
+    const CurlHandlePool *handles) const {
+    // Compressed once, whatever the number of attempts.
+    std::string buffer;
+    return _with_retries(url, false, false, [&](
+        const std::string& target, long left) {
+        try {
+            auto curl = __CURL_SERVICE_CONNECTOR_INTERNAL__::
+                acquire_attempt(*_pool, handles, _options, left);
+            if (buffer.empty()) {
+                __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(
+                    curl.get(), _options, headers, data, size, buffer);
+            } else {
+                __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(
+                    curl.get(), headers.gzip);
+                curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS,
+                                 buffer.data());
+                curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDSIZE_LARGE,
+                                 static_cast<curl_off_t>(buffer.size()));
+            }
+            return __CURL_SERVICE_CONNECTOR_INTERNAL__::perform_call(
+                curl, target, _sync_engine(), _options.capture_headers);
+        } catch (const char *error) {
+            CallResult result;
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_failure(result,
+                                                             error);
+            return result;
+        }
+    }, deadline);
+}
+
+template <typename Attempt>
+openair::CallResult openair::CurlServiceConnector::_with_retries(
+    const std::string& url,
+    bool idempotent,
+    bool streamed,
+    const Attempt& attempt,
+    long deadline) const {
+    typedef std::chrono::steady_clock clock;
+    const RetryPolicy& policy = _options.retry;
+    const auto end = clock::now() + std::chrono::milliseconds(deadline);
+    auto left = [&]() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            end - clock::now()).count();
+    };
+    // An attempt always gets at least one millisecond: zero would
+    // mean no limit.
+    auto attempt_limit = [&]() {
+        return deadline > 0 ? std::max(1L, static_cast<long>(left())) : 0;
+    };
+    for (unsigned attempts = 1; ; ++attempts) {
+        CallResult result = _endpoints ?
+            _fail_over(url, idempotent, attempt, attempt_limit) :
+            attempt(url, attempt_limit());
+        result.attempts = attempts;
+        if (attempts >= policy.max_attempts ||
+            !__CURL_SERVICE_CONNECTOR_INTERNAL__::is_transient(result) ||
+            (streamed &&
+             !__CURL_SERVICE_CONNECTOR_INTERNAL__::never_sent(result))) {
+            return result;
+        }
+        long wait = __CURL_SERVICE_CONNECTOR_INTERNAL__::backoff_ms(
+            policy, attempts);
+        if (policy.honor_retry_after &&
+            result.response.retry_after_s >= 0) {
+            wait = std::max(wait, result.response.retry_after_s * 1000);
+        }
+        // Waiting past the deadline would only return a later
+        // failure: give back the last outcome now.
+        if (deadline > 0 && left() <= wait) {
+            return result;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+    }
+}
+
+template <typename Attempt, typename Left>
+openair::CallResult openair::CurlServiceConnector::_fail_over(
+    const std::string& url,
+    bool idempotent,
+    const Attempt& attempt,
+    const Left& left) const {
+    typedef std::chrono::steady_clock clock;
+    EndpointSet::tried_t tried = 0;
+    for (std::size_t remaining = _endpoints->size(); ; --remaining) {
+        const std::size_t index = _endpoints->pick(tried);
+        tried |= EndpointSet::tried_t(1) << index;
+        const auto start = clock::now();
+        CallResult result = attempt(_endpoints->rebase(url, index),
+                                    left());
+        _endpoints->report(
+            index,
+            std::chrono::duration<double, std::milli>(
+                clock::now() - start).count(),
+            result.ok() && result.response.http_code < 500);
+        const bool can_fail_over =
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::never_sent(result) ||
+            (idempotent &&
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::is_transient(result));
+        if (remaining == 1 || !can_fail_over) {
+            return result;
+        }
+    }
+}
+
+std::string openair::CurlServiceConnector::_route(
+    const std::string& url) const {
+    return _endpoints ? _endpoints->rebase(url, _endpoints->pick()) : url;
+}
+
+openair::CallResult openair::CurlServiceConnector::_hedged_get(
+    const std::string& url,
+    const std::shared_ptr<const CachedResponse>& cached,
+    long left) const {
+    typedef std::chrono::steady_clock clock;
+    typedef __CURL_SERVICE_CONNECTOR_INTERNAL__::HedgeRace race_t;
+    const auto start = clock::now();
+    long delay = _hedge->start();
+    auto race = std::make_shared<race_t>();
+    race->cached = cached;
+    CurlMultiEngine *engine = NULL;
+
+    auto send = [&](int index, long limit) {
+        std::unique_ptr<CurlTransfer> transfer(
+            new CurlTransfer(__CURL_SERVICE_CONNECTOR_INTERNAL__::acquire(
+                                 *_pool, _options)));
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::limit_attempt(
+            transfer->handle.get(), _options, limit);
+        if (cached) {
+            curl_easy_setopt(transfer->handle.get(), CURLOPT_HTTPHEADER,
+                             cached->validators.get());
+        }
+        transfer->url = url;
+        CallResult& outcome = race->outcomes[index];
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_call(
+            transfer->handle.get(), transfer->url, &outcome.response,
+            _options.capture_headers);
+        transfer->cancelled = race->cancelled;
+        transfer->done = [race, index](CurlTransfer& transfer,
+                                       CURLcode result) {
+            CallResult& outcome = race->outcomes[index];
+            if (result == CURLE_OK) {
+                __CURL_SERVICE_CONNECTOR_INTERNAL__::finish_call(
+                    transfer.handle.get(), outcome.response);
+            }
+            __CURL_SERVICE_CONNECTOR_INTERNAL__::set_result(outcome,
+                                                            result);
+            std::lock_guard<std::mutex> lock(race->mutex);
+            --race->pending;
+            if (race->winner < 0) {
+                if (outcome.ok()) {
+                    race->winner = index;
+                } else {
+                    race->failed = index;
+                }
+            }
+            race->answered.notify_all();
+        };
+        {
+            std::lock_guard<std::mutex> lock(race->mutex);
+            ++race->pending;
+        }
+        engine->submit(std::move(transfer));
+    };
+
+    try {
+        engine = &_get_engine();
+        send(0, left);
+    } catch (const char *error) {
+        CallResult result;
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::set_failure(result, error);
+        return result;
+    }
+
+    std::unique_lock<std::mutex> lock(race->mutex);
+    auto ended = [&race]() {
+        return race->winner >= 0 || race->pending == 0;
+    };
+    if (!race->answered.wait_for(lock, std::chrono::milliseconds(delay),
+                                 ended) &&
+        _hedge->try_hedge()) {
+        lock.unlock();
+        // The hedge only gets the time left to the primary request.
+        long limit = left;
+        if (left > 0) {
+            limit = std::max(1L, left - delay);
+        }
+        try {
+            send(1, limit);
+        } catch (const char *) {
+            // No handle for the hedge: the primary request goes on.
+        }
+        lock.lock();
+    }
+    race->answered.wait(lock, ended);
+
+    const int winner = race->winner;
+    const int index = winner >= 0 ? winner : race->failed;
+    if (race->pending > 0) {
+        *race->cancelled = true;
+        engine->cancel();
+    }
+    lock.unlock();
+    _hedge->finish(
+        std::chrono::duration<double, std::milli>(
+            clock::now() - start).count(),
+        winner == 1);
+    return std::move(race->outcomes[index]);
 }
 
 std::string openair::CurlServiceConnector::_get_url(
     const std::string& method) const {
-    return _address + "/" + method;
+    // Sized once: the url is built without intermediate strings.
+    std::string url;
+    url.reserve(_address.size() + 1 + method.size());
+    url.append(_address).append(1, '/').append(method);
+    return url;
 }
 
 std::string openair::CurlServiceConnector::_get_url(
     const std::string& method,
     const std::string& params) const {
-    return _address + "/" + method + "?" + params; 
+    std::string url;
+    url.reserve(_address.size() + 2 + method.size() + params.size());
+    url.append(_address).append(1, '/').append(method)
+        .append(1, '?').append(params);
+    return url;
+}
+
+openair::PreparedCall::PreparedCall(
+    const CurlServiceConnector& connector,
+    const std::string& url,
+    const std::vector<std::string>& headers)
+    : _connector(&connector),
+      _url(url),
+      _headers(new CurlPostHeaders(headers)),
+      _handles(new CurlHandlePool(
+          connector._options.pool_size, connector._options.idle_timeout,
+          [&connector](CURL *handle) {
+              __CURL_SERVICE_CONNECTOR_INTERNAL__::apply_options(
+                  handle, connector._options);
+          })) { }
+
+openair::PreparedCall::PreparedCall(PreparedCall&& other)
+    : _connector(other._connector),
+      _url(std::move(other._url)),
+      _headers(std::move(other._headers)),
+      _handles(std::move(other._handles)) { }
+
+openair::PreparedCall::~PreparedCall() { }
+
+openair::HttpResponse openair::PreparedCall::post(
+    const std::string& json) const {
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        try_post(json));
+}
+
+openair::HttpResponse openair::PreparedCall::post(
+    const char *data, std::size_t size) const {
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        try_post(data, size));
+}
+
+openair::HttpResponse openair::PreparedCall::get() const {
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        try_get());
+}
+
+openair::HttpResponse openair::PreparedCall::get(
+    const std::string& params) const {
+    return __CURL_SERVICE_CONNECTOR_INTERNAL__::response_or_throw(
+        try_get(params));
+}
+
+openair::CallResult openair::PreparedCall::try_post(
+    const std::string& json) const {
+    return _connector->_post(_url, *_headers, json.data(), json.size(),
+                             _connector->_options.deadline_ms,
+                             _handles.get());
+}
+
+openair::CallResult openair::PreparedCall::try_post(
+    const char *data, std::size_t size) const {
+    return _connector->_post(_url, *_headers, data, size,
+                             _connector->_options.deadline_ms,
+                             _handles.get());
+}
+
+openair::CallResult openair::PreparedCall::try_get(
+    const std::string& params) const {
+    if (params.empty()) {
+        return _connector->_get(_url, _connector->_options.deadline_ms,
+                                _handles.get());
+    }
+    std::string url;
+    url.reserve(_url.size() + 1 + params.size());
+    url.append(_url).append(1, '?').append(params);
+    return _connector->_get(url, _connector->_options.deadline_ms,
+                            _handles.get());
+}
+
+std::future<openair::HttpResponse>
+openair::CurlServiceConnector::get_call_async(
+    const std::string& method, const std::string& params) const {
+    auto promise = std::make_shared<std::promise<HttpResponse> >();
+    auto future = promise->get_future();
+    get_call_async(
+        method, params,
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::make_completion(promise));
+    return future;
+}
+
+void openair::CurlServiceConnector::get_call_async(
+    const std::string& method,
+    const std::string& params,
+    const completion_t& completion) const {
+    std::unique_ptr<CurlTransfer> transfer(
+        new CurlTransfer(__CURL_SERVICE_CONNECTOR_INTERNAL__::acquire(
+                             *_pool, _options)));
+    transfer->url = _route(params.empty() ?
+        _get_url(method) : _get_url(method, params));
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_call(
+        transfer->handle.get(), transfer->url, &transfer->response,
+        _options.capture_headers);
+    transfer->done =
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::make_done(completion);
+    _get_engine().submit(std::move(transfer));
+}
+
+std::future<openair::HttpResponse>
+openair::CurlServiceConnector::post_call_async(
+    const std::string& method, const std::string& json) const {
+    auto promise = std::make_shared<std::promise<HttpResponse> >();
+    auto future = promise->get_future();
+    post_call_async(
+        method, json,
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::make_completion(promise));
+    return future;
+}
+
+void openair::CurlServiceConnector::post_call_async(
+    const std::string& method,
+    const std::string& json,
+    const completion_t& completion) const {
+    std::unique_ptr<CurlTransfer> transfer(
+        new CurlTransfer(__CURL_SERVICE_CONNECTOR_INTERNAL__::acquire(
+                             *_pool, _options)));
+    transfer->url = _route(_get_url(method));
+    transfer->body = json;
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_post_call(
+        transfer->handle.get(), _options, *_headers,
+        transfer->body.data(), transfer->body.size(), transfer->encoded);
+    __CURL_SERVICE_CONNECTOR_INTERNAL__::prepare_call(
+        transfer->handle.get(), transfer->url, &transfer->response,
+        _options.capture_headers);
+    transfer->done =
+        __CURL_SERVICE_CONNECTOR_INTERNAL__::make_done(completion);
+    _get_engine().submit(std::move(transfer));
+}
+
+openair::CurlMultiEngine *
+openair::CurlServiceConnector::_sync_engine() const {
+    if (_options.http_version != HTTP_VERSION_2 || _options.event_loop) {
+        return NULL;
+    }
+    CurlMultiEngine& engine = _get_engine();
+    // From a completion handler the engine thread would wait on its
+    // own transfer: the call falls back to a blocking perform.
+    return engine.on_engine_thread() ? NULL : &engine;
+}
+
+openair::CurlMultiEngine&
+openair::CurlServiceConnector::_get_engine() const {
+    std::call_once(_engine_flag, [this]() {
+        _engine.reset(_options.event_loop ?
+                      new CurlMultiEngine(*_options.event_loop) :
+                      new CurlMultiEngine());
+    });
+    return *_engine;
 }
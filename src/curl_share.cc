@@ -0,0 +1,35 @@
+#include "curl_share.hh"
+
+openair::CurlShare& openair::CurlShare::instance() {
+    // Intentionally leaked, see the class documentation.
+    static CurlShare *share = new CurlShare();
+    return *share;
+}
+
+void openair::CurlShare::attach(CURL *curl) const {
+    curl_easy_setopt(curl, CURLOPT_SHARE, _share);
+}
+
+openair::CurlShare::CurlShare() : _share(curl_share_init()) {
+    if (!_share) {
+        throw "Unable to initialize curl share handle";
+    }
+    curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, _lock);
+    curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, _unlock);
+    curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(_share, CURLSHOPT_SHARE,
+                      CURL_LOCK_DATA_SSL_SESSION);
+    // The connection cache is not shared: libcurl does not support
+    // sharing it between threads running transfers at the same time.
+}
+
+void openair::CurlShare::_lock(CURL *, curl_lock_data data,
+                               curl_lock_access, void *userptr) {
+    static_cast<CurlShare*>(userptr)->_locks[data].lock();
+}
+
+void openair::CurlShare::_unlock(CURL *, curl_lock_data data,
+                                 void *userptr) {
+    static_cast<CurlShare*>(userptr)->_locks[data].unlock();
+}
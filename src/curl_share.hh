@@ -0,0 +1,71 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_share.hh
+ * \brief     Process wide curl share handle.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the share handle that lets every connector of the process
+ * use the same DNS cache and TLS session cache.
+ */
+
+#include <mutex>
+#include <curl/curl.h>
+
+#ifndef CURL_SHARE_INCLUDE_GUARD_HH
+#define CURL_SHARE_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Process wide curl share handle.
+    *
+    * The share is created on first use and lives until the process
+    * exits: it is never cleaned up, so it can not be destroyed while
+    * a handle of a static connector still uses it. Each kind of
+    * shared data has its own mutex, so DNS lookups do not wait on
+    * TLS session updates.
+    */
+    class CurlShare {
+    public:
+        /*! \return The share of the process. */
+        static CurlShare& instance();
+
+        /*!
+         * \brief Attaches a handle to the share.
+         * \param curl - Handle to attach.
+         */
+        void attach(CURL *curl) const;
+
+    private:
+        CurlShare();
+
+        static void _lock(CURL *handle, curl_lock_data data,
+                          curl_lock_access access, void *userptr);
+        static void _unlock(CURL *handle, curl_lock_data data,
+                            void *userptr);
+
+        CurlShare(const CurlShare&);
+        CurlShare& operator=(const CurlShare&);
+
+        CURLSH *_share;
+        std::mutex _locks[CURL_LOCK_DATA_LAST];
+    };
+}
+#endif
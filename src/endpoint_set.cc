@@ -0,0 +1,128 @@
+#include "endpoint_set.hh"
+#include <random>
+
+namespace __ENDPOINT_SET_INTERNAL__ {
+    double random_unit() {
+        thread_local std::mt19937 generator(std::random_device{}());
+        return std::uniform_real_distribution<double>(0, 1)(generator);
+    }
+
+    bool is_tried(openair::EndpointSet::tried_t tried, std::size_t index) {
+        return (tried >> index) & 1;
+    }
+}
+
+const std::size_t openair::EndpointSet::MAX_ENDPOINTS;
+
+openair::EndpointSet::EndpointSet(
+    const std::vector<std::string>& addresses,
+    const EndpointPolicy& policy)
+    : _policy(policy) {
+    if (addresses.empty()) {
+        throw "No service address";
+    }
+    if (addresses.size() > MAX_ENDPOINTS) {
+        throw "Too many service addresses";
+    }
+    for (const auto& address : addresses) {
+        Endpoint endpoint;
+        endpoint.address = address;
+        // No latency yet: every endpoint is tried before ranking.
+        endpoint.ewma_ms = 0;
+        endpoint.requests = 0;
+        endpoint.failures = 0;
+        endpoint.consecutive_failures = 0;
+        _endpoints.push_back(endpoint);
+    }
+}
+
+std::size_t openair::EndpointSet::pick(tried_t tried) const {
+    using __ENDPOINT_SET_INTERNAL__::is_tried;
+    const auto now = clock::now();
+    std::vector<std::size_t> healthy;
+    healthy.reserve(_endpoints.size());
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::size_t best = _endpoints.size();
+    std::size_t first_back = _endpoints.size();
+    for (std::size_t i = 0; i < _endpoints.size(); ++i) {
+        if (is_tried(tried, i)) {
+            continue;
+        }
+        const Endpoint& endpoint = _endpoints[i];
+        if (endpoint.ejected_until > now) {
+            if (first_back == _endpoints.size() ||
+                endpoint.ejected_until <
+                    _endpoints[first_back].ejected_until) {
+                first_back = i;
+            }
+            continue;
+        }
+        healthy.push_back(i);
+        if (best == _endpoints.size() ||
+            endpoint.ewma_ms < _endpoints[best].ewma_ms) {
+            best = i;
+        }
+    }
+    if (healthy.empty()) {
+        return first_back;
+    }
+    if (healthy.size() > 1 &&
+        __ENDPOINT_SET_INTERNAL__::random_unit() < _policy.explore) {
+        return healthy[static_cast<std::size_t>(
+            __ENDPOINT_SET_INTERNAL__::random_unit() * healthy.size()) %
+                       healthy.size()];
+    }
+    return best;
+}
+
+std::string openair::EndpointSet::rebase(const std::string& url,
+                                         std::size_t index) const {
+    if (index == 0) {
+        return url;
+    }
+    // Addresses never change after the construction: no lock.
+    const std::string& base = _endpoints[0].address;
+    const std::string& address = _endpoints[index].address;
+    std::string rebased;
+    rebased.reserve(address.size() + url.size() - base.size());
+    rebased.append(address).append(url, base.size(), std::string::npos);
+    return rebased;
+}
+
+void openair::EndpointSet::report(std::size_t index, double latency_ms,
+                                  bool healthy) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Endpoint& endpoint = _endpoints[index];
+    ++endpoint.requests;
+    if (healthy) {
+        endpoint.consecutive_failures = 0;
+        endpoint.ewma_ms = endpoint.ewma_ms == 0 ?
+            latency_ms :
+            _policy.ewma_alpha * latency_ms +
+                (1 - _policy.ewma_alpha) * endpoint.ewma_ms;
+        return;
+    }
+    ++endpoint.failures;
+    if (++endpoint.consecutive_failures >= _policy.max_failures) {
+        // Back after the ejection, a single failure ejects it again.
+        endpoint.ejected_until = clock::now() +
+            std::chrono::milliseconds(_policy.ejection_ms);
+    }
+}
+
+std::vector<openair::EndpointStats> openair::EndpointSet::stats() const {
+    const auto now = clock::now();
+    std::vector<EndpointStats> snapshot;
+    snapshot.reserve(_endpoints.size());
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& endpoint : _endpoints) {
+        EndpointStats stats;
+        stats.address = endpoint.address;
+        stats.latency_ms = endpoint.ewma_ms;
+        stats.requests = endpoint.requests;
+        stats.failures = endpoint.failures;
+        stats.healthy = endpoint.ejected_until <= now;
+        snapshot.push_back(stats);
+    }
+    return snapshot;
+}
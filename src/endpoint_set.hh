@@ -0,0 +1,119 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      endpoint_set.hh
+ * \brief     Latency and health of the service endpoints.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the endpoints of a connector with many service addresses:
+ * their latency average, their passive health check and the choice
+ * of the endpoint of each call.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "libopenair/curl_service_connector.hh"
+
+#ifndef ENDPOINT_SET_INCLUDE_GUARD_HH
+#define ENDPOINT_SET_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Thread safe set of service endpoints.
+    *
+    * Every url of the connector is built on the first address: a call
+    * routed to another endpoint only swaps that prefix.
+    */
+    class EndpointSet {
+    public:
+        /*! Maximum number of endpoints. */
+        static const std::size_t MAX_ENDPOINTS = 64;
+
+        /*! Typedefinition of the set of endpoints tried by a call. */
+        typedef unsigned long long tried_t;
+
+        /*!
+         * \brief Constructor with two parameters.
+         * \param addresses - Addresses of the service, at least one
+         *                    and at most MAX_ENDPOINTS.
+         * \param policy    - Routing policy of the connector.
+         */
+        EndpointSet(const std::vector<std::string>& addresses,
+                    const EndpointPolicy& policy);
+
+        /*! \return The number of endpoints. */
+        std::size_t size() const { return _endpoints.size(); }
+
+        /*!
+         * \brief Chooses the endpoint of a call.
+         * \param tried - Endpoints already tried by the call, that
+         *                are skipped.
+         * \return The healthy endpoint with the lowest latency, a
+         *         random healthy one now and then to refresh the
+         *         latencies, or the first to come back when all are
+         *         ejected.
+         */
+        std::size_t pick(tried_t tried = 0) const;
+
+        /*!
+         * \brief Moves an url to an endpoint.
+         * \param url   - Url built on the first address.
+         * \param index - Endpoint of the call.
+         * \return The url on the endpoint.
+         */
+        std::string rebase(const std::string& url,
+                           std::size_t index) const;
+
+        /*!
+         * \brief Records the outcome of a call.
+         * \param index      - Endpoint of the call.
+         * \param latency_ms - Duration of the call.
+         * \param healthy    - False if the call failed or the service
+         *                     answered with a server error.
+         */
+        void report(std::size_t index, double latency_ms, bool healthy);
+
+        /*! \return A snapshot of the endpoints. */
+        std::vector<EndpointStats> stats() const;
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        struct Endpoint {
+            std::string address;
+            double ewma_ms;
+            unsigned long long requests;
+            unsigned long long failures;
+            unsigned consecutive_failures;
+            clock::time_point ejected_until;
+        };
+
+        EndpointSet(const EndpointSet&);
+        EndpointSet& operator=(const EndpointSet&);
+
+        EndpointPolicy _policy;
+        mutable std::mutex _mutex;
+        std::vector<Endpoint> _endpoints;
+    };
+}
+#endif
@@ -0,0 +1,153 @@
+#include "libopenair/event_loop.hh"
+#include <algorithm>
+#include <vector>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+namespace __EVENT_LOOP_INTERNAL__ {
+    /* Events read by each call to epoll_wait. */
+    const int MAX_EVENTS = 64;
+
+    uint32_t to_epoll(int events) {
+        uint32_t flags = 0;
+        if (events & openair::SOCKET_READ) {
+            flags |= EPOLLIN;
+        }
+        if (events & openair::SOCKET_WRITE) {
+            flags |= EPOLLOUT;
+        }
+        return flags;
+    }
+
+    int from_epoll(uint32_t flags) {
+        int events = openair::SOCKET_NONE;
+        if (flags & (EPOLLIN | EPOLLHUP)) {
+            events |= openair::SOCKET_READ;
+        }
+        if (flags & EPOLLOUT) {
+            events |= openair::SOCKET_WRITE;
+        }
+        if (flags & EPOLLERR) {
+            events |= openair::SOCKET_ERROR;
+        }
+        return events;
+    }
+}
+
+openair::EventLoopClient::~EventLoopClient() { }
+
+openair::EventLoop::~EventLoop() { }
+
+openair::EpollLoop::EpollLoop() : _epoll(epoll_create1(EPOLL_CLOEXEC)) {
+    if (_epoll < 0) {
+        throw "Unable to create epoll instance";
+    }
+}
+
+openair::EpollLoop::~EpollLoop() {
+    close(_epoll);
+}
+
+void openair::EpollLoop::watch(EventLoopClient& client, int fd,
+                               int events) {
+    auto it = _sockets.find(fd);
+    if (events == SOCKET_NONE) {
+        if (it != _sockets.end()) {
+            // The socket may already be closed: errors are expected.
+            epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, NULL);
+            _sockets.erase(it);
+        }
+        return;
+    }
+    epoll_event event = epoll_event();
+    event.events = __EVENT_LOOP_INTERNAL__::to_epoll(events);
+    event.data.fd = fd;
+    if (it == _sockets.end()) {
+        if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            throw "Unable to watch socket";
+        }
+        _sockets[fd] = &client;
+    } else {
+        if (epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &event) != 0) {
+            throw "Unable to watch socket";
+        }
+        it->second = &client;
+    }
+}
+
+void openair::EpollLoop::schedule(EventLoopClient& client,
+                                  long timeout_ms) {
+    if (timeout_ms < 0) {
+        _timers.erase(&client);
+        return;
+    }
+    _timers[&client] = clock::now() + std::chrono::milliseconds(timeout_ms);
+}
+
+std::size_t openair::EpollLoop::run_once(long max_wait_ms) {
+    epoll_event events[__EVENT_LOOP_INTERNAL__::MAX_EVENTS];
+    int ready = epoll_wait(_epoll, events,
+                           __EVENT_LOOP_INTERNAL__::MAX_EVENTS,
+                           static_cast<int>(_next_timeout(max_wait_ms)));
+    std::size_t dispatched = 0;
+    for (int i = 0; i < ready; ++i) {
+        // A previous callback may have stopped watching the socket.
+        auto it = _sockets.find(events[i].data.fd);
+        if (it == _sockets.end()) {
+            continue;
+        }
+        it->second->on_socket(
+            events[i].data.fd,
+            __EVENT_LOOP_INTERNAL__::from_epoll(events[i].events));
+        ++dispatched;
+    }
+    return dispatched + _fire_timers();
+}
+
+void openair::EpollLoop::run_until(const std::function<bool()>& done) {
+    while (!done() && !empty()) {
+        run_once(-1);
+    }
+}
+
+bool openair::EpollLoop::empty() const {
+    return _sockets.empty() && _timers.empty();
+}
+
+long openair::EpollLoop::_next_timeout(long max_wait_ms) const {
+    long wait = max_wait_ms;
+    const auto now = clock::now();
+    for (const auto& timer : _timers) {
+        // Rounded up, so the timer is due when epoll_wait returns.
+        long left = static_cast<long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                timer.second - now).count() + 999) / 1000;
+        left = std::max(0L, left);
+        wait = wait < 0 ? left : std::min(wait, left);
+    }
+    return wait;
+}
+
+std::size_t openair::EpollLoop::_fire_timers() {
+    const auto now = clock::now();
+    std::vector<EventLoopClient*> due;
+    for (const auto& timer : _timers) {
+        if (timer.second <= now) {
+            due.push_back(timer.first);
+        }
+    }
+    std::size_t fired = 0;
+    for (EventLoopClient *client : due) {
+        // An earlier callback may have cancelled or moved the timer,
+        // or destroyed the client after cancelling it.
+        auto it = _timers.find(client);
+        if (it == _timers.end() || it->second > now) {
+            continue;
+        }
+        // Removed first: the callback may schedule a new timer.
+        _timers.erase(it);
+        client->on_timeout();
+        ++fired;
+    }
+    return fired;
+}
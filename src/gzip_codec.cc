@@ -0,0 +1,29 @@
+#include <zlib.h>
+#include "gzip_codec.hh"
+
+namespace __GZIP_CODEC_INTERNAL__ {
+    /* Window bits asking zlib for the gzip wrapper. */
+    const int GZIP_WINDOW_BITS = 15 + 16;
+}
+
+void openair::gzip_compress(const char *data, std::size_t size,
+                            std::string& out) {
+    z_stream stream = z_stream();
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                     __GZIP_CODEC_INTERNAL__::GZIP_WINDOW_BITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw "Unable to initialize gzip compression";
+    }
+    out.resize(deflateBound(&stream, size));
+    stream.next_in =
+        reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = size;
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = out.size();
+    int result = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        throw "Unable to compress with gzip";
+    }
+    out.resize(stream.total_out);
+}
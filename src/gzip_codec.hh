@@ -0,0 +1,47 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      gzip_codec.hh
+ * \brief     Gzip helpers based on zlib.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the functions used to compress the request bodies.
+ * Response bodies are decoded by libcurl itself.
+ */
+
+#include <cstddef>
+#include <string>
+
+#ifndef GZIP_CODEC_INCLUDE_GUARD_HH
+#define GZIP_CODEC_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+    /*!
+     * \brief Compresses a buffer in the gzip format.
+     * \param data - Data to compress.
+     * \param size - Size of the data in bytes.
+     * \param out  - String replaced with the compressed data.
+     *
+     * It throws a const char* if zlib fails.
+     */
+    void gzip_compress(const char *data, std::size_t size,
+                       std::string& out);
+}
+#endif
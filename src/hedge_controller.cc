@@ -0,0 +1,81 @@
+#include "hedge_controller.hh"
+#include <algorithm>
+#include <cmath>
+
+namespace __HEDGE_CONTROLLER_INTERNAL__ {
+    /* Number of latencies the percentile is computed on. */
+    const std::size_t WINDOW = 512;
+
+    /* Latencies recorded before the percentile replaces the initial
+     * delay, and between two updates of the delay. */
+    const std::size_t UPDATE_EVERY = 32;
+
+    /* Hedges that can be saved up while the service is fast. */
+    const double MAX_BUDGET = 10;
+}
+
+openair::HedgeController::HedgeController(const HedgingPolicy& policy)
+    : _policy(policy),
+      _next(0),
+      _since_update(0),
+      _delay_ms(policy.initial_delay_ms),
+      _budget(0) {
+    _latencies.reserve(__HEDGE_CONTROLLER_INTERNAL__::WINDOW);
+    _stats.delay_ms = _delay_ms;
+}
+
+long openair::HedgeController::start() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.calls;
+    _budget = std::min(__HEDGE_CONTROLLER_INTERNAL__::MAX_BUDGET,
+                       _budget + _policy.max_extra_load);
+    return _delay_ms;
+}
+
+bool openair::HedgeController::try_hedge() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_budget < 1) {
+        ++_stats.hedges_denied;
+        return false;
+    }
+    _budget -= 1;
+    ++_stats.hedges_sent;
+    return true;
+}
+
+void openair::HedgeController::finish(double latency_ms,
+                                      bool hedge_won) {
+    using namespace __HEDGE_CONTROLLER_INTERNAL__;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (hedge_won) {
+        ++_stats.hedges_won;
+    }
+    if (_latencies.size() < WINDOW) {
+        _latencies.push_back(latency_ms);
+    } else {
+        _latencies[_next] = latency_ms;
+        _next = (_next + 1) % WINDOW;
+    }
+    if (++_since_update >= UPDATE_EVERY) {
+        _since_update = 0;
+        _update_delay();
+    }
+}
+
+openair::HedgingStats openair::HedgeController::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void openair::HedgeController::_update_delay() {
+    // The percentile is computed on a copy every UPDATE_EVERY calls,
+    // not on each call.
+    std::vector<double> sorted(_latencies);
+    std::size_t rank = static_cast<std::size_t>(
+        std::ceil(_policy.percentile * sorted.size())) - 1;
+    rank = std::min(rank, sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    _delay_ms = std::max(_policy.min_delay_ms,
+                         static_cast<long>(std::ceil(sorted[rank])));
+    _stats.delay_ms = _delay_ms;
+}
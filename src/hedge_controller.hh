@@ -0,0 +1,87 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      hedge_controller.hh
+ * \brief     Delay and budget of the hedged requests.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the bookkeeping of the hedged GET calls of the connector:
+ * the latency percentile that triggers a hedge, the budget that
+ * bounds the extra load and the counters.
+ */
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "libopenair/curl_service_connector.hh"
+
+#ifndef HEDGE_CONTROLLER_INCLUDE_GUARD_HH
+#define HEDGE_CONTROLLER_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Thread safe bookkeeping of the hedged calls.
+    */
+    class HedgeController {
+    public:
+        /*!
+         * \brief Constructor with one parameter.
+         * \param policy - Hedging policy of the connector.
+         */
+        explicit HedgeController(const HedgingPolicy& policy);
+
+        /*!
+         * \brief Registers a new call, that earns a fraction of a
+         *        hedge to the budget.
+         * \return Milliseconds to wait for an answer before hedging.
+         */
+        long start();
+
+        /*!
+         * \brief Takes a hedge from the budget.
+         * \return True if the hedge can be sent.
+         */
+        bool try_hedge();
+
+        /*!
+         * \brief Records the end of a call.
+         * \param latency_ms - Time the call took to get an answer.
+         * \param hedge_won  - True if the hedge answered first.
+         */
+        void finish(double latency_ms, bool hedge_won);
+
+        /*! \return A snapshot of the counters. */
+        HedgingStats stats() const;
+
+    private:
+        void _update_delay();
+
+        HedgingPolicy _policy;
+        mutable std::mutex _mutex;
+        /*! Ring of the latest latencies. */
+        std::vector<double> _latencies;
+        std::size_t _next;
+        std::size_t _since_update;
+        long _delay_ms;
+        double _budget;
+        HedgingStats _stats;
+    };
+}
+#endif
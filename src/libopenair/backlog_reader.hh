@@ -0,0 +1,202 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      backlog_reader.hh
+ * \brief     This file contains the checkpointed reader of the logged
+ *            surveys.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the definition of the component that uploads the
+ * survey records logged by the SurveyLogger in the sqlite3 database of
+ * the configuration (ConfigurationData::database_path), resuming from
+ * the last record accepted by the service.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "curl_service_connector.hh"
+
+#ifndef BACKLOG_READER_INCLUDE_GUARD_HH
+#define BACKLOG_READER_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+    class SqliteDatabase;
+    class SqliteStatement;
+
+   /*!
+    * \brief This structure contains the page bounds of the reader.
+    *
+    * A page ends as soon as one of the bounds is reached, but it always
+    * contains at least one record.
+    */
+    struct BacklogReaderOptions {
+        /*! Maximum number of records in a page. */
+        std::size_t page_records;
+
+        /*! Maximum size, in bytes, of the JSON array of a page. */
+        std::size_t page_bytes;
+
+        /*!
+         * Number of pages catch_up uploads at once, each from its own
+         * thread and on its own connection: the pool_size of the
+         * connector should not be smaller.
+         */
+        std::size_t connections;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with their default values: 500
+         * records and 256 KiB, as the SurveyBatcher batches, and one
+         * connection.
+         */
+        BacklogReaderOptions();
+    };
+
+   /*!
+    * \brief A page of logged survey records.
+    *
+    * Pages are meant to be reused: reading a page in an existing one
+    * keeps the memory of its JSON array.
+    */
+    struct BacklogPage {
+        /*! Id of the record the page follows. */
+        std::int64_t after;
+        /*! Id of the last record of the page. */
+        std::int64_t last;
+        /*! Number of records in the page. */
+        std::size_t records;
+        /*! JSON array of the records. */
+        std::string json;
+
+        /*! Default constructor: every value is zero. */
+        BacklogPage();
+    };
+
+   /*!
+    * \brief Checkpointed reader of the survey_log table.
+    *
+    * The reader walks the records logged after its checkpoint, the id
+    * of the last record accepted by the service, in pages of bounded
+    * size: the memory used does not depend on the size of the
+    * backlog. The checkpoint is kept in the backlog_checkpoint table,
+    * one for each method, and only moves when a page is acknowledged.
+    *
+    * A crash between an upload and its acknowledgment uploads the
+    * page again at the next run: the delivery is at least once.
+    *
+    * The reader must be used by one thread at a time. Database errors
+    * are reported by throwing a const char*.
+    */
+    class BacklogReader {
+    public:
+        /*!
+         * \brief Constructor with four parameters.
+         * \param database_path - Path of the sqlite3 database.
+         * \param connector     - Connector used to upload the pages.
+         *                        It must outlive the reader.
+         * \param method        - Method called with the pages (for
+         *                        example ConfigurationData
+         *                        send_data_method). It also names the
+         *                        checkpoint.
+         * \param options       - Page bounds.
+         *
+         * Opens the database, creates the tables if missing and loads
+         * the checkpoint of the method. It throws a const char* if the
+         * database can not be opened.
+         */
+        BacklogReader(const std::string& database_path,
+                      const CurlServiceConnector& connector,
+                      const std::string& method,
+                      const BacklogReaderOptions& options =
+                          BacklogReaderOptions());
+
+        /*! Closes the database. */
+        ~BacklogReader();
+
+        /*!
+         * \brief Reads the page following the cursor.
+         * \param page - Page to fill.
+         * \return False if there are no more records.
+         *
+         * The cursor starts at the checkpoint and moves to the last
+         * record of the page: the pages can be read ahead of their
+         * acknowledgment.
+         */
+        bool next(BacklogPage& page);
+
+        /*!
+         * \brief Moves the checkpoint to the last record of a page.
+         * \param page - Page accepted by the service.
+         *
+         * The checkpoint is committed to the database before the call
+         * returns. It throws a const char* if the page does not follow
+         * the checkpoint: pages are acknowledged in order.
+         */
+        void acknowledge(const BacklogPage& page);
+
+        /*!
+         * \brief Moves the cursor back to the checkpoint, so the
+         *        pages not acknowledged are read again.
+         */
+        void rewind();
+
+        /*!
+         * \brief Uploads the records after the checkpoint.
+         * \return The number of records accepted by the service.
+         *
+         * Each page is sent with a POST call and acknowledged once the
+         * service answers with a 2xx http code. The upload stops at
+         * the first page that fails, that will be the first page of
+         * the next call.
+         *
+         * With more than one connection the pages are compressed and
+         * sent by a pool of threads, so they can reach the service
+         * out of order, but they are still acknowledged in order: the
+         * checkpoint never passes a page that was not accepted. Pages
+         * accepted after a failed one are sent again by the next call.
+         */
+        std::size_t catch_up();
+
+        /*! \return Id of the last record accepted by the service. */
+        std::int64_t checkpoint() const;
+
+        /*! \return Number of records logged after the checkpoint. */
+        std::size_t remaining();
+
+    private:
+        std::size_t _parallel_catch_up();
+
+        BacklogReader(const BacklogReader&);
+        BacklogReader& operator=(const BacklogReader&);
+
+        const CurlServiceConnector& _connector;
+        std::string _method;
+        BacklogReaderOptions _options;
+        std::unique_ptr<SqliteDatabase> _db;
+        std::unique_ptr<SqliteStatement> _select;
+        std::unique_ptr<SqliteStatement> _save;
+        std::unique_ptr<SqliteStatement> _count;
+        std::int64_t _checkpoint;
+        std::int64_t _position;
+    };
+}
+#endif
@@ -30,6 +30,7 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
 #ifndef CONFIGURATION_INCLUDE_GUARD_HH
 #define CONFIGURATION_INCLUDE_GUARD_HH 1
@@ -56,6 +57,12 @@ namespace openair {
      */
     const std::string SERVICE_ADDRESS_KEY = "service_address";
 
+    /*!
+     * This represent the key value of the list of service endpoints,
+     * separated by commas.
+     */
+    const std::string SERVICE_ENDPOINTS_KEY = "service_endpoints";
+
     /*!
      * This macro represent the key value of the method used to
      * register a client in the vpn.
@@ -88,6 +95,13 @@ namespace openair {
         /*! Address of the remote service. */
         std::string service_address;
 
+        /*!
+         * Addresses of the replicas of the remote service, to be
+         * passed to the CurlServiceConnector constructor taking many
+         * addresses. Empty when the service has a single address.
+         */
+        std::vector<std::string> service_endpoints;
+
         /*!
          * Name of the method to call to register a client in the
          * vpn.
@@ -0,0 +1,305 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      coroutine_calls.hh
+ * \brief     This file contains the C++20 coroutine interface of the
+ *            connector.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the awaitable calls of the connector and the
+ * coroutine task type used to chain them. It requires C++20 and is
+ * installed, with the libopenair_coro library, only when the library
+ * is configured with --enable-coroutines.
+ *
+ * The calls are performed by the asynchronous engine of the
+ * connector: a suspended call costs its coroutine frame and its curl
+ * transfer, not a thread. The coroutines resume on the engine thread,
+ * or on the loop thread when the connector has an event loop, so
+ * thousands of logical calls can run on a single thread.
+ */
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include "curl_service_connector.hh"
+
+#ifndef COROUTINE_CALLS_INCLUDE_GUARD_HH
+#define COROUTINE_CALLS_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Awaitable http call.
+    *
+    * The call starts when it is awaited. Awaiting it gives the http
+    * response, or throws a const char* with the curl error message,
+    * like the synchronous calls.
+    */
+    class CallAwaiter {
+    public:
+        /*!
+         * \brief Constructor of a GET call.
+         * \param connector - Connector performing the call.
+         * \param method    - Method to call.
+         * \param params    - GET parameters, empty for none.
+         */
+        CallAwaiter(const CurlServiceConnector& connector,
+                    std::string method,
+                    std::string params);
+
+        /*!
+         * \brief Constructor of a POST call.
+         * \param connector - Connector performing the call.
+         * \param method    - Method to call.
+         * \param json      - JSON body of the call.
+         * \param post      - Tag selecting the POST call.
+         */
+        CallAwaiter(const CurlServiceConnector& connector,
+                    std::string method,
+                    std::string json,
+                    bool post);
+
+        /*! \return False: the call is always suspended. */
+        bool await_ready() const noexcept { return false; }
+
+        /*!
+         * \brief Starts the call.
+         * \param caller - Coroutine resumed when the call ends.
+         * \return False if the call already ended: the caller goes
+         *         on without suspending.
+         */
+        bool await_suspend(std::coroutine_handle<> caller);
+
+        /*!
+         * \brief Gets the outcome of the call.
+         * \return The http response.
+         */
+        HttpResponse await_resume();
+
+    private:
+        const CurlServiceConnector *_connector;
+        std::string _method;
+        /*! GET parameters or POST body. */
+        std::string _payload;
+        bool _post;
+        std::coroutine_handle<> _caller;
+        std::optional<HttpResponse> _response;
+        const char *_error;
+        /*!
+         * Set by the first of await_suspend and the completion to
+         * end: the second one resumes the caller.
+         */
+        std::atomic<bool> _ended;
+    };
+
+   /*!
+    * \brief Coroutine interface of a connector.
+    *
+    * It only references the connector, that must outlive it and the
+    * calls in flight:
+    *   openair::AwaitableConnector connector(base);
+    *   auto response = co_await connector.post(method, json);
+    */
+    class AwaitableConnector {
+    public:
+        /*!
+         * \brief Constructor with one parameter.
+         * \param connector - Connector performing the calls.
+         */
+        explicit AwaitableConnector(const CurlServiceConnector& connector)
+            : _connector(&connector) { }
+
+        /*!
+         * \brief Awaitable GET call.
+         * \param method - Method to call.
+         * \param params - GET parameters, empty for none.
+         * \return The call, started when awaited.
+         */
+        CallAwaiter get(std::string method,
+                        std::string params = std::string()) const {
+            return CallAwaiter(*_connector, std::move(method),
+                               std::move(params));
+        }
+
+        /*!
+         * \brief Awaitable POST call.
+         * \param method - Method to call.
+         * \param json   - JSON body of the call.
+         * \return The call, started when awaited.
+         */
+        CallAwaiter post(std::string method, std::string json) const {
+            return CallAwaiter(*_connector, std::move(method),
+                               std::move(json), true);
+        }
+
+    private:
+        const CurlServiceConnector *_connector;
+    };
+
+    template <typename T> class Task;
+
+    namespace __COROUTINE_CALLS_INTERNAL__ {
+        /* Resumes the awaiting coroutine when a task ends. */
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<Promise> task) noexcept {
+                auto continuation = task.promise().continuation;
+                return continuation ?
+                    continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept { }
+        };
+
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            std::suspend_always initial_suspend() const noexcept {
+                return std::suspend_always();
+            }
+
+            FinalAwaiter final_suspend() const noexcept {
+                return FinalAwaiter();
+            }
+
+            void unhandled_exception() noexcept {
+                error = std::current_exception();
+            }
+        };
+
+        template <typename T>
+        struct Promise : PromiseBase {
+            T value;
+
+            Task<T> get_return_object() noexcept;
+
+            template <typename U>
+            void return_value(U&& result) {
+                value = std::forward<U>(result);
+            }
+
+            T take() {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                return std::move(value);
+            }
+        };
+
+        template <>
+        struct Promise<void> : PromiseBase {
+            Task<void> get_return_object() noexcept;
+
+            void return_void() const noexcept { }
+
+            void take() {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        };
+    }
+
+   /*!
+    * \brief Lazy coroutine returning a T.
+    *
+    * The task starts when it is awaited, or when it is given to
+    * spawn, and resumes its awaiter when it ends. Exceptions are
+    * rethrown to the awaiter. T must be default constructible and
+    * move assignable.
+    */
+    template <typename T>
+    class Task {
+    public:
+        /*! Typedefinition of the coroutine promise. */
+        typedef __COROUTINE_CALLS_INTERNAL__::Promise<T> promise_type;
+
+        /*! Move constructor. */
+        Task(Task&& other) noexcept
+            : _handle(std::exchange(other._handle, nullptr)) { }
+
+        /*! Destroys the coroutine, if not running. */
+        ~Task() {
+            if (_handle) {
+                _handle.destroy();
+            }
+        }
+
+        /*! \return False: the task always starts suspended. */
+        bool await_ready() const noexcept { return false; }
+
+        /*!
+         * \brief Starts the task.
+         * \param caller - Coroutine resumed when the task ends.
+         * \return The task, to run at once.
+         */
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<> caller) noexcept {
+            _handle.promise().continuation = caller;
+            return _handle;
+        }
+
+        /*! \return The value returned by the task. */
+        T await_resume() { return _handle.promise().take(); }
+
+    private:
+        friend promise_type;
+
+        explicit Task(std::coroutine_handle<promise_type> handle)
+            : _handle(handle) { }
+
+        Task(const Task&);
+        Task& operator=(const Task&);
+
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    namespace __COROUTINE_CALLS_INTERNAL__ {
+        template <typename T>
+        Task<T> Promise<T>::get_return_object() noexcept {
+            return Task<T>(
+                std::coroutine_handle<Promise<T> >::from_promise(*this));
+        }
+
+        inline Task<void> Promise<void>::get_return_object() noexcept {
+            return Task<void>(
+                std::coroutine_handle<Promise<void> >::from_promise(
+                    *this));
+        }
+    }
+
+    /*!
+     * \brief Starts a task without awaiting it.
+     * \param task - Task to run. It runs on the calling thread until
+     *               its first suspension.
+     * \param done - Called when the task ends, with the exception
+     *               that ended it or a null pointer.
+     */
+    void spawn(Task<void> task,
+               std::function<void(std::exception_ptr)> done =
+                   std::function<void(std::exception_ptr)>());
+}
+#endif
@@ -25,12 +25,461 @@
  * implementation allow only JSON contents calls.
  */
 
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #ifndef CURL_SERVICE_CONNECTOR_INCLUDE_GUARD_HH
 #define CURL_SERVICE_CONNECTOR_INCLUDE_GUARD_HH 1
 
 namespace openair {
+
+    class CurlHandlePool;
+    class CurlMultiEngine;
+    class EndpointSet;
+    class EventLoop;
+    class HedgeController;
+    class ResponseCache;
+    class SingleFlight;
+    class PreparedCall;
+    struct CachedResponse;
+    struct CurlPostHeaders;
+
+   /*!
+    * \brief Content encodings supported for the request bodies.
+    */
+    enum ContentEncoding {
+        /*! Bodies are sent as they are. */
+        IDENTITY_ENCODING,
+        /*! Bodies are compressed with gzip. */
+        GZIP_ENCODING
+    };
+
+   /*!
+    * \brief Versions of the http protocol.
+    */
+    enum HttpVersion {
+        /*! Version not known, e.g. the call did not complete. */
+        HTTP_VERSION_UNKNOWN,
+        /*! HTTP/1.0. */
+        HTTP_VERSION_1_0,
+        /*! HTTP/1.1, one call at a time on each connection. */
+        HTTP_VERSION_1_1,
+        /*! HTTP/2, many calls multiplexed on one connection. */
+        HTTP_VERSION_2
+    };
+
+   /*!
+    * \brief This structure contains the retry policy of the
+    *        synchronous calls.
+    *
+    * A call is retried when curl fails to connect, resolve, send or
+    * receive, or times out, and when the service answers with 408,
+    * 429, 500, 502, 503 or 504. The wait before each retry is drawn at
+    * random up to an exponentially growing backoff (full jitter), so
+    * many clients do not retry in lockstep. POST calls retried after
+    * a failure while receiving may be delivered twice.
+    *
+    * The calls streaming their body, the POST of a body_producer_t
+    * and the GET into a body_sink_t, are the exception: the body can
+    * not be produced, or given to the sink, twice, so they are only
+    * retried when they failed to connect or to resolve the service.
+    */
+    struct RetryPolicy {
+        /*! Maximum number of attempts, one disables the retries. */
+        unsigned max_attempts;
+
+        /*! Backoff, in milliseconds, before the first retry. */
+        long initial_backoff_ms;
+
+        /*! Upper bound, in milliseconds, of the backoff. */
+        long max_backoff_ms;
+
+        /*! Growth factor of the backoff at each retry. */
+        double multiplier;
+
+        /*!
+         * If true a Retry-After header of the service sets the
+         * minimum wait before the next attempt.
+         */
+        bool honor_retry_after;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the policy with its default values: a single
+         * attempt, with 200 ms of initial backoff doubled up to 10
+         * seconds, and Retry-After honored when retries are enabled.
+         */
+        RetryPolicy();
+    };
+
+   /*!
+    * \brief This structure contains the hedging policy of the GET
+    *        calls.
+    *
+    * When hedging is enabled a GET call that got no answer within the
+    * given percentile of the recent GET latencies sends a second,
+    * identical request: the first answer wins and the other request
+    * is cancelled. Each call earns max_extra_load hedges, and a hedge
+    * is only sent if one has been earned, so hedging never adds more
+    * than that fraction of requests.
+    */
+    struct HedgingPolicy {
+        /*! If true the GET calls are hedged. */
+        bool enabled;
+        /*! Percentile, in (0, 1], of the latencies used as delay. */
+        double percentile;
+        /*! Lower bound, in milliseconds, of the delay. */
+        long min_delay_ms;
+        /*! Delay, in milliseconds, until enough latencies are known. */
+        long initial_delay_ms;
+        /*! Maximum fraction of extra requests sent as hedges. */
+        double max_extra_load;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the policy with hedging disabled, the 95th
+         * percentile as delay, 5 milliseconds of minimum delay, 100
+         * milliseconds of initial delay and at most 5% of extra load.
+         */
+        HedgingPolicy();
+    };
+
+   /*!
+    * \brief This structure contains the counters of the hedged calls.
+    */
+    struct HedgingStats {
+        /*! GET calls made with hedging enabled. */
+        unsigned long long calls;
+        /*! Hedges sent. */
+        unsigned long long hedges_sent;
+        /*! Hedges not sent because the budget was exhausted. */
+        unsigned long long hedges_denied;
+        /*! Hedges that answered before the first request. */
+        unsigned long long hedges_won;
+        /*! Current delay, in milliseconds, before hedging. */
+        long delay_ms;
+
+        /*! Default constructor: every value is zero. */
+        HedgingStats();
+    };
+
+   /*!
+    * \brief This structure contains the options of the response
+    *        cache of the GET calls.
+    *
+    * When the cache is enabled the buffered GET calls keep the
+    * responses carrying an ETag or a Last-Modified header, and no
+    * "Cache-Control: no-store", keyed by method and parameters. The
+    * next call to the same method sends
+    * If-None-Match and If-Modified-Since, and when the service
+    * answers 304 the cached body is returned with its original code.
+    */
+    struct ResponseCacheOptions {
+        /*! If true the GET responses are cached. */
+        bool enabled;
+        /*!
+         * Maximum size, in bytes, of the cached responses: the least
+         * recently used are dropped to stay within it.
+         */
+        std::size_t max_bytes;
+        /*!
+         * File where the cache is loaded from when the connector is
+         * created and saved to when it is destroyed. Empty keeps the
+         * cache in memory only.
+         */
+        std::string path;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with the cache disabled, 4 MiB of
+         * budget and no file.
+         */
+        ResponseCacheOptions();
+    };
+
+   /*!
+    * \brief This structure contains the counters of the response
+    *        cache.
+    */
+    struct ResponseCacheStats {
+        /*! Calls answered 304 and served from the cache. */
+        unsigned long long hits;
+        /*! Calls answered with a new body. */
+        unsigned long long misses;
+        /*! Responses dropped to stay within the budget. */
+        unsigned long long evictions;
+        /*! Responses in the cache. */
+        std::size_t entries;
+        /*! Bytes used by the cached responses. */
+        std::size_t bytes;
+
+        /*! Default constructor: every value is zero. */
+        ResponseCacheStats();
+    };
+
+   /*!
+    * \brief This structure contains the routing policy of a
+    *        connector with many service addresses.
+    *
+    * Each call goes to the healthy endpoint with the lowest average
+    * latency (an exponentially weighted moving average of the calls
+    * that succeeded). An endpoint failing max_failures calls in a
+    * row, or answering with server errors, is ejected for
+    * ejection_ms. A call that can not connect to its endpoint, or a
+    * GET call failing as transient, fails over at once to the next
+    * endpoint, without waiting for the retry policy.
+    */
+    struct EndpointPolicy {
+        /*! Weight, in (0, 1], of the last latency in the average. */
+        double ewma_alpha;
+        /*! Failures in a row that eject an endpoint. */
+        unsigned max_failures;
+        /*! Time, in milliseconds, an endpoint stays ejected. */
+        long ejection_ms;
+        /*!
+         * Fraction of the calls sent to a random healthy endpoint, to
+         * keep the latency of the others up to date.
+         */
+        double explore;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the policy with 0.3 as weight, ejection after 3
+         * failures for 30 seconds and 2% of exploring calls.
+         */
+        EndpointPolicy();
+    };
+
+   /*!
+    * \brief This structure contains the state of a service endpoint.
+    */
+    struct EndpointStats {
+        /*! Address of the endpoint. */
+        std::string address;
+        /*! Average latency, in milliseconds, zero until known. */
+        double latency_ms;
+        /*! Calls sent to the endpoint. */
+        unsigned long long requests;
+        /*! Calls failed or answered with a server error. */
+        unsigned long long failures;
+        /*! False while the endpoint is ejected. */
+        bool healthy;
+
+        /*! Default constructor: every value is zero. */
+        EndpointStats();
+    };
+
+   /*!
+    * \brief This structure contains the tuning options of the
+    *        connector.
+    */
+    struct CurlConnectorOptions {
+        /*!
+         * Maximum number of idle curl handles kept by the connector.
+         * Each handle keeps its connections alive, so this is also
+         * the number of warm connections reused by the next calls.
+         * Zero disables the reuse.
+         */
+        std::size_t pool_size;
+
+        /*!
+         * Seconds a connection may stay idle before being closed
+         * instead of reused.
+         */
+        long idle_timeout;
+
+        /*!
+         * Encoding of the POST bodies. When it is not
+         * IDENTITY_ENCODING the body is compressed and sent with the
+         * relative Content-Encoding header.
+         */
+        ContentEncoding request_encoding;
+
+        /*!
+         * Minimum size, in bytes, of a POST body to compress it:
+         * smaller bodies are sent as they are.
+         */
+        std::size_t compression_threshold;
+
+        /*!
+         * If true the calls send an Accept-Encoding header with all
+         * the encodings supported by libcurl, and compressed
+         * responses are decoded transparently in http_body.
+         */
+        bool accept_encoding;
+
+        /*!
+         * If true the connector uses the process wide DNS cache and
+         * TLS session cache, shared by every connector with this
+         * option and by every thread: a new connection skips the
+         * lookup and resumes the TLS session. Connections are never
+         * shared, each connector keeps its own.
+         */
+        bool share_caches;
+
+        /*!
+         * Preferred version of the protocol. With HTTP_VERSION_2 the
+         * connector offers h2 in the TLS handshake and every call,
+         * also the synchronous ones, runs on the connector event
+         * loop: concurrent calls from many threads are multiplexed as
+         * streams of a single connection. Servers not negotiating h2,
+         * and plain http addresses, are called with HTTP/1.1.
+         * A synchronous call made from a completion handler cannot
+         * wait on the loop running it: it blocks on its own
+         * connection instead, stalling the other calls meanwhile.
+         */
+        HttpVersion http_version;
+
+        /*!
+         * Path of a PEM file with the certificate authorities
+         * trusted to verify an https service, empty for the libcurl
+         * default bundle.
+         */
+        std::string ca_file;
+
+        /*!
+         * Maximum time, in milliseconds, to open the connection to
+         * the service. Zero uses the libcurl default (300 seconds).
+         */
+        long connect_timeout_ms;
+
+        /*!
+         * Maximum time, in milliseconds, of each attempt of a call.
+         * Zero means no limit.
+         */
+        long timeout_ms;
+
+        /*!
+         * A call transferring less than low_speed_limit bytes per
+         * second for low_speed_time seconds is aborted as timed out,
+         * so a hung service can not block a call forever. A zero
+         * limit disables the check.
+         */
+        long low_speed_limit;
+
+        /*! See low_speed_limit. */
+        long low_speed_time;
+
+        /*!
+         * Budget, in milliseconds, of a synchronous call including
+         * all its retries and backoffs: each attempt is limited to the
+         * time left. Zero means no budget.
+         */
+        long deadline_ms;
+
+        /*!
+         * Retry policy of the synchronous calls; the streamed ones
+         * are only retried when they did not reach the service.
+         */
+        RetryPolicy retry;
+
+        /*! Hedging policy of the buffered synchronous GET calls. */
+        HedgingPolicy hedging;
+
+        /*! Response cache of the buffered synchronous GET calls. */
+        ResponseCacheOptions cache;
+
+        /*!
+         * If true identical buffered GET calls (same method and
+         * parameters) made at the same time share one transfer:
+         * the calls arriving while it is in flight wait for it and
+         * get a copy of its result, also when it fails. A joining
+         * call waits at most its own deadline, then fails with
+         * CALL_TIMEOUT.
+         */
+        bool coalesce_gets;
+
+        /*!
+         * If true the buffered calls keep the headers of their
+         * responses in HttpResponse::http_headers. Otherwise only
+         * Content-Length and Retry-After are read, with no copy per
+         * header; the headers are always kept with the response
+         * cache, which needs them.
+         */
+        bool capture_headers;
+
+        /*! Routing policy, used with many service addresses. */
+        EndpointPolicy endpoints;
+
+        /*!
+         * Event loop of the application driving the asynchronous
+         * calls, NULL to drive them from a thread of the connector.
+         * With a loop the connector starts no thread: the async
+         * calls must be made, and complete, on the loop thread, and
+         * the loop must outlive the connector. The synchronous calls
+         * still block the calling thread, they are never hedged and
+         * in HTTP_VERSION_2 mode they are not multiplexed.
+         */
+        EventLoop *event_loop;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with their default values: a pool
+         * of 4 handles, 60 seconds of idle timeout, uncompressed
+         * requests (with 1 KiB of threshold when enabled),
+         * compressed responses accepted, no shared caches,
+         * HTTP/1.1, the default certificate authorities, 10 seconds
+         * to connect, calls aborted after 60 seconds under 1 byte
+         * per second, no deadline, no retries, no hedging, no
+         * response cache, no coalescing, no header capture and no
+         * event loop.
+         */
+        CurlConnectorOptions();
+    };
+   /*!
+    * \brief This structure represent a read only memory buffer, not
+    *        owned, used to pass a request body without copying it.
+    */
+    struct ConstBuffer {
+        /*! First byte of the buffer. */
+        const char *data;
+        /*! Size of the buffer in bytes. */
+        std::size_t size;
+    };
+
+   /*!
+    * \brief This structure contains the timing of an http call.
+    *
+    * Each phase is the time, in microseconds, elapsed from the start
+    * of the call to the end of the phase, as reported by libcurl.
+    */
+    struct HttpTiming {
+        /*! Name resolution completed. */
+        long long namelookup_us;
+        /*! TCP connection established. */
+        long long connect_us;
+        /*! TLS handshake completed, zero for plain http. */
+        long long appconnect_us;
+        /*! Request about to be sent. */
+        long long pretransfer_us;
+        /*! First response byte received. */
+        long long starttransfer_us;
+        /*! Call completed. */
+        long long total_us;
+        /*! Number of body bytes sent. */
+        long long bytes_sent;
+        /*! Number of body bytes received. */
+        long long bytes_received;
+        /*! True if the call reused an already open connection. */
+        bool connection_reused;
+
+        /*! Default constructor: every value is zero. */
+        HttpTiming();
+    };
+
    /*!
     * \brief This structure represent an http response.
     */
@@ -39,11 +488,36 @@ namespace openair {
         typedef long int    http_code_t;
         /*! Typedefinition to represent the returned http body. */
         typedef std::string http_body_t;
+        /*!
+         * Typedefinition to represent the returned http headers, as
+         * pairs of lower case name and value.
+         */
+        typedef std::vector<std::pair<std::string, std::string> >
+            http_headers_t;
 
         /*! Http code of the response. */
         http_code_t http_code;
         /*! Http body of the response. */
         http_body_t http_body;
+        /*! Timing and transfer statistics of the call. */
+        HttpTiming timing;
+        /*! Version of the protocol used by the call. */
+        HttpVersion http_version;
+        /*!
+         * Seconds to wait before calling again, as asked by a
+         * Retry-After header of the service, -1 if absent.
+         */
+        long retry_after_s;
+        /*!
+         * Headers of the response, in the order received, empty
+         * unless the connector captures the headers.
+         */
+        http_headers_t http_headers;
+        /*!
+         * True if the service answered 304 and the body comes from
+         * the response cache.
+         */
+        bool from_cache;
 
         /*!
          * \brief Default constructor.
@@ -58,20 +532,118 @@ namespace openair {
          * Perform the move of the object passed as parameter for
          * memory optimization purpose.
          */
-        HttpResponse(const HttpResponse&& response);
+        HttpResponse(HttpResponse&& response);
 
         /*!
          * \brief Default destructor.
          */
         ~HttpResponse();
+
+        /*!
+         * \brief Gets a response header.
+         * \param name - Lower case name of the header.
+         * \return The value of the first header with that name, or an
+         *         empty string.
+         */
+        std::string header(const std::string& name) const;
+    };
+
+   /*!
+    * \brief Classes of failure of a call.
+    */
+    enum CallError {
+        /*! The call completed, whatever its http code. */
+        CALL_OK,
+        /*! The call took longer than allowed. */
+        CALL_TIMEOUT,
+        /*! The name of the service could not be resolved. */
+        CALL_RESOLVE_FAILED,
+        /*! The connection to the service could not be opened. */
+        CALL_CONNECT_FAILED,
+        /*! The TLS handshake or the certificate check failed. */
+        CALL_TLS_FAILED,
+        /*! The connection broke while sending or receiving. */
+        CALL_TRANSFER_FAILED,
+        /*! The call was aborted by a callback or by the connector. */
+        CALL_ABORTED,
+        /*! Any other failure. */
+        CALL_OTHER_ERROR
+    };
+
+   /*!
+    * \brief This structure contains the outcome of a call made
+    *        without exceptions.
+    */
+    struct CallResult {
+        /*! The libcurl CURLcode of the call, zero on success. */
+        int curl_code;
+        /*! Class of the failure, CALL_OK on success. */
+        CallError error;
+        /*! Static message of the failure, NULL on success. */
+        const char *message;
+        /*! Response of the call, meaningful only on success. */
+        HttpResponse response;
+        /*! Number of attempts made, retries included. */
+        unsigned attempts;
+
+        /*! \return True if the call completed. */
+        bool ok() const { return error == CALL_OK; }
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize a successful result with an empty response.
+         */
+        CallResult();
+
+        /*! Move constructor. */
+        CallResult(CallResult&& result);
     };
 
    /*!
     * \brief This class is used to perform http requests through
     *        libcurl.
+    *
+    * Every call method is thread safe: many threads can share one
+    * connector and call it at the same time. Each call leases its own
+    * curl handle from a pool sharded per thread, so concurrent callers
+    * neither share a handle nor wait on a single lock. A pool_size at
+    * least equal to the number of calling threads keeps one warm
+    * connection per thread.
     */
     class CurlServiceConnector {
     public:
+        /*!
+         * Typedefinition of the completion handler of the async
+         * calls. On success error is NULL, otherwise it contains the
+         * curl error message and the response must be ignored.
+         *
+         * The handler runs on the background engine thread, or on
+         * the event loop of the options, so it should return
+         * quickly. A synchronous call made from it is not hedged
+         * and, in HTTP_VERSION_2 mode, not multiplexed: it blocks
+         * the engine on its own connection until it ends.
+         */
+        typedef std::function<void(HttpResponse&& response,
+                                   const char *error)> completion_t;
+
+        /*!
+         * Typedefinition of the producer of a streamed request body.
+         * It is called with a buffer and its capacity, fills it and
+         * returns the number of bytes written: zero ends the body.
+         */
+        typedef std::function<std::size_t(char *buffer,
+                                          std::size_t capacity)>
+            body_producer_t;
+
+        /*!
+         * Typedefinition of the consumer of a streamed response body.
+         * It is called with each chunk of the body as soon as it is
+         * received, and returns false to abort the call.
+         */
+        typedef std::function<bool(const char *data, std::size_t size)>
+            body_sink_t;
+
         /*!
          * \brief Constructor with one parameter.
          * \param address - Address of the service to call.
@@ -81,9 +653,153 @@ namespace openair {
          */    
         explicit CurlServiceConnector(const std::string& address);
 
+        /*!
+         * \brief Constructor with two parameters.
+         * \param address - Address of the service to call.
+         * \param options - Tuning options of the connector.
+         *
+         * Initialize the connector with the address and the options
+         * passed as parameter.
+         */
+        CurlServiceConnector(const std::string& address,
+                             const CurlConnectorOptions& options);
+
+        /*!
+         * \brief Constructor with many service addresses.
+         * \param addresses - Addresses of the same service, at least
+         *                    one and at most 64.
+         * \param options   - Tuning options of the connector.
+         *
+         * Each call is routed to one of the addresses according to
+         * the endpoints policy of the options. The buffered calls
+         * (including the prepared ones) measure the latency, report
+         * the failures and fail over to the other addresses; the
+         * streamed and asynchronous calls only go to the address
+         * chosen when they start. It throws a const char* if no
+         * address is given.
+         */
+        CurlServiceConnector(const std::vector<std::string>& addresses,
+                             const CurlConnectorOptions& options =
+                                 CurlConnectorOptions());
+
         /*! Default destructor. */
         ~CurlServiceConnector();
 
+        /*!
+         * \brief Performs a POST call without throwing.
+         * \param method - Method to call.
+         * \param json   - JSON body of the call.
+         * \return The outcome of the call.
+         *
+         * Same as post_call, but failures are reported in the result
+         * instead of being thrown: a failing call costs no stack
+         * unwinding and its cause can be told apart.
+         */
+        CallResult try_post_call(const std::string& method,
+                                 const std::string& json) const;
+
+        /*!
+         * \brief Performs a POST call with a body not copied, without
+         *        throwing.
+         * \param method - Method to call.
+         * \param data   - First byte of the body.
+         * \param size   - Size of the body in bytes.
+         * \return The outcome of the call.
+         */
+        CallResult try_post_call(const std::string& method,
+                                 const char *data,
+                                 std::size_t size) const;
+
+        /*!
+         * \brief Performs a GET call without throwing.
+         * \param method - Method to call.
+         * \param params - String that contains GET parameters, empty
+         *                 for none.
+         * \return The outcome of the call.
+         */
+        CallResult try_get_call(const std::string& method,
+                                const std::string& params =
+                                    std::string()) const;
+
+        /*!
+         * \brief Performs a POST call with its own deadline, without
+         *        throwing.
+         * \param method   - Method to call.
+         * \param json     - JSON body of the call.
+         * \param deadline - Budget of the call and its retries, it
+         *                   replaces CurlConnectorOptions deadline_ms.
+         * \return The outcome of the call.
+         */
+        CallResult try_post_call(const std::string& method,
+                                 const std::string& json,
+                                 std::chrono::milliseconds deadline)
+            const;
+
+        /*!
+         * \brief Performs a GET call with its own deadline, without
+         *        throwing.
+         * \param method   - Method to call.
+         * \param params   - String that contains GET parameters,
+         *                   empty for none.
+         * \param deadline - Budget of the call and its retries, it
+         *                   replaces CurlConnectorOptions deadline_ms.
+         * \return The outcome of the call.
+         */
+        CallResult try_get_call(const std::string& method,
+                                const std::string& params,
+                                std::chrono::milliseconds deadline)
+            const;
+
+        /*!
+         * \brief Prepares the calls to a method.
+         * \param method  - Method to call.
+         * \param headers - Header lines added to every POST of the
+         *                  prepared call, e.g. "X-Station: 12"; the
+         *                  GET calls do not send them.
+         * \return The prepared call, that must not outlive the
+         *         connector.
+         *
+         * The url and the header lists are built once here, instead
+         * of on each call.
+         */
+        PreparedCall prepare(const std::string& method,
+                             const std::vector<std::string>& headers =
+                                 std::vector<std::string>()) const;
+
+        /*!
+         * \brief Gets the options of the connector.
+         * \return The options passed to the constructor.
+         */
+        const CurlConnectorOptions& options() const;
+
+        /*!
+         * \brief Gets the counters of the hedged GET calls.
+         * \return The counters, all zero when hedging is disabled.
+         */
+        HedgingStats hedging_stats() const;
+
+        /*!
+         * \brief Gets the counters of the response cache.
+         * \return The counters, all zero when the cache is disabled.
+         */
+        ResponseCacheStats cache_stats() const;
+
+        /*!
+         * \brief Gets the number of GET calls that joined an
+         *        identical call in flight.
+         * \return The number of calls, zero when coalescing is
+         *         disabled.
+         */
+        unsigned long long coalesced_calls() const;
+
+        /*!
+         * \brief Gets the state of the service endpoints.
+         * \return One entry per address, in the construction order.
+         *         A connector with one address returns it without
+         *         statistics.
+         */
+        std::vector<EndpointStats> endpoint_stats() const;
+
         /*!
          * Perform a POST http call at the method passed as parameter,
          * to the service specified in the constructor.
@@ -113,6 +829,59 @@ namespace openair {
         HttpResponse post_call(const std::string& method,
                                const std::string& json) const;
 
+        /*!
+         * Perform a POST http call at the method passed as parameter,
+         * to the service specified in the constructor, with the body
+         * passed without copying it.
+         * \param method - Method to call.
+         * \param data   - First byte of the JSON body.
+         * \param size   - Size of the body in bytes.
+         * \return The http response structure.
+         *
+         * The body must stay valid until the method returns. The body
+         * is compressed according to the options, like the std::string
+         * overload. Errors are reported like the other post_call.
+         */
+        HttpResponse post_call(const std::string& method,
+                               const char *data,
+                               std::size_t size) const;
+
+        /*!
+         * Perform a POST http call at the method passed as parameter,
+         * to the service specified in the constructor, with a body
+         * made by the concatenation of the buffers passed.
+         * \param method  - Method to call.
+         * \param buffers - Buffers to send, in order.
+         * \return The http response structure.
+         *
+         * The buffers are sent as they are, without being gathered in
+         * a contiguous copy (and without compression): the request
+         * has a Content-Length equal to the sum of their sizes. The
+         * call follows the retry policy and the deadline, and errors
+         * are reported, like the other post_call.
+         */
+        HttpResponse post_call(const std::string& method,
+                               const std::vector<ConstBuffer>& buffers)
+            const;
+
+        /*!
+         * Perform a POST http call at the method passed as parameter,
+         * to the service specified in the constructor, with a body
+         * pulled from the producer passed.
+         * \param method   - Method to call.
+         * \param producer - Producer of the body.
+         * \return The http response structure.
+         *
+         * The body is sent with chunked transfer encoding, while it
+         * is produced, and without compression. An exception thrown
+         * by the producer aborts the call and is rethrown by this
+         * method. Other errors are reported like the other
+         * post_call. The deadline applies; the call is retried only
+         * when it did not reach the service (see RetryPolicy).
+         */
+        HttpResponse post_call(const std::string& method,
+                               const body_producer_t& producer) const;
+
         /*!
          * Perform a GET http call at the method passed as parameter,
          * to the service specified in the constructor.
@@ -143,7 +912,233 @@ namespace openair {
         HttpResponse get_call(const std::string& method,
                               const std::string& params) const;
 
+        /*!
+         * Perform a GET http call at the method passed as parameter,
+         * to the service specified in the constructor, streaming the
+         * response body to the sink passed.
+         * \param method - Method to call.
+         * \param params - String that contains GET parameters, empty
+         *                 for none.
+         * \param sink   - Consumer of the response body.
+         * \return The http response structure, with an empty body.
+         *
+         * The body is never held in memory: each chunk goes to the
+         * sink as soon as it is received, whatever the http code. If
+         * the sink returns false the call is aborted and a const
+         * char* is thrown; an exception thrown by the sink aborts the
+         * call and is rethrown by this method. The deadline applies;
+         * the call is retried only when it did not reach the service
+         * (see RetryPolicy).
+         */
+        HttpResponse get_call(const std::string& method,
+                              const std::string& params,
+                              const body_sink_t& sink) const;
+
+        /*!
+         * Perform a GET http call at the method passed as parameter,
+         * to the service specified in the constructor, writing the
+         * response body to the stream passed.
+         * \param method - Method to call.
+         * \param params - String that contains GET parameters, empty
+         *                 for none.
+         * \param out    - Stream receiving the response body.
+         * \return The http response structure, with an empty body.
+         *
+         * The call is aborted, throwing a const char*, if the stream
+         * goes in a failed state.
+         */
+        HttpResponse get_call(const std::string& method,
+                              const std::string& params,
+                              std::ostream& out) const;
+
+        /*!
+         * Perform an asynchronous POST http call at the method passed
+         * as parameter, to the service specified in the constructor
+         * with the parameters passed.
+         * \param method - Method to call.
+         * \param json   - JSON parameters to pass to the call.
+         * \return A future that will contain the http response.
+         *
+         * The call is performed by the background engine of the
+         * connector and this method returns immediately. If curl
+         * fails the future rethrows a const char* that contains the
+         * message.
+         */
+        std::future<HttpResponse> post_call_async(
+            const std::string& method, const std::string& json) const;
+
+        /*!
+         * Perform an asynchronous POST http call at the method passed
+         * as parameter, to the service specified in the constructor
+         * with the parameters passed.
+         * \param method     - Method to call.
+         * \param json       - JSON parameters to pass to the call.
+         * \param completion - Handler called when the call ends.
+         *
+         * The completion is called on the background engine thread:
+         * it must not block, since it delays all the other calls in
+         * flight.
+         */
+        void post_call_async(const std::string& method,
+                             const std::string& json,
+                             const completion_t& completion) const;
+
+        /*!
+         * Perform an asynchronous GET http call at the method passed
+         * as parameter, to the service specified in the constructor
+         * with the parameters passed.
+         * \param method - Method to call.
+         * \param params - String that contains GET parameters, empty
+         *                 for none.
+         * \return A future that will contain the http response.
+         *
+         * See post_call_async for the error handling.
+         */
+        std::future<HttpResponse> get_call_async(
+            const std::string& method,
+            const std::string& params = std::string()) const;
+
+        /*!
+         * Perform an asynchronous GET http call at the method passed
+         * as parameter, to the service specified in the constructor
+         * with the parameters passed.
+         * \param method     - Method to call.
+         * \param params     - String that contains GET parameters,
+         *                     empty for none.
+         * \param completion - Handler called when the call ends.
+         *
+         * See post_call_async for the completion constraints.
+         */
+        void get_call_async(const std::string& method,
+                            const std::string& params,
+                            const completion_t& completion) const;
+
     private:
+        friend class PreparedCall;
+
+        /*!
+         * \brief Performs a buffered GET call, with the retry policy
+         *        and without throwing.
+         * \param url      - Complete url of the call.
+         * \param deadline - Budget in milliseconds, zero for none.
+         * \param handles  - Handles of a prepared call, keeping the
+         *                   options of the connector, or NULL to use
+         *                   the pool of the connector.
+         * \return The outcome of the call.
+         */
+        CallResult _get(const std::string& url, long deadline,
+                        const CurlHandlePool *handles = NULL) const;
+
+        /*!
+         * \brief Performs a buffered GET call without coalescing.
+         * \param url      - Complete url of the call.
+         * \param deadline - Budget in milliseconds, zero for none.
+         * \param handles  - See _get.
+         * \return The outcome of the call.
+         */
+        CallResult _perform_get(const std::string& url,
+                                long deadline,
+                                const CurlHandlePool *handles) const;
+
+        /*!
+         * \brief Performs a buffered POST call, with the retry policy
+         *        and without throwing.
+         * \param url      - Complete url of the call.
+         * \param headers  - Header lists of the call.
+         * \param data     - First byte of the body.
+         * \param size     - Size of the body in bytes.
+         * \param deadline - Budget in milliseconds, zero for none.
+         * \param handles  - See _get.
+         * \return The outcome of the call.
+         */
+        CallResult _post(const std::string& url,
+                         const CurlPostHeaders& headers,
+                         const char *data,
+                         std::size_t size,
+                         long deadline,
+                         const CurlHandlePool *handles = NULL) const;
+
+        /*!
+         * \brief Performs the attempts of a call.
+         * \param url        - Complete url of the call.
+         * \param idempotent - True if the call can be sent again after
+         *                     a failure on another endpoint.
+         * \param streamed   - True if the body, sent or received, is
+         *                     streamed: the call is then sent again
+         *                     only when it never reached the service.
+         * \param attempt    - Performs one attempt: called with the
+         *                     url and the milliseconds left (zero for
+         *                     none), it returns the outcome.
+         * \param deadline   - Budget in milliseconds, zero for none.
+         * \return The outcome of the last attempt.
+         *
+         * A template, so that the attempt of each call is not copied
+         * in a std::function. It is only used, and defined, in the
+         * library.
+         */
+        template <typename Attempt>
+        CallResult _with_retries(const std::string& url,
+                                 bool idempotent,
+                                 bool streamed,
+                                 const Attempt& attempt,
+                                 long deadline) const;
+
+        /*!
+         * \brief Performs an attempt on the endpoints, failing over
+         *        to the next one when allowed.
+         * \param url        - Complete url of the call.
+         * \param idempotent - See _with_retries.
+         * \param attempt    - Performs one attempt.
+         * \param left       - Returns the milliseconds left to the
+         *                     call, zero for none.
+         * \return The outcome of the last endpoint tried.
+         */
+        template <typename Attempt, typename Left>
+        CallResult _fail_over(const std::string& url,
+                              bool idempotent,
+                              const Attempt& attempt,
+                              const Left& left) const;
+
+        /*!
+         * \brief Routes an url to the best endpoint.
+         * \param url - Url built on the first address.
+         * \return The url on the chosen endpoint.
+         */
+        std::string _route(const std::string& url) const;
+
+        /*!
+         * \brief Performs one hedged attempt of a GET call.
+         * \param url    - Complete url of the call.
+         * \param cached - Cached response to revalidate, or NULL.
+         * \param left   - Milliseconds left to the call, zero for
+         *                 none.
+         * \return The outcome of the first request answering, or of
+         *         the last failing when none answers.
+         *
+         * The requests run on the background engine, so a call from a
+         * completion handler is never hedged.
+         */
+        CallResult _hedged_get(
+            const std::string& url,
+            const std::shared_ptr<const CachedResponse>& cached,
+            long left) const;
+
+        /*!
+         * \brief Gets the background engine, starting it on the first
+         *        use.
+         * \return The engine that performs the async calls.
+         */
+        CurlMultiEngine& _get_engine() const;
+
+        /*!
+         * \brief Gets the engine performing the synchronous calls.
+         * \return The background engine in HTTP_VERSION_2 mode, so
+         *         that the calls multiplex their requests on the
+         *         shared connections; NULL otherwise, or when called
+         *         from the engine thread (a completion handler), the
+         *         call then blocking on its own handle.
+         */
+        CurlMultiEngine *_sync_engine() const;
 
         /*!
          * \brief Gets the url from method string.
@@ -176,8 +1171,147 @@ namespace openair {
         /*! Private not implemented */
         CurlServiceConnector(const CurlServiceConnector&&);
 
-        /*! Host address to call. */
+        /*! Host address to call, the first one with many. */
         std::string _address;
+
+        /*! Tuning options. */
+        CurlConnectorOptions _options;
+
+        /*!
+         * Pool of curl handles reused between calls, to keep the
+         * connections to the service alive.
+         */
+        std::unique_ptr<CurlHandlePool> _pool;
+
+        /*! Header lists of the POST calls, built once. */
+        std::unique_ptr<CurlPostHeaders> _headers;
+
+        /*! Delay and budget of the hedged calls, NULL if disabled. */
+        std::unique_ptr<HedgeController> _hedge;
+
+        /*! Response cache of the GET calls, NULL if disabled. */
+        std::unique_ptr<ResponseCache> _cache;
+
+        /*! GET calls in flight, NULL if coalescing is disabled. */
+        std::unique_ptr<SingleFlight> _flights;
+
+        /*! Endpoints of the service, NULL with a single address. */
+        std::unique_ptr<EndpointSet> _endpoints;
+
+        /*! Flag used to start the background engine once. */
+        mutable std::once_flag _engine_flag;
+
+        /*! Background engine performing the async calls. */
+        mutable std::unique_ptr<CurlMultiEngine> _engine;
+    };
+
+   /*!
+    * \brief Calls to a method of the service, prepared once.
+    *
+    * A prepared call keeps the url of its method, the header lists
+    * of its POST calls and its own pool of curl handles, set up once
+    * with the options of the connector and never reset: each call
+    * only hands the url, the body and the response to curl, and goes
+    * through the retry policy, the deadline and the features of the
+    * connector as its plain calls do. The handles keep their own
+    * connections to the service. It is created by
+    * CurlServiceConnector::prepare and, like the connector, can be
+    * used by many threads at the same time.
+    *
+    * The fixed headers are sent by the POST calls only: the GET calls
+    * are sent as CurlServiceConnector::get_call sends them.
+    */
+    class PreparedCall {
+    public:
+        /*! Move constructor. */
+        PreparedCall(PreparedCall&& other);
+
+        /*! Default destructor. */
+        ~PreparedCall();
+
+        /*!
+         * \brief Performs a POST call.
+         * \param json - JSON body of the call.
+         * \return The http response structure.
+         *
+         * It throws a const char* as CurlServiceConnector::post_call.
+         */
+        HttpResponse post(const std::string& json) const;
+
+        /*!
+         * \brief Performs a POST call with a body not copied.
+         * \param data - First byte of the body.
+         * \param size - Size of the body in bytes.
+         * \return The http response structure.
+         */
+        HttpResponse post(const char *data, std::size_t size) const;
+
+        /*!
+         * \brief Performs a GET call without parameters.
+         * \return The http response structure.
+         *
+         * The fixed headers of the prepared call are not sent.
+         */
+        HttpResponse get() const;
+
+        /*!
+         * \brief Performs a GET call.
+         * \param params - String that contains GET parameters.
+         * \return The http response structure.
+         */
+        HttpResponse get(const std::string& params) const;
+
+        /*!
+         * \brief Performs a POST call without throwing.
+         * \param json - JSON body of the call.
+         * \return The outcome of the call.
+         */
+        CallResult try_post(const std::string& json) const;
+
+        /*!
+         * \brief Performs a POST call with a body not copied, without
+         *        throwing.
+         * \param data - First byte of the body.
+         * \param size - Size of the body in bytes.
+         * \return The outcome of the call.
+         */
+        CallResult try_post(const char *data, std::size_t size) const;
+
+        /*!
+         * \brief Performs a GET call without throwing.
+         * \param params - String that contains GET parameters, empty
+         *                 for none.
+         * \return The outcome of the call.
+         */
+        CallResult try_get(const std::string& params =
+                               std::string()) const;
+
+    private:
+        friend class CurlServiceConnector;
+
+        PreparedCall(const CurlServiceConnector& connector,
+                     const std::string& url,
+                     const std::vector<std::string>& headers);
+
+        /*! Private not implemented */
+        PreparedCall(const PreparedCall&);
+        /*! Private not implemented */
+        PreparedCall& operator=(const PreparedCall&);
+
+        /*! Connector performing the calls. */
+        const CurlServiceConnector *_connector;
+
+        /*! Url of the method. */
+        std::string _url;
+
+        /*! Header lists of the POST calls. */
+        std::unique_ptr<CurlPostHeaders> _headers;
+
+        /*!
+         * Handles of the calls, set up once with the options of the
+         * connector and never reset.
+         */
+        std::unique_ptr<CurlHandlePool> _handles;
     };
 }
 #endif
@@ -0,0 +1,167 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      event_loop.hh
+ * \brief     This file contains the interfaces used to drive the
+ *            connector from an event loop of the application.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the definition of the event loop interface a
+ * CurlServiceConnector hands its sockets and timer to, when it is
+ * created with CurlConnectorOptions event_loop, and of EpollLoop, a
+ * reference implementation on Linux epoll.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+
+#ifndef EVENT_LOOP_INCLUDE_GUARD_HH
+#define EVENT_LOOP_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Events of a socket, combined as bit flags.
+    */
+    enum SocketEvents {
+        /*! No event: the socket is no longer watched. */
+        SOCKET_NONE = 0,
+        /*! The socket is readable. */
+        SOCKET_READ = 1,
+        /*! The socket is writable. */
+        SOCKET_WRITE = 2,
+        /*! The socket is in error. */
+        SOCKET_ERROR = 4
+    };
+
+   /*!
+    * \brief Receiver of the events of an event loop.
+    *
+    * It is implemented by the library: the loop calls it back when
+    * a watched socket is ready or the scheduled timer expires.
+    */
+    class EventLoopClient {
+    public:
+        /*! Default destructor. */
+        virtual ~EventLoopClient();
+
+        /*!
+         * \brief Handles the readiness of a watched socket.
+         * \param fd     - The socket.
+         * \param events - The SocketEvents that occurred.
+         */
+        virtual void on_socket(int fd, int events) = 0;
+
+        /*! Handles the expiration of the scheduled timer. */
+        virtual void on_timeout() = 0;
+    };
+
+   /*!
+    * \brief Event loop of the application.
+    *
+    * It is implemented by the application to drive the connector
+    * from its own loop (epoll, io_uring, ...) without any thread of
+    * the library. Every method is called on the loop thread, and the
+    * callbacks of the client must be called on it too.
+    */
+    class EventLoop {
+    public:
+        /*! Default destructor. */
+        virtual ~EventLoop();
+
+        /*!
+         * \brief Changes the events watched on a socket.
+         * \param client - Client to call back.
+         * \param fd     - The socket.
+         * \param events - SOCKET_READ and/or SOCKET_WRITE to watch,
+         *                 SOCKET_NONE to stop watching the socket.
+         */
+        virtual void watch(EventLoopClient& client, int fd,
+                           int events) = 0;
+
+        /*!
+         * \brief Schedules the timer of a client, replacing the
+         *        previous one.
+         * \param client     - Client to call back.
+         * \param timeout_ms - Milliseconds before on_timeout is
+         *                     called, zero for as soon as possible,
+         *                     -1 to cancel the timer.
+         */
+        virtual void schedule(EventLoopClient& client,
+                              long timeout_ms) = 0;
+    };
+
+   /*!
+    * \brief Reference event loop on Linux epoll.
+    *
+    * A single threaded loop: sockets are dispatched from epoll_wait
+    * and timers are kept in memory, so no other thread nor file
+    * descriptor is needed. Applications with their own loop can use
+    * it as the model of their EventLoop implementation.
+    */
+    class EpollLoop : public EventLoop {
+    public:
+        /*!
+         * \brief Default constructor.
+         *
+         * It throws a const char* if the epoll instance can not be
+         * created.
+         */
+        EpollLoop();
+
+        /*! Closes the epoll instance. */
+        ~EpollLoop();
+
+        void watch(EventLoopClient& client, int fd, int events);
+        void schedule(EventLoopClient& client, long timeout_ms);
+
+        /*!
+         * \brief Waits for events and dispatches them.
+         * \param max_wait_ms - Maximum wait in milliseconds, zero to
+         *                      only dispatch what is ready.
+         * \return The number of callbacks called.
+         */
+        std::size_t run_once(long max_wait_ms);
+
+        /*!
+         * \brief Dispatches events until a condition holds or
+         *        nothing is left to wait for.
+         * \param done - Condition checked after each dispatch.
+         */
+        void run_until(const std::function<bool()>& done);
+
+        /*! \return True if no socket is watched and no timer set. */
+        bool empty() const;
+
+    private:
+        typedef std::chrono::steady_clock clock;
+
+        long _next_timeout(long max_wait_ms) const;
+        std::size_t _fire_timers();
+
+        EpollLoop(const EpollLoop&);
+        EpollLoop& operator=(const EpollLoop&);
+
+        int _epoll;
+        std::unordered_map<int, EventLoopClient*> _sockets;
+        std::unordered_map<EventLoopClient*, clock::time_point> _timers;
+    };
+}
+#endif
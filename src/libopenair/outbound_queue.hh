@@ -0,0 +1,207 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      outbound_queue.hh
+ * \brief     This file contains the durable store-and-forward queue.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the definition of the queue that persists the
+ * outgoing POST calls in the sqlite3 database of the configuration
+ * (ConfigurationData::database_path) and replays them, in order, when
+ * the service is reachable.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "curl_service_connector.hh"
+
+#ifndef OUTBOUND_QUEUE_INCLUDE_GUARD_HH
+#define OUTBOUND_QUEUE_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+    class SqliteDatabase;
+    class SqliteStatement;
+
+   /*!
+    * \brief This structure contains the tuning options of the queue.
+    */
+    struct OutboundQueueOptions {
+        /*!
+         * Maximum time, in milliseconds, an enqueued call stays in
+         * memory before being committed to the database. Calls
+         * enqueued in this window are written with one transaction.
+         */
+        long commit_interval_ms;
+
+        /*! Maximum number of calls read from the database at once. */
+        std::size_t drain_batch;
+
+        /*!
+         * Milliseconds to wait before retrying when the service is
+         * not reachable.
+         */
+        long retry_interval_ms;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with their default values: 50 ms of
+         * commit interval, 64 calls per drain batch and 5 seconds of
+         * retry interval.
+         */
+        OutboundQueueOptions();
+    };
+
+   /*!
+    * \brief Durable store-and-forward queue of POST calls.
+    *
+    * Enqueued calls are committed to the outbound_queue table of the
+    * database and replayed in the same order by a background drainer,
+    * that deletes them once the service has accepted them with a 2xx
+    * code. A call that fails with a curl error, a redirect (3xx), a
+    * 408, a 429 or an http code greater or equal to 500 stops the
+    * drain until the retry interval expires, the calls being kept. A
+    * call refused with any other 4xx code will never succeed: it is
+    * dropped and counted.
+    *
+    * It can back the SurveyBatcher error handler, so batches that can
+    * not be sent are kept until the service comes back.
+    */
+    class OutboundQueue {
+    public:
+        /*!
+         * \brief Constructor with three parameters.
+         * \param database_path - Path of the sqlite3 database.
+         * \param connector     - Connector used to replay the calls.
+         *                        It must outlive the queue.
+         * \param options       - Tuning options.
+         *
+         * Opens the database, creates the queue table if missing and
+         * starts the drainer, that replays the calls left by a
+         * previous run. It throws a const char* if the database can
+         * not be opened.
+         */
+        OutboundQueue(const std::string& database_path,
+                      const CurlServiceConnector& connector,
+                      const OutboundQueueOptions& options =
+                          OutboundQueueOptions());
+
+        /*! Closes the queue. */
+        ~OutboundQueue();
+
+        /*!
+         * \brief Enqueues a POST call.
+         * \param method  - Method to call.
+         * \param payload - JSON body of the call.
+         *
+         * The call only appends to an in memory buffer: the drainer
+         * thread commits it within commit_interval_ms. It throws a
+         * const char* if the queue has been closed.
+         */
+        void enqueue(const std::string& method,
+                     const std::string& payload);
+
+        /*!
+         * \brief Waits until every call enqueued before the call is
+         *        committed to the database.
+         *
+         * A failed commit is retried every retry_interval_ms: sync
+         * keeps waiting until it succeeds or the queue is closed.
+         */
+        void sync();
+
+        /*!
+         * \brief Commits the calls still in memory and stops the
+         *        drainer.
+         * \return The number of calls that could not be committed,
+         *         and are lost.
+         *
+         * Calls not yet sent stay in the database for the next run.
+         * Further enqueue calls throw. Closing again returns zero.
+         */
+        std::size_t close();
+
+        /*!
+         * \brief Wakes up the drainer, without waiting for the retry
+         *        interval.
+         */
+        void retry_now();
+
+        /*! \return Number of calls enqueued and not yet sent. */
+        std::size_t size() const;
+
+        /*! \return Number of calls sent successfully. */
+        std::size_t sent() const;
+
+        /*! \return Number of calls dropped because refused. */
+        std::size_t dropped() const;
+
+    private:
+        /*! A call waiting in memory to be committed. */
+        struct Entry {
+            std::string method;
+            std::string payload;
+        };
+
+        void _loop();
+        void _commit(const std::vector<Entry>& entries);
+        bool _drain();
+
+        OutboundQueue(const OutboundQueue&);
+        OutboundQueue& operator=(const OutboundQueue&);
+
+        const CurlServiceConnector& _connector;
+        OutboundQueueOptions _options;
+        std::unique_ptr<SqliteDatabase> _db;
+        std::unique_ptr<SqliteStatement> _insert;
+        std::unique_ptr<SqliteStatement> _select;
+        std::unique_ptr<SqliteStatement> _delete;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _synced;
+        std::vector<Entry> _incoming;
+        std::chrono::steady_clock::time_point _first_incoming;
+        /*! Time of the next commit attempt, after a failed one. */
+        std::chrono::steady_clock::time_point _next_commit;
+        std::chrono::steady_clock::time_point _next_retry;
+        std::size_t _stored;
+        /*! Calls enqueued, and calls committed, since the start. */
+        std::size_t _enqueued;
+        std::size_t _committed;
+        /*! Calls discarded because not committed when closing. */
+        std::size_t _lost;
+        std::size_t _sync_waiters;
+        bool _retry_requested;
+        bool _stopping;
+
+        std::atomic<std::size_t> _size;
+        std::atomic<std::size_t> _sent;
+        std::atomic<std::size_t> _dropped;
+        std::thread _thread;
+    };
+}
+#endif
@@ -0,0 +1,227 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      outbound_scheduler.hh
+ * \brief     This file contains the prioritized, rate limited
+ *            scheduler of outgoing calls.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the definition of the scheduler placed in front
+ * of the connector to share a thin uplink between calls of different
+ * importance: error reports (ConfigurationData send_errors_method)
+ * go before bulk uploads (ConfigurationData send_data_method).
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "curl_service_connector.hh"
+
+#ifndef OUTBOUND_SCHEDULER_INCLUDE_GUARD_HH
+#define OUTBOUND_SCHEDULER_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+    class TokenBucket;
+
+   /*!
+    * \brief Priority classes of the outgoing calls, from the most
+    *        important one.
+    */
+    enum CallPriority {
+        /*! Calls that must not wait, e.g. error reports. */
+        HIGH_PRIORITY,
+        /*! Ordinary calls. */
+        NORMAL_PRIORITY,
+        /*! Bulk calls, e.g. survey uploads and backlog drains. */
+        LOW_PRIORITY,
+        /*! Number of priority classes. */
+        PRIORITY_COUNT
+    };
+
+   /*!
+    * \brief This structure contains the limits of the scheduler.
+    */
+    struct OutboundSchedulerOptions {
+        /*! Requests started per second. Zero disables the limit. */
+        double max_requests_per_second;
+
+        /*! Requests that can be started at once after an idle time. */
+        double burst_requests;
+
+        /*!
+         * Request body bytes sent per second. Zero disables the
+         * limit.
+         */
+        double max_bytes_per_second;
+
+        /*! Bytes that can be sent at once after an idle time. */
+        double burst_bytes;
+
+        /*!
+         * Maximum number of calls in flight. Calls over this limit
+         * wait in their lane, where a more important call can still
+         * overtake them.
+         */
+        std::size_t max_in_flight;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with their default values: no rate
+         * limits (with bursts of 10 requests and 64 KiB when
+         * enabled) and 4 calls in flight.
+         */
+        OutboundSchedulerOptions();
+    };
+
+   /*!
+    * \brief This structure contains the metrics of a priority lane.
+    */
+    struct LaneMetrics {
+        /*! Calls waiting in the lane. */
+        std::size_t depth;
+        /*! Calls started from the lane. */
+        std::size_t dispatched;
+        /*! Mean time, in milliseconds, spent in the lane. */
+        double mean_wait_ms;
+        /*! Longest time, in milliseconds, spent in the lane. */
+        double max_wait_ms;
+
+        /*! \brief Default constructor, all the metrics to zero. */
+        LaneMetrics();
+    };
+
+   /*!
+    * \brief Prioritized, rate limited scheduler of POST calls.
+    *
+    * Calls are queued in one lane per priority and started by a
+    * background thread, always from the most important non empty
+    * lane, in order within a lane. A call starts only when the
+    * token buckets of the requests and of the bytes allow it, and
+    * runs on the connector engine thread.
+    */
+    class OutboundScheduler {
+    public:
+        /*!
+         * \brief Constructor with two parameters.
+         * \param connector - Connector used to perform the calls. It
+         *                    must outlive the scheduler.
+         * \param options   - Limits of the scheduler.
+         *
+         * Starts the background thread that dispatches the calls.
+         * It throws a const char* if the connector is driven by an
+         * EventLoop: its async calls can only be made on the loop
+         * thread.
+         */
+        OutboundScheduler(const CurlServiceConnector& connector,
+                          const OutboundSchedulerOptions& options =
+                              OutboundSchedulerOptions());
+
+        /*!
+         * \brief Destructor.
+         *
+         * Waits for the calls in flight. Calls still queued are not
+         * sent: their completion gets an error, on the thread
+         * destroying the scheduler.
+         */
+        ~OutboundScheduler();
+
+        /*!
+         * \brief Queues a POST call.
+         * \param priority   - Lane of the call.
+         * \param method     - Method to call.
+         * \param json       - JSON body of the call.
+         * \param completion - Handler called with the outcome of the
+         *                     call, on the connector engine thread;
+         *                     for a call still queued when the
+         *                     scheduler is destroyed, on the thread
+         *                     destroying it.
+         */
+        void post_call(CallPriority priority,
+                       const std::string& method,
+                       const std::string& json,
+                       const CurlServiceConnector::completion_t&
+                           completion);
+
+        /*!
+         * \brief Queues a POST call.
+         * \param priority - Lane of the call.
+         * \param method   - Method to call.
+         * \param json     - JSON body of the call.
+         * \return The future response. On failure it holds the
+         *         const char* error.
+         */
+        std::future<HttpResponse> post_call(CallPriority priority,
+                                            const std::string& method,
+                                            const std::string& json);
+
+        /*!
+         * \param priority - Lane to inspect.
+         * \return A snapshot of the metrics of the lane.
+         */
+        LaneMetrics metrics(CallPriority priority) const;
+
+        /*! \return Number of calls started and not yet completed. */
+        std::size_t in_flight() const;
+
+    private:
+        /*! A call waiting in a lane. */
+        struct Call {
+            std::string method;
+            std::string json;
+            CurlServiceConnector::completion_t completion;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        /*! Queue and counters of a priority. */
+        struct Lane {
+            std::deque<Call> calls;
+            std::size_t dispatched;
+            double total_wait_ms;
+            double max_wait_ms;
+        };
+
+        void _loop();
+        void _dispatch(Call& call);
+        void _completed();
+
+        OutboundScheduler(const OutboundScheduler&);
+        OutboundScheduler& operator=(const OutboundScheduler&);
+
+        const CurlServiceConnector& _connector;
+        OutboundSchedulerOptions _options;
+        std::unique_ptr<TokenBucket> _requests;
+        std::unique_ptr<TokenBucket> _bytes;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _idle;
+        Lane _lanes[PRIORITY_COUNT];
+        std::size_t _in_flight;
+        bool _stopping;
+        std::thread _thread;
+    };
+}
+#endif
@@ -0,0 +1,198 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      survey_batcher.hh
+ * \brief     This file contains the batching uploader of surveys.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the definition of the component that gathers
+ * survey records into JSON arrays and uploads them with a single
+ * POST call, to pay the per request cost once for many records.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "curl_service_connector.hh"
+
+#ifndef SURVEY_BATCHER_INCLUDE_GUARD_HH
+#define SURVEY_BATCHER_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief This structure contains the flush thresholds of the
+    *        batcher.
+    *
+    * A batch is sent as soon as one of the thresholds is reached.
+    */
+    struct SurveyBatcherOptions {
+        /*! Maximum number of records in a batch. */
+        std::size_t max_records;
+
+        /*! Maximum size, in bytes, of the JSON array of a batch. */
+        std::size_t max_bytes;
+
+        /*!
+         * Maximum time, in milliseconds, a record waits in the
+         * batcher before being sent.
+         */
+        long max_latency_ms;
+
+        /*!
+         * Maximum number of full batches waiting to be sent. When
+         * it is reached add blocks until a batch is sent.
+         */
+        std::size_t max_pending_batches;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with their default values: 500
+         * records, 256 KiB, 2 seconds and 16 pending batches.
+         */
+        SurveyBatcherOptions();
+    };
+
+   /*!
+    * \brief Batching uploader of survey records.
+    *
+    * Records added to the batcher are JSON values. They are joined in
+    * a JSON array and sent to the method passed to the constructor
+    * by a background thread, in the same order they were added.
+    */
+    class SurveyBatcher {
+    public:
+        /*!
+         * Typedefinition of the handler called when a batch can not
+         * be sent. It receives the JSON array of the batch and the
+         * error message.
+         */
+        typedef std::function<void(const std::string& batch,
+                                   const char *error)> error_handler_t;
+
+        /*!
+         * \brief Constructor with three parameters.
+         * \param connector - Connector used to send the batches. It
+         *                    must outlive the batcher.
+         * \param method    - Method called with the batches (for
+         *                    example ConfigurationData
+         *                    send_data_method).
+         * \param options   - Flush thresholds.
+         *
+         * Starts the background thread that sends the batches.
+         */
+        SurveyBatcher(const CurlServiceConnector& connector,
+                      const std::string& method,
+                      const SurveyBatcherOptions& options =
+                          SurveyBatcherOptions());
+
+        /*!
+         * \brief Destructor.
+         *
+         * Performs a shutdown: pending records are sent before the
+         * batcher is destroyed.
+         */
+        ~SurveyBatcher();
+
+        /*!
+         * \brief Adds a record to the current batch.
+         * \param record - JSON value of the record.
+         *
+         * It throws a const char* if the batcher has been shut down.
+         */
+        void add(const std::string& record);
+
+        /*!
+         * \brief Sends the current batch without waiting for a
+         *        threshold, and waits until it has been sent.
+         */
+        void flush();
+
+        /*!
+         * \brief Sends every pending record and stops the background
+         *        thread. Further add calls throw.
+         */
+        void shutdown();
+
+        /*!
+         * \brief Sets the handler called when a batch can not be
+         *        sent.
+         * \param handler - Handler to call, on the background thread.
+         *
+         * A batch fails if curl fails or the service answers with an
+         * http code outside 2xx, redirects included. Without handler
+         * failed batches are only counted.
+         */
+        void on_error(const error_handler_t& handler);
+
+        /*! \return Number of records added and not yet sent. */
+        std::size_t pending() const;
+
+        /*! \return Number of batches sent successfully. */
+        std::size_t sent_batches() const;
+
+        /*! \return Number of records sent successfully. */
+        std::size_t sent_records() const;
+
+        /*! \return Number of batches that failed. */
+        std::size_t failed_batches() const;
+
+    private:
+        /*! A sealed batch waiting to be sent. */
+        struct Batch {
+            std::string json;
+            std::size_t records;
+        };
+
+        void _loop();
+        void _seal();
+        void _send(Batch& batch);
+
+        SurveyBatcher(const SurveyBatcher&);
+        SurveyBatcher& operator=(const SurveyBatcher&);
+
+        const CurlServiceConnector& _connector;
+        std::string _method;
+        SurveyBatcherOptions _options;
+        error_handler_t _error_handler;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _progress;
+
+        /*! JSON array being filled, without the closing bracket. */
+        std::string _current;
+        std::size_t _current_records;
+        std::chrono::steady_clock::time_point _current_deadline;
+
+        std::deque<Batch> _ready;
+        bool _flush_requested;
+        bool _stopping;
+        std::size_t _sent_batches;
+        std::size_t _sent_records;
+        std::size_t _failed_batches;
+        std::thread _thread;
+    };
+}
+#endif
@@ -0,0 +1,184 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      survey_logger.hh
+ * \brief     This file contains the logger of surveys and errors.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the definition of the component that writes the
+ * survey records and the errors into the sqlite3 database of the
+ * configuration (ConfigurationData::database_path), where the log
+ * operations are performed.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifndef SURVEY_LOGGER_INCLUDE_GUARD_HH
+#define SURVEY_LOGGER_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+    class SqliteDatabase;
+    class SqliteStatement;
+
+   /*!
+    * \brief This structure contains the group commit thresholds of the
+    *        logger.
+    *
+    * The rows are committed as soon as one of the thresholds is
+    * reached.
+    */
+    struct SurveyLoggerOptions {
+        /*! Maximum number of rows written by one transaction. */
+        std::size_t commit_rows;
+
+        /*!
+         * Maximum time, in milliseconds, a logged row waits in memory
+         * before being committed.
+         */
+        long commit_interval_ms;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Initialize the options with their default values: 4096 rows
+         * and 100 ms.
+         */
+        SurveyLoggerOptions();
+    };
+
+   /*!
+    * \brief Logger of survey records and errors.
+    *
+    * Survey records, JSON values, are appended to the survey_log table
+    * and errors to the error_log table, each row with its creation
+    * time in seconds since the epoch. The ids of the rows grow in the
+    * log order, and rows are never deleted by the logger.
+    *
+    * The log calls do not wait for the database: they push the row on
+    * a lock-free queue, emptied by a single writer thread. The writer
+    * inserts the rows with prepared statements, in transactions of up
+    * to commit_rows rows, so the cost of a commit is paid once for
+    * many rows.
+    */
+    class SurveyLogger {
+    public:
+        /*!
+         * \brief Constructor with two parameters.
+         * \param database_path - Path of the sqlite3 database.
+         * \param options       - Group commit thresholds.
+         *
+         * Opens the database, creates the log tables if missing and
+         * starts the writer. It throws a const char* if the database
+         * can not be opened.
+         */
+        explicit SurveyLogger(const std::string& database_path,
+                              const SurveyLoggerOptions& options =
+                                  SurveyLoggerOptions());
+
+        /*!
+         * \brief Destructor.
+         *
+         * Commits the rows still in memory and stops the writer:
+         * rows that can not be committed at this time are lost.
+         */
+        ~SurveyLogger();
+
+        /*!
+         * \brief Logs a survey record.
+         * \param record - JSON value of the record.
+         */
+        void log_survey(const std::string& record);
+
+        /*!
+         * \brief Logs an error.
+         * \param code    - Code of the error, e.g. the http code of a
+         *                  refused call.
+         * \param message - Description of the error.
+         */
+        void log_error(long code, const std::string& message);
+
+        /*!
+         * \brief Waits until every row logged before the call is
+         *        committed to the database.
+         *
+         * It returns without waiting for the rows that can not be
+         * committed, e.g. because the disk is full: they are retried
+         * every commit_interval_ms.
+         */
+        void flush();
+
+        /*! \return Number of rows logged and not yet committed. */
+        std::size_t pending() const;
+
+        /*! \return Number of rows committed. */
+        std::size_t committed() const;
+
+        /*! \return Number of transactions committed. */
+        std::size_t transactions() const;
+
+        /*! \return Number of transactions failed and retried. */
+        std::size_t failures() const;
+
+    private:
+        /*! A row waiting to be committed, linked in the queue. */
+        struct Row {
+            Row *next;
+            bool error;
+            long code;
+            std::int64_t created;
+            std::string text;
+        };
+
+        void _push(Row *row);
+        void _loop();
+        bool _commit(Row *&head);
+
+        SurveyLogger(const SurveyLogger&);
+        SurveyLogger& operator=(const SurveyLogger&);
+
+        SurveyLoggerOptions _options;
+        std::unique_ptr<SqliteDatabase> _db;
+        std::unique_ptr<SqliteStatement> _insert_survey;
+        std::unique_ptr<SqliteStatement> _insert_error;
+
+        /*! Last pushed row: the writer takes the whole list at once. */
+        std::atomic<Row*> _queue;
+        std::atomic<std::size_t> _logged;
+        std::atomic<std::size_t> _committed;
+        std::atomic<std::size_t> _transactions;
+        std::atomic<std::size_t> _failures;
+        std::atomic<bool> _flush_requested;
+        std::atomic<bool> _stopping;
+
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _flushed;
+        /*! Writer passes that served a flush request. */
+        std::size_t _flushes;
+        std::thread _thread;
+    };
+}
+#endif
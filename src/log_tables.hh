@@ -0,0 +1,39 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      log_tables.hh
+ * \brief     Schema of the log tables.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the schema of the tables written by the SurveyLogger and
+ * read by the BacklogReader.
+ */
+
+#ifndef LOG_TABLES_INCLUDE_GUARD_HH
+#define LOG_TABLES_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * Statements creating the survey_log and error_log tables, if
+    * missing. Rows are only appended: their ids grow in the log order.
+    */
+    extern const char *const CREATE_LOG_TABLES;
+}
+#endif
@@ -0,0 +1,300 @@
+#include <ctime>
+#include "libopenair/outbound_queue.hh"
+#include "sqlite_support.hh"
+
+namespace __OUTBOUND_QUEUE_INTERNAL__ {
+    const char *CREATE_TABLE =
+        "CREATE TABLE IF NOT EXISTS outbound_queue ("
+        " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        " method TEXT NOT NULL,"
+        " payload TEXT NOT NULL,"
+        " created INTEGER NOT NULL)";
+
+    const char *INSERT =
+        "INSERT INTO outbound_queue (method, payload, created)"
+        " VALUES (?1, ?2, ?3)";
+
+    const char *SELECT =
+        "SELECT id, method, payload FROM outbound_queue"
+        " ORDER BY id LIMIT ?1";
+
+    const char *DELETE = "DELETE FROM outbound_queue WHERE id = ?1";
+
+    const char *COUNT = "SELECT COUNT(*) FROM outbound_queue";
+
+    /* A call read back from the database. */
+    struct stored_call {
+        std::int64_t id;
+        std::string method;
+        std::string payload;
+    };
+
+    /*
+     * True when the service may accept the call later: a redirect,
+     * a server error, or a 408 or 429 asking the client to resend.
+     */
+    bool retry_later(long http_code) {
+        return (http_code >= 300 && http_code < 400) ||
+            http_code >= 500 || http_code == 408 || http_code == 429;
+    }
+}
+
+openair::OutboundQueueOptions::OutboundQueueOptions()
+    : commit_interval_ms(50),
+      drain_batch(64),
+      retry_interval_ms(5000) { }
+
+openair::OutboundQueue::OutboundQueue(
+    const std::string& database_path,
+    const CurlServiceConnector& connector,
+    const OutboundQueueOptions& options)
+    : _connector(connector),
+      _options(options),
+      _db(new SqliteDatabase(database_path)),
+      _stored(0),
+      _enqueued(0),
+      _committed(0),
+      _lost(0),
+      _sync_waiters(0),
+      _retry_requested(false),
+      _stopping(false),
+      _size(0),
+      _sent(0),
+      _dropped(0) {
+    using namespace __OUTBOUND_QUEUE_INTERNAL__;
+    _db->exec(CREATE_TABLE);
+    _insert.reset(new SqliteStatement(*_db, INSERT));
+    _select.reset(new SqliteStatement(*_db, SELECT));
+    _delete.reset(new SqliteStatement(*_db, DELETE));
+    SqliteStatement count(*_db, COUNT);
+    count.step();
+    _stored = count.column_int64(0);
+    _size = _stored;
+    _next_retry = std::chrono::steady_clock::now();
+    _next_commit = _next_retry;
+    _thread = std::thread(&OutboundQueue::_loop, this);
+}
+
+openair::OutboundQueue::~OutboundQueue() {
+    close();
+}
+
+std::size_t openair::OutboundQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stopping) {
+            return 0;
+        }
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _thread.join();
+    return _lost;
+}
+
+void openair::OutboundQueue::enqueue(const std::string& method,
+                                     const std::string& payload) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stopping) {
+            throw "Outbound queue is closed";
+        }
+        if (_incoming.empty()) {
+            _first_incoming = std::chrono::steady_clock::now();
+        }
+        _incoming.push_back(Entry{method, payload});
+        ++_enqueued;
+    }
+    ++_size;
+    _wake.notify_one();
+}
+
+void openair::OutboundQueue::sync() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    const std::size_t enqueued = _enqueued;
+    ++_sync_waiters;
+    _wake.notify_one();
+    _synced.wait(lock, [this, enqueued]() {
+        return _committed >= enqueued || _stopping;
+    });
+    --_sync_waiters;
+}
+
+void openair::OutboundQueue::retry_now() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _retry_requested = true;
+    }
+    _wake.notify_one();
+}
+
+std::size_t openair::OutboundQueue::size() const {
+    return _size.load();
+}
+
+std::size_t openair::OutboundQueue::sent() const {
+    return _sent.load();
+}
+
+std::size_t openair::OutboundQueue::dropped() const {
+    return _dropped.load();
+}
+
+void openair::OutboundQueue::_loop() {
+    typedef std::chrono::steady_clock clock;
+    const auto commit_interval =
+        std::chrono::milliseconds(_options.commit_interval_ms);
+    const auto retry_interval =
+        std::chrono::milliseconds(_options.retry_interval_ms);
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        auto now = clock::now();
+        // Waiting sync calls commit at once, but not before the retry
+        // delay of a failed commit: closing makes one last attempt.
+        auto commit_at = _first_incoming + commit_interval;
+        if (_sync_waiters > 0) {
+            commit_at = now;
+        }
+        if (commit_at < _next_commit) {
+            commit_at = _next_commit;
+        }
+        if (_stopping) {
+            commit_at = now;
+        }
+        if (!_incoming.empty() && now >= commit_at) {
+            std::vector<Entry> entries;
+            entries.swap(_incoming);
+            lock.unlock();
+            bool committed = true;
+            try {
+                _commit(entries);
+            } catch (const char *) {
+                committed = false;
+            }
+            lock.lock();
+            if (committed) {
+                _stored += entries.size();
+                _committed += entries.size();
+                _synced.notify_all();
+            } else if (_stopping) {
+                _lost += entries.size();
+                _size -= entries.size();
+            } else {
+                // Keep the calls in memory and try again later.
+                entries.insert(entries.end(), _incoming.begin(),
+                               _incoming.end());
+                _incoming.swap(entries);
+                _next_commit = now + retry_interval;
+            }
+            continue;
+        }
+        if (_stopping) {
+            _synced.notify_all();
+            break;
+        }
+        if (_stored > 0 && (_retry_requested || now >= _next_retry)) {
+            _retry_requested = false;
+            lock.unlock();
+            bool reachable = _drain();
+            lock.lock();
+            _next_retry = reachable ? now : clock::now() + retry_interval;
+            continue;
+        }
+        auto deadline = clock::time_point::max();
+        if (!_incoming.empty()) {
+            deadline = commit_at;
+        }
+        if (_stored > 0 && _next_retry < deadline) {
+            deadline = _next_retry;
+        }
+        if (deadline == clock::time_point::max()) {
+            _wake.wait(lock);
+        } else {
+            _wake.wait_until(lock, deadline);
+        }
+    }
+}
+
+void openair::OutboundQueue::_commit(const std::vector<Entry>& entries) {
+    std::int64_t now = std::time(NULL);
+    SqliteTransaction transaction(*_db);
+    for (const auto& entry : entries) {
+        _insert->bind(1, entry.method);
+        _insert->bind(2, entry.payload);
+        _insert->bind(3, now);
+        _insert->step();
+        _insert->reset();
+    }
+    transaction.commit();
+}
+
+bool openair::OutboundQueue::_drain() {
+    using namespace __OUTBOUND_QUEUE_INTERNAL__;
+    std::vector<stored_call> calls;
+    try {
+        _select->bind(1, static_cast<std::int64_t>(_options.drain_batch));
+        while (_select->step()) {
+            calls.push_back(stored_call{_select->column_int64(0),
+                                        _select->column_text(1),
+                                        _select->column_text(2)});
+        }
+        _select->reset();
+    } catch (const char *) {
+        _select->reset();
+        return false;
+    }
+    if (calls.empty()) {
+        // The stored count is ahead of the table: wait the retry
+        // interval instead of selecting again at once.
+        return false;
+    }
+
+    // Calls are deleted once the whole batch has been tried: a crash
+    // in between replays them, so the delivery is at least once.
+    std::size_t done = 0;
+    std::size_t sent = 0;
+    bool reachable = true;
+    for (const auto& call : calls) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_stopping) {
+                break;
+            }
+        }
+        try {
+            HttpResponse response =
+                _connector.post_call(call.method, call.payload);
+            if (retry_later(response.http_code)) {
+                reachable = false;
+                break;
+            }
+            if (response.http_code >= 200 && response.http_code < 300) {
+                ++sent;
+            }
+            ++done;
+        } catch (const char *) {
+            reachable = false;
+            break;
+        }
+    }
+    if (done == 0) {
+        return reachable;
+    }
+    try {
+        SqliteTransaction transaction(*_db);
+        for (std::size_t i = 0; i < done; ++i) {
+            _delete->bind(1, calls[i].id);
+            _delete->step();
+            _delete->reset();
+        }
+        transaction.commit();
+    } catch (const char *) {
+        return false;
+    }
+    _sent += sent;
+    _dropped += done - sent;
+    _size -= done;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stored -= done;
+    return reachable;
+}
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include "libopenair/outbound_scheduler.hh"
+#include "token_bucket.hh"
+
+openair::OutboundSchedulerOptions::OutboundSchedulerOptions()
+    : max_requests_per_second(0),
+      burst_requests(10),
+      max_bytes_per_second(0),
+      burst_bytes(64 * 1024),
+      max_in_flight(4) { }
+
+openair::LaneMetrics::LaneMetrics()
+    : depth(0), dispatched(0), mean_wait_ms(0), max_wait_ms(0) { }
+
+openair::OutboundScheduler::OutboundScheduler(
+    const CurlServiceConnector& connector,
+    const OutboundSchedulerOptions& options)
+    : _connector(connector),
+      _options(options),
+      _requests(new TokenBucket(options.max_requests_per_second,
+                                options.burst_requests)),
+      _bytes(new TokenBucket(options.max_bytes_per_second,
+                             options.burst_bytes)),
+      _in_flight(0),
+      _stopping(false) {
+    if (connector.options().event_loop) {
+        throw "Outbound scheduler needs a connector without event loop";
+    }
+    for (auto& lane : _lanes) {
+        lane.dispatched = 0;
+        lane.total_wait_ms = 0;
+        lane.max_wait_ms = 0;
+    }
+    _thread = std::thread(&OutboundScheduler::_loop, this);
+}
+
+openair::OutboundScheduler::~OutboundScheduler() {
+    std::deque<Call> dropped;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        for (auto& lane : _lanes) {
+            dropped.insert(dropped.end(), lane.calls.begin(),
+                           lane.calls.end());
+            lane.calls.clear();
+        }
+    }
+    _wake.notify_one();
+    _thread.join();
+    for (auto& call : dropped) {
+        if (call.completion) {
+            call.completion(HttpResponse(), "Outbound scheduler stopped");
+        }
+    }
+    // Completions of the calls in flight reach back the scheduler.
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]() { return _in_flight == 0; });
+}
+
+void openair::OutboundScheduler::post_call(
+    CallPriority priority,
+    const std::string& method,
+    const std::string& json,
+    const CurlServiceConnector::completion_t& completion) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stopping) {
+            throw "Outbound scheduler stopped";
+        }
+        _lanes[priority].calls.push_back(
+            Call{method, json, completion,
+                 std::chrono::steady_clock::now()});
+    }
+    _wake.notify_one();
+}
+
+std::future<openair::HttpResponse> openair::OutboundScheduler::post_call(
+    CallPriority priority,
+    const std::string& method,
+    const std::string& json) {
+    auto promise = std::make_shared<std::promise<HttpResponse> >();
+    auto future = promise->get_future();
+    post_call(priority, method, json,
+              [promise](HttpResponse&& response, const char *error) {
+                  if (error) {
+                      promise->set_exception(
+                          std::make_exception_ptr(error));
+                  } else {
+                      promise->set_value(std::move(response));
+                  }
+              });
+    return future;
+}
+
+openair::LaneMetrics openair::OutboundScheduler::metrics(
+    CallPriority priority) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Lane& lane = _lanes[priority];
+    LaneMetrics metrics;
+    metrics.depth = lane.calls.size();
+    metrics.dispatched = lane.dispatched;
+    if (lane.dispatched > 0) {
+        metrics.mean_wait_ms = lane.total_wait_ms / lane.dispatched;
+    }
+    metrics.max_wait_ms = lane.max_wait_ms;
+    return metrics;
+}
+
+std::size_t openair::OutboundScheduler::in_flight() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _in_flight;
+}
+
+void openair::OutboundScheduler::_loop() {
+    typedef std::chrono::steady_clock clock;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stopping) {
+        Lane *lane = NULL;
+        for (auto& candidate : _lanes) {
+            if (!candidate.calls.empty()) {
+                lane = &candidate;
+                break;
+            }
+        }
+        if (!lane || _in_flight >= _options.max_in_flight) {
+            _wake.wait(lock);
+            continue;
+        }
+        auto now = clock::now();
+        const Call& head = lane->calls.front();
+        auto wait = std::max(_requests->wait_time(1, now),
+                             _bytes->wait_time(head.json.size(), now));
+        if (wait > clock::duration::zero()) {
+            // A more important call may arrive in the meantime: pick
+            // the lane again once woken up.
+            _wake.wait_for(lock, wait);
+            continue;
+        }
+        _requests->consume(1, now);
+        _bytes->consume(head.json.size(), now);
+        Call call = std::move(lane->calls.front());
+        lane->calls.pop_front();
+        double waited = std::chrono::duration<double, std::milli>(
+            now - call.queued).count();
+        ++lane->dispatched;
+        lane->total_wait_ms += waited;
+        lane->max_wait_ms = std::max(lane->max_wait_ms, waited);
+        ++_in_flight;
+        lock.unlock();
+        _dispatch(call);
+        lock.lock();
+    }
+}
+
+void openair::OutboundScheduler::_dispatch(Call& call) {
+    auto completion = call.completion;
+    try {
+        _connector.post_call_async(
+            call.method, call.json,
+            [this, completion](HttpResponse&& response,
+                               const char *error) {
+                if (completion) {
+                    completion(std::move(response), error);
+                }
+                _completed();
+            });
+    } catch (const char *error) {
+        if (completion) {
+            completion(HttpResponse(), error);
+        }
+        _completed();
+    }
+}
+
+void openair::OutboundScheduler::_completed() {
+    // Notified under the lock: the destructor may return as soon as
+    // the count reaches zero.
+    std::lock_guard<std::mutex> lock(_mutex);
+    --_in_flight;
+    _wake.notify_one();
+    _idle.notify_all();
+}
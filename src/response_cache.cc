@@ -0,0 +1,221 @@
+#include "response_cache.hh"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace __RESPONSE_CACHE_INTERNAL__ {
+    /* First line of the cache file, with the version of the format. */
+    const char MAGIC[] = "openair-response-cache 1";
+
+    std::shared_ptr<openair::CachedResponse> make_entry(
+        long http_code,
+        const std::string& etag,
+        const std::string& last_modified,
+        const std::string& body) {
+        auto entry = std::make_shared<openair::CachedResponse>();
+        entry->http_code = http_code;
+        entry->etag = etag;
+        entry->last_modified = last_modified;
+        entry->body = body;
+        if (!etag.empty()) {
+            entry->validators.append("If-None-Match: " + etag);
+        }
+        if (!last_modified.empty()) {
+            entry->validators.append("If-Modified-Since: " +
+                                     last_modified);
+        }
+        return entry;
+    }
+
+    /*
+     * Reads a field of the cache file, refusing a size over the
+     * budget of the cache: such an entry was never saved, the file
+     * is corrupt.
+     */
+    bool read_field(std::istream& in, std::size_t size,
+                    std::size_t max_bytes, std::string& field) {
+        if (size > max_bytes) {
+            return false;
+        }
+        field.resize(size);
+        return size == 0 || in.read(&field[0], size);
+    }
+
+    /* True when the response forbids storing it. */
+    bool no_store(const openair::HttpResponse& response) {
+        std::string directives = response.header("cache-control");
+        std::transform(directives.begin(), directives.end(),
+                       directives.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return directives.find("no-store") != std::string::npos;
+    }
+}
+
+std::size_t openair::CachedResponse::size() const {
+    return etag.size() + last_modified.size() + body.size();
+}
+
+openair::ResponseCacheOptions::ResponseCacheOptions()
+    : enabled(false), max_bytes(4 * 1024 * 1024) { }
+
+openair::ResponseCacheStats::ResponseCacheStats()
+    : hits(0), misses(0), evictions(0), entries(0), bytes(0) { }
+
+openair::ResponseCache::ResponseCache(
+    const ResponseCacheOptions& options)
+    : _options(options) {
+    if (!_options.path.empty()) {
+        _load();
+    }
+}
+
+openair::ResponseCache::~ResponseCache() {
+    if (_options.path.empty()) {
+        return;
+    }
+    try {
+        save();
+    } catch (const char *) {
+        // Losing the cache only costs the next calls a full body.
+    }
+}
+
+std::shared_ptr<const openair::CachedResponse>
+openair::ResponseCache::find(const std::string& key) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        return entry_t();
+    }
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->second;
+}
+
+void openair::ResponseCache::update(
+    const std::string& key,
+    const std::shared_ptr<const CachedResponse>& cached,
+    HttpResponse& response) {
+    if (response.http_code == 304 && cached) {
+        response.http_code = cached->http_code;
+        response.http_body = cached->body;
+        response.from_cache = true;
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_stats.hits;
+        return;
+    }
+    entry_t entry;
+    if (response.http_code == 200 &&
+        !__RESPONSE_CACHE_INTERNAL__::no_store(response)) {
+        std::string etag = response.header("etag");
+        std::string last_modified = response.header("last-modified");
+        if (!etag.empty() || !last_modified.empty()) {
+            entry = __RESPONSE_CACHE_INTERNAL__::make_entry(
+                response.http_code, etag, last_modified,
+                response.http_body);
+        }
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.misses;
+    if (response.http_code != 200) {
+        // An error does not tell whether the cached body is stale.
+        return;
+    }
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        _erase(it->second);
+    }
+    if (entry) {
+        _insert(key, entry);
+    }
+}
+
+void openair::ResponseCache::save() const {
+    const std::string temporary = _options.path + ".tmp";
+    {
+        std::ofstream out(temporary.c_str(),
+                          std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw "Unable to write the response cache";
+        }
+        out << __RESPONSE_CACHE_INTERNAL__::MAGIC << '\n';
+        std::lock_guard<std::mutex> lock(_mutex);
+        // The least recently used first, so loading in file order
+        // rebuilds the same recency.
+        for (auto it = _lru.rbegin(); it != _lru.rend(); ++it) {
+            const CachedResponse& entry = *it->second;
+            out << it->first.size() << ' ' << entry.etag.size() << ' '
+                << entry.last_modified.size() << ' '
+                << entry.body.size() << ' ' << entry.http_code << '\n'
+                << it->first << entry.etag << entry.last_modified
+                << entry.body;
+        }
+        if (!out.flush()) {
+            throw "Unable to write the response cache";
+        }
+    }
+    // The old file is replaced only by a complete one.
+    if (std::rename(temporary.c_str(), _options.path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw "Unable to write the response cache";
+    }
+}
+
+openair::ResponseCacheStats openair::ResponseCache::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+}
+
+void openair::ResponseCache::_load() {
+    std::ifstream in(_options.path.c_str(), std::ios::binary);
+    std::string line;
+    if (!std::getline(in, line) ||
+        line != __RESPONSE_CACHE_INTERNAL__::MAGIC) {
+        return;
+    }
+    std::size_t key_size, etag_size, modified_size, body_size;
+    long http_code;
+    std::string key, etag, last_modified, body;
+    while (in >> key_size >> etag_size >> modified_size >> body_size
+              >> http_code && in.get() == '\n') {
+        using __RESPONSE_CACHE_INTERNAL__::read_field;
+        const std::size_t limit = _options.max_bytes;
+        if (!read_field(in, key_size, limit, key) ||
+            !read_field(in, etag_size, limit, etag) ||
+            !read_field(in, modified_size, limit, last_modified) ||
+            !read_field(in, body_size, limit, body)) {
+            // A truncated or corrupt entry ends the file.
+            return;
+        }
+        auto it = _index.find(key);
+        if (it != _index.end()) {
+            _erase(it->second);
+        }
+        _insert(key, __RESPONSE_CACHE_INTERNAL__::make_entry(
+                         http_code, etag, last_modified, body));
+    }
+}
+
+void openair::ResponseCache::_insert(const std::string& key,
+                                     entry_t entry) {
+    const std::size_t size = key.size() + entry->size();
+    if (size > _options.max_bytes) {
+        return;
+    }
+    while (!_lru.empty() && _stats.bytes + size > _options.max_bytes) {
+        _erase(std::prev(_lru.end()));
+        ++_stats.evictions;
+    }
+    _lru.emplace_front(key, std::move(entry));
+    _index[key] = _lru.begin();
+    _stats.bytes += size;
+    ++_stats.entries;
+}
+
+void openair::ResponseCache::_erase(lru_t::iterator it) {
+    _stats.bytes -= it->first.size() + it->second->size();
+    --_stats.entries;
+    _index.erase(it->first);
+    _lru.erase(it);
+}
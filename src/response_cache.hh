@@ -0,0 +1,134 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      response_cache.hh
+ * \brief     LRU cache of the GET responses.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the cache of the conditional GET calls of the connector:
+ * the responses with an ETag or a Last-Modified header, with the
+ * conditional headers that revalidate them.
+ */
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "curl_post_headers.hh"
+#include "libopenair/curl_service_connector.hh"
+
+#ifndef RESPONSE_CACHE_INCLUDE_GUARD_HH
+#define RESPONSE_CACHE_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief A cached response, never changed once stored.
+    */
+    struct CachedResponse {
+        /*! Http code of the response. */
+        long http_code;
+        /*! Value of the ETag header, empty if absent. */
+        std::string etag;
+        /*! Value of the Last-Modified header, empty if absent. */
+        std::string last_modified;
+        /*! Body of the response. */
+        std::string body;
+        /*!
+         * If-None-Match and If-Modified-Since headers, built once
+         * and sent by every call revalidating the response.
+         */
+        CurlHeaderList validators;
+
+        /*! \return The bytes counted against the cache budget. */
+        std::size_t size() const;
+    };
+
+   /*!
+    * \brief Thread safe LRU cache of the GET responses.
+    *
+    * Entries are shared pointers: a call keeps the entry it
+    * revalidates even if it is evicted meanwhile.
+    */
+    class ResponseCache {
+    public:
+        /*!
+         * \brief Constructor with one parameter.
+         * \param options - Options of the cache. When a path is
+         *                  given, the entries saved there are
+         *                  loaded: a missing or damaged file starts
+         *                  an empty cache.
+         */
+        explicit ResponseCache(const ResponseCacheOptions& options);
+
+        /*! Saves the entries to the path of the options, if any. */
+        ~ResponseCache();
+
+        /*!
+         * \brief Finds the response of a call.
+         * \param key - Key of the call.
+         * \return The cached response or NULL.
+         */
+        std::shared_ptr<const CachedResponse> find(
+            const std::string& key);
+
+        /*!
+         * \brief Updates the cache with the response of a call.
+         * \param key      - Key of the call.
+         * \param cached   - Response revalidated by the call, or NULL.
+         * \param response - Response of the call. On a 304 it gets
+         *                   the cached body and code.
+         */
+        void update(const std::string& key,
+                    const std::shared_ptr<const CachedResponse>& cached,
+                    HttpResponse& response);
+
+        /*!
+         * \brief Saves the entries to the path of the options.
+         *
+         * The file is replaced atomically. It throws a const char* if
+         * the file can not be written.
+         */
+        void save() const;
+
+        /*! \return A snapshot of the counters. */
+        ResponseCacheStats stats() const;
+
+    private:
+        typedef std::shared_ptr<const CachedResponse> entry_t;
+        typedef std::list<std::pair<std::string, entry_t> > lru_t;
+
+        void _load();
+        void _insert(const std::string& key, entry_t entry);
+        void _erase(lru_t::iterator it);
+
+        ResponseCache(const ResponseCache&);
+        ResponseCache& operator=(const ResponseCache&);
+
+        ResponseCacheOptions _options;
+        mutable std::mutex _mutex;
+        /*! Entries, the most recently used first. */
+        lru_t _lru;
+        std::unordered_map<std::string, lru_t::iterator> _index;
+        ResponseCacheStats _stats;
+    };
+}
+#endif
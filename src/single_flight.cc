@@ -0,0 +1,111 @@
+#include <chrono>
+#include <curl/curl.h>
+#include "single_flight.hh"
+
+namespace __SINGLE_FLIGHT_INTERNAL__ {
+    openair::CallResult copy(const openair::CallResult& result) {
+        openair::CallResult copied;
+        copied.curl_code = result.curl_code;
+        copied.error = result.error;
+        copied.message = result.message;
+        copied.attempts = result.attempts;
+        openair::HttpResponse& response = copied.response;
+        response.http_code = result.response.http_code;
+        response.http_body = result.response.http_body;
+        response.timing = result.response.timing;
+        response.http_version = result.response.http_version;
+        response.retry_after_s = result.response.retry_after_s;
+        response.http_headers = result.response.http_headers;
+        response.from_cache = result.response.from_cache;
+        return copied;
+    }
+
+    openair::CallResult failure(CURLcode code, openair::CallError error,
+                                const char *message) {
+        openair::CallResult result;
+        result.curl_code = code;
+        result.error = error;
+        result.message = message;
+        return result;
+    }
+}
+
+struct openair::SingleFlight::Flight {
+    std::condition_variable ended;
+    bool done;
+    /* Callers waiting for the result, set while the key is mapped. */
+    unsigned waiters;
+    std::unique_ptr<CallResult> result;
+
+    Flight() : done(false), waiters(0) { }
+};
+
+openair::SingleFlight::SingleFlight() : _coalesced(0) { }
+
+openair::CallResult openair::SingleFlight::run(const std::string& key,
+                                               long deadline,
+                                               const call_t& call) {
+    using namespace __SINGLE_FLIGHT_INTERNAL__;
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _flights.find(key);
+    if (it != _flights.end()) {
+        std::shared_ptr<Flight> flight = it->second;
+        ++flight->waiters;
+        ++_coalesced;
+        auto ended = [&flight]() { return flight->done; };
+        if (deadline <= 0) {
+            flight->ended.wait(lock, ended);
+        } else if (!flight->ended.wait_for(
+                       lock, std::chrono::milliseconds(deadline),
+                       ended)) {
+            --flight->waiters;
+            return failure(CURLE_OPERATION_TIMEDOUT, CALL_TIMEOUT,
+                           curl_easy_strerror(CURLE_OPERATION_TIMEDOUT));
+        }
+        return copy(*flight->result);
+    }
+    auto flight = std::make_shared<Flight>();
+    _flights.emplace(key, flight);
+    lock.unlock();
+
+    // The joining callers are released whatever happens to the call.
+    bool landed = false;
+    try {
+        CallResult result = call();
+        landed = true;
+        return _land(key, flight, std::move(result));
+    } catch (const char *error) {
+        if (!landed) {
+            _land(key, flight,
+                  failure(CURLE_FAILED_INIT, CALL_OTHER_ERROR, error));
+        }
+        throw;
+    } catch (...) {
+        if (!landed) {
+            _land(key, flight,
+                  failure(CURLE_FAILED_INIT, CALL_OTHER_ERROR,
+                          "Unable to perform the call"));
+        }
+        throw;
+    }
+}
+
+openair::CallResult openair::SingleFlight::_land(
+    const std::string& key, const std::shared_ptr<Flight>& flight,
+    CallResult&& result) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _flights.erase(key);
+    if (flight->waiters == 0) {
+        // Nobody is waiting: the result is not copied.
+        return std::move(result);
+    }
+    flight->result.reset(new CallResult(std::move(result)));
+    flight->done = true;
+    flight->ended.notify_all();
+    return __SINGLE_FLIGHT_INTERNAL__::copy(*flight->result);
+}
+
+unsigned long long openair::SingleFlight::coalesced() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _coalesced;
+}
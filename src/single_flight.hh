@@ -0,0 +1,90 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      single_flight.hh
+ * \brief     Coalescing of identical concurrent calls.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the group of in flight GET calls of the connector, used to
+ * share one transfer among the identical calls made at the same time.
+ */
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "libopenair/curl_service_connector.hh"
+
+#ifndef SINGLE_FLIGHT_INCLUDE_GUARD_HH
+#define SINGLE_FLIGHT_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Thread safe group of in flight calls.
+    *
+    * The first caller of a key performs the call; the callers of the
+    * same key arriving before it ends wait and get a copy of its
+    * result. Once the call ends the key is free again, so results are
+    * never reused by later calls.
+    */
+    class SingleFlight {
+    public:
+        /*! Typedefinition of the call performed once per flight. */
+        typedef std::function<CallResult()> call_t;
+
+        /*! Default constructor. */
+        SingleFlight();
+
+        /*!
+         * \brief Performs a call or joins the identical one in flight.
+         * \param key      - Key of the call.
+         * \param deadline - Milliseconds a joining caller waits for
+         *                   the result, zero for no limit. When they
+         *                   expire it gets a CALL_TIMEOUT result.
+         * \param call     - Performs the call, run by the first
+         *                   caller only. If it throws, the exception
+         *                   reaches the first caller and the others
+         *                   get a CALL_OTHER_ERROR result.
+         * \return The result of the call.
+         */
+        CallResult run(const std::string& key, long deadline,
+                       const call_t& call);
+
+        /*! \return The number of calls that joined another one. */
+        unsigned long long coalesced() const;
+
+    private:
+        struct Flight;
+
+        CallResult _land(const std::string& key,
+                         const std::shared_ptr<Flight>& flight,
+                         CallResult&& result);
+
+        SingleFlight(const SingleFlight&);
+        SingleFlight& operator=(const SingleFlight&);
+
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, std::shared_ptr<Flight> > _flights;
+        unsigned long long _coalesced;
+    };
+}
+#endif
@@ -0,0 +1,112 @@
+#include "sqlite_support.hh"
+
+namespace __SQLITE_SUPPORT_INTERNAL__ {
+    void check(int code) {
+        if (code != SQLITE_OK) {
+            throw sqlite3_errstr(code);
+        }
+    }
+}
+
+openair::SqliteDatabase::SqliteDatabase(const std::string& path)
+    : _db(NULL) {
+    int code = sqlite3_open_v2(
+        path.c_str(), &_db,
+        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE |
+        SQLITE_OPEN_NOMUTEX, NULL);
+    if (code != SQLITE_OK) {
+        sqlite3_close(_db);
+        throw sqlite3_errstr(code);
+    }
+    sqlite3_busy_timeout(_db, 5000);
+    try {
+        exec("PRAGMA journal_mode=WAL;"
+             "PRAGMA synchronous=NORMAL;");
+    } catch (...) {
+        sqlite3_close(_db);
+        throw;
+    }
+}
+
+openair::SqliteDatabase::~SqliteDatabase() {
+    sqlite3_close(_db);
+}
+
+void openair::SqliteDatabase::exec(const char *sql) {
+    __SQLITE_SUPPORT_INTERNAL__::check(
+        sqlite3_exec(_db, sql, NULL, NULL, NULL));
+}
+
+openair::SqliteStatement::SqliteStatement(SqliteDatabase& db,
+                                          const char *sql)
+    : _stmt(NULL) {
+    __SQLITE_SUPPORT_INTERNAL__::check(
+        sqlite3_prepare_v2(db.get(), sql, -1, &_stmt, NULL));
+}
+
+openair::SqliteStatement::~SqliteStatement() {
+    sqlite3_finalize(_stmt);
+}
+
+void openair::SqliteStatement::bind(int index, const char *value,
+                                    std::size_t size) {
+    __SQLITE_SUPPORT_INTERNAL__::check(
+        sqlite3_bind_text64(_stmt, index, value, size, SQLITE_STATIC,
+                            SQLITE_UTF8));
+}
+
+void openair::SqliteStatement::bind(int index,
+                                    const std::string& value) {
+    bind(index, value.data(), value.size());
+}
+
+void openair::SqliteStatement::bind(int index, std::int64_t value) {
+    __SQLITE_SUPPORT_INTERNAL__::check(
+        sqlite3_bind_int64(_stmt, index, value));
+}
+
+bool openair::SqliteStatement::step() {
+    int code = sqlite3_step(_stmt);
+    if (code == SQLITE_ROW) {
+        return true;
+    }
+    if (code == SQLITE_DONE) {
+        return false;
+    }
+    sqlite3_reset(_stmt);
+    throw sqlite3_errstr(code);
+}
+
+void openair::SqliteStatement::reset() {
+    sqlite3_reset(_stmt);
+    sqlite3_clear_bindings(_stmt);
+}
+
+std::int64_t openair::SqliteStatement::column_int64(int index) const {
+    return sqlite3_column_int64(_stmt, index);
+}
+
+std::string openair::SqliteStatement::column_text(int index) const {
+    const unsigned char *text = sqlite3_column_text(_stmt, index);
+    if (!text) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<const char*>(text),
+                       sqlite3_column_bytes(_stmt, index));
+}
+
+openair::SqliteTransaction::SqliteTransaction(SqliteDatabase& db)
+    : _db(db), _done(false) {
+    _db.exec("BEGIN IMMEDIATE");
+}
+
+openair::SqliteTransaction::~SqliteTransaction() {
+    if (!_done) {
+        sqlite3_exec(_db.get(), "ROLLBACK", NULL, NULL, NULL);
+    }
+}
+
+void openair::SqliteTransaction::commit() {
+    _db.exec("COMMIT");
+    _done = true;
+}
@@ -0,0 +1,168 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      sqlite_support.hh
+ * \brief     Thin RAII wrappers over the sqlite3 C API.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the helpers used by the components that store data in the
+ * configured sqlite3 database. Errors are reported by throwing a
+ * const char* with the sqlite3 message of the error code.
+ */
+
+#include <cstdint>
+#include <string>
+#include <sqlite3.h>
+
+#ifndef SQLITE_SUPPORT_INCLUDE_GUARD_HH
+#define SQLITE_SUPPORT_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Owned sqlite3 connection.
+    */
+    class SqliteDatabase {
+    public:
+        /*!
+         * \brief Constructor with one parameter.
+         * \param path - Path of the database, created if missing.
+         *
+         * Opens the database in WAL mode with synchronous NORMAL: a
+         * commit costs no fsync and the database survives process
+         * crashes. It throws a const char* on failure.
+         */
+        explicit SqliteDatabase(const std::string& path);
+
+        /*! Closes the connection. */
+        ~SqliteDatabase();
+
+        /*!
+         * \brief Executes one or more SQL statements without
+         *        results.
+         * \param sql - Statements to execute.
+         */
+        void exec(const char *sql);
+
+        /*! \return The raw connection. */
+        sqlite3 *get() const { return _db; }
+
+    private:
+        SqliteDatabase(const SqliteDatabase&);
+        SqliteDatabase& operator=(const SqliteDatabase&);
+
+        sqlite3 *_db;
+    };
+
+   /*!
+    * \brief Prepared statement, meant to be prepared once and reused.
+    */
+    class SqliteStatement {
+    public:
+        /*!
+         * \brief Constructor with two parameters.
+         * \param db  - Database owning the statement.
+         * \param sql - SQL of the statement.
+         */
+        SqliteStatement(SqliteDatabase& db, const char *sql);
+
+        /*! Finalizes the statement. */
+        ~SqliteStatement();
+
+        /*!
+         * \brief Binds a text parameter, without copying it.
+         * \param index - One based index of the parameter.
+         * \param value - Value to bind: it must live until the next
+         *                reset.
+         * \param size  - Size of the value in bytes.
+         */
+        void bind(int index, const char *value, std::size_t size);
+
+        /*!
+         * \brief Binds a text parameter, without copying it.
+         * \param index - One based index of the parameter.
+         * \param value - Value to bind: it must live until the next
+         *                reset.
+         */
+        void bind(int index, const std::string& value);
+
+        /*!
+         * \brief Binds an integer parameter.
+         * \param index - One based index of the parameter.
+         * \param value - Value to bind.
+         */
+        void bind(int index, std::int64_t value);
+
+        /*!
+         * \brief Steps the statement.
+         * \return True if a row is available, false when done.
+         */
+        bool step();
+
+        /*! Resets the statement and clears its bindings. */
+        void reset();
+
+        /*!
+         * \param index - Zero based index of the column.
+         * \return The integer value of the column.
+         */
+        std::int64_t column_int64(int index) const;
+
+        /*!
+         * \param index - Zero based index of the column.
+         * \return The text value of the column.
+         */
+        std::string column_text(int index) const;
+
+    private:
+        SqliteStatement(const SqliteStatement&);
+        SqliteStatement& operator=(const SqliteStatement&);
+
+        sqlite3_stmt *_stmt;
+    };
+
+   /*!
+    * \brief Scoped write transaction.
+    *
+    * The transaction begins in the constructor and is rolled back by
+    * the destructor unless commit has been called.
+    */
+    class SqliteTransaction {
+    public:
+        /*!
+         * \brief Constructor with one parameter.
+         * \param db - Database where the transaction begins.
+         */
+        explicit SqliteTransaction(SqliteDatabase& db);
+
+        /*! Rolls back the transaction if not committed. */
+        ~SqliteTransaction();
+
+        /*! Commits the transaction. */
+        void commit();
+
+    private:
+        SqliteTransaction(const SqliteTransaction&);
+        SqliteTransaction& operator=(const SqliteTransaction&);
+
+        SqliteDatabase& _db;
+        bool _done;
+    };
+}
+#endif
@@ -0,0 +1,186 @@
+#include "libopenair/survey_batcher.hh"
+
+openair::SurveyBatcherOptions::SurveyBatcherOptions()
+    : max_records(500),
+      max_bytes(256 * 1024),
+      max_latency_ms(2000),
+      max_pending_batches(16) { }
+
+openair::SurveyBatcher::SurveyBatcher(
+    const CurlServiceConnector& connector,
+    const std::string& method,
+    const SurveyBatcherOptions& options)
+    : _connector(connector),
+      _method(method),
+      _options(options),
+      _current_records(0),
+      _flush_requested(false),
+      _stopping(false),
+      _sent_batches(0),
+      _sent_records(0),
+      _failed_batches(0) {
+    _current.reserve(_options.max_bytes);
+    _thread = std::thread(&SurveyBatcher::_loop, this);
+}
+
+openair::SurveyBatcher::~SurveyBatcher() {
+    shutdown();
+}
+
+void openair::SurveyBatcher::add(const std::string& record) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _progress.wait(lock, [this]() {
+        return _stopping ||
+            _ready.size() < _options.max_pending_batches;
+    });
+    if (_stopping) {
+        throw "Survey batcher is shut down";
+    }
+    // The record would overflow the byte limit: it opens a new batch.
+    if (_current_records > 0 &&
+        _current.size() + record.size() + 2 > _options.max_bytes) {
+        _seal();
+        _wake.notify_one();
+    }
+    if (_current_records == 0) {
+        _current.push_back('[');
+        _current_deadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(_options.max_latency_ms);
+        _wake.notify_one();
+    } else {
+        _current.push_back(',');
+    }
+    _current.append(record);
+    ++_current_records;
+    if (_current_records >= _options.max_records ||
+        _current.size() + 1 >= _options.max_bytes) {
+        _seal();
+        _wake.notify_one();
+    }
+}
+
+void openair::SurveyBatcher::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_stopping) {
+        return;
+    }
+    _flush_requested = true;
+    _wake.notify_one();
+    _progress.wait(lock, [this]() {
+        return !_flush_requested;
+    });
+}
+
+void openair::SurveyBatcher::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _progress.notify_all();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void openair::SurveyBatcher::on_error(const error_handler_t& handler) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _error_handler = handler;
+}
+
+std::size_t openair::SurveyBatcher::pending() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::size_t records = _current_records;
+    for (const auto& batch : _ready) {
+        records += batch.records;
+    }
+    return records;
+}
+
+std::size_t openair::SurveyBatcher::sent_batches() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sent_batches;
+}
+
+std::size_t openair::SurveyBatcher::sent_records() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sent_records;
+}
+
+std::size_t openair::SurveyBatcher::failed_batches() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _failed_batches;
+}
+
+void openair::SurveyBatcher::_loop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        if (_ready.empty() && _current_records > 0 &&
+            (_flush_requested || _stopping ||
+             std::chrono::steady_clock::now() >= _current_deadline)) {
+            _seal();
+        }
+        if (!_ready.empty()) {
+            Batch batch(std::move(_ready.front()));
+            _ready.pop_front();
+            _progress.notify_all();
+            lock.unlock();
+            _send(batch);
+            lock.lock();
+            continue;
+        }
+        if (_flush_requested) {
+            _flush_requested = false;
+            _progress.notify_all();
+        }
+        if (_stopping) {
+            break;
+        }
+        if (_current_records > 0) {
+            _wake.wait_until(lock, _current_deadline);
+        } else {
+            _wake.wait(lock);
+        }
+    }
+}
+
+void openair::SurveyBatcher::_seal() {
+    if (_current_records == 0) {
+        return;
+    }
+    _current.push_back(']');
+    _ready.push_back(Batch{std::move(_current), _current_records});
+    _current.clear();
+    _current.reserve(_options.max_bytes);
+    _current_records = 0;
+}
+
+void openair::SurveyBatcher::_send(Batch& batch) {
+    const char *error = NULL;
+    try {
+        HttpResponse response = _connector.post_call(_method, batch.json);
+        if (response.http_code < 200 || response.http_code >= 300) {
+            error = "Service did not accept the batch";
+        }
+    } catch (const char *message) {
+        error = message;
+    }
+    error_handler_t handler;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (error) {
+            ++_failed_batches;
+            handler = _error_handler;
+        } else {
+            ++_sent_batches;
+            _sent_records += batch.records;
+        }
+    }
+    if (handler) {
+        try {
+            handler(batch.json, error);
+        } catch (...) {
+            // A failing handler must not stop the batcher.
+        }
+    }
+}
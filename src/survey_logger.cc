@@ -0,0 +1,213 @@
+#include <chrono>
+#include <ctime>
+#include "libopenair/survey_logger.hh"
+#include "log_tables.hh"
+#include "sqlite_support.hh"
+
+const char *const openair::CREATE_LOG_TABLES =
+    "CREATE TABLE IF NOT EXISTS survey_log ("
+    " id INTEGER PRIMARY KEY,"
+    " created INTEGER NOT NULL,"
+    " record TEXT NOT NULL);"
+    "CREATE TABLE IF NOT EXISTS error_log ("
+    " id INTEGER PRIMARY KEY,"
+    " created INTEGER NOT NULL,"
+    " code INTEGER NOT NULL,"
+    " message TEXT NOT NULL)";
+
+namespace __SURVEY_LOGGER_INTERNAL__ {
+    const char *INSERT_SURVEY =
+        "INSERT INTO survey_log (created, record) VALUES (?1, ?2)";
+
+    const char *INSERT_ERROR =
+        "INSERT INTO error_log (created, code, message)"
+        " VALUES (?1, ?2, ?3)";
+}
+
+openair::SurveyLoggerOptions::SurveyLoggerOptions()
+    : commit_rows(4096),
+      commit_interval_ms(100) { }
+
+openair::SurveyLogger::SurveyLogger(const std::string& database_path,
+                                    const SurveyLoggerOptions& options)
+    : _options(options),
+      _db(new SqliteDatabase(database_path)),
+      _queue(NULL),
+      _logged(0),
+      _committed(0),
+      _transactions(0),
+      _failures(0),
+      _flush_requested(false),
+      _stopping(false),
+      _flushes(0) {
+    using namespace __SURVEY_LOGGER_INTERNAL__;
+    if (_options.commit_rows == 0) {
+        _options.commit_rows = 1;
+    }
+    _db->exec(CREATE_LOG_TABLES);
+    _insert_survey.reset(new SqliteStatement(*_db, INSERT_SURVEY));
+    _insert_error.reset(new SqliteStatement(*_db, INSERT_ERROR));
+    _thread = std::thread(&SurveyLogger::_loop, this);
+}
+
+openair::SurveyLogger::~SurveyLogger() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    _thread.join();
+}
+
+void openair::SurveyLogger::log_survey(const std::string& record) {
+    _push(new Row{NULL, false, 0, std::time(NULL), record});
+}
+
+void openair::SurveyLogger::log_error(long code,
+                                      const std::string& message) {
+    _push(new Row{NULL, true, code, std::time(NULL), message});
+}
+
+void openair::SurveyLogger::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::size_t flushes = _flushes;
+    _flush_requested = true;
+    _wake.notify_one();
+    _flushed.wait(lock, [this, flushes]() {
+        return _flushes != flushes || _stopping;
+    });
+}
+
+std::size_t openair::SurveyLogger::pending() const {
+    // Committed first: a row is counted as logged before the writer
+    // can see it, so the later logged count is never behind.
+    std::size_t committed = _committed.load();
+    return _logged.load() - committed;
+}
+
+std::size_t openair::SurveyLogger::committed() const {
+    return _committed.load();
+}
+
+std::size_t openair::SurveyLogger::transactions() const {
+    return _transactions.load();
+}
+
+std::size_t openair::SurveyLogger::failures() const {
+    return _failures.load();
+}
+
+void openair::SurveyLogger::_push(Row *row) {
+    // Counted before publishing it, so the writer never commits a row
+    // not yet counted as logged.
+    const std::size_t logged = ++_logged;
+    row->next = _queue.load(std::memory_order_relaxed);
+    while (!_queue.compare_exchange_weak(row->next, row,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+    }
+    // Once every commit_rows rows: passing through the mutex makes
+    // sure the writer is not between its check and its wait.
+    if (logged % _options.commit_rows == 0) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+        _wake.notify_one();
+    }
+}
+
+void openair::SurveyLogger::_loop() {
+    const auto interval =
+        std::chrono::milliseconds(_options.commit_interval_ms);
+    // Rows taken from the queue and not yet committed, oldest first.
+    Row *head = NULL;
+    Row *tail = NULL;
+    bool retrying = false;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait_for(lock, interval, [this, retrying]() {
+                return _stopping.load() ||
+                    (!retrying &&
+                     (_flush_requested.load() ||
+                      pending() >= _options.commit_rows));
+            });
+        }
+        bool stopping = _stopping.load();
+        bool flush = _flush_requested.exchange(false);
+
+        // The queue is a stack: it is reversed to keep the log order.
+        Row *newest = _queue.exchange(NULL, std::memory_order_acquire);
+        Row *oldest = NULL;
+        for (Row *row = newest; row; ) {
+            Row *next = row->next;
+            row->next = oldest;
+            oldest = row;
+            row = next;
+        }
+        if (oldest) {
+            if (tail) {
+                tail->next = oldest;
+            } else {
+                head = oldest;
+            }
+            tail = newest;
+        }
+
+        retrying = !_commit(head);
+        if (!head) {
+            tail = NULL;
+        }
+        if (flush) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_flushes;
+        }
+        _flushed.notify_all();
+        if (stopping) {
+            break;
+        }
+    }
+    while (head) {
+        Row *next = head->next;
+        delete head;
+        head = next;
+    }
+}
+
+bool openair::SurveyLogger::_commit(Row *&head) {
+    while (head) {
+        Row *row = head;
+        std::size_t rows = 0;
+        try {
+            SqliteTransaction transaction(*_db);
+            for (; row && rows < _options.commit_rows;
+                 row = row->next, ++rows) {
+                SqliteStatement& insert =
+                    row->error ? *_insert_error : *_insert_survey;
+                insert.bind(1, row->created);
+                if (row->error) {
+                    insert.bind(2, static_cast<std::int64_t>(row->code));
+                    insert.bind(3, row->text);
+                } else {
+                    insert.bind(2, row->text);
+                }
+                insert.step();
+                insert.reset();
+            }
+            transaction.commit();
+        } catch (const char *) {
+            _insert_survey->reset();
+            _insert_error->reset();
+            ++_failures;
+            return false;
+        }
+        while (head != row) {
+            Row *next = head->next;
+            delete head;
+            head = next;
+        }
+        _committed += rows;
+        ++_transactions;
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#include "token_bucket.hh"
+#include <algorithm>
+
+openair::TokenBucket::TokenBucket(double rate, double burst)
+    : _rate(rate), _burst(burst), _tokens(burst), _last(clock::now()) { }
+
+openair::TokenBucket::clock::duration openair::TokenBucket::wait_time(
+    double cost, clock::time_point now) {
+    if (_rate <= 0) {
+        return clock::duration::zero();
+    }
+    _refill(now);
+    double needed = std::min(cost, _burst);
+    if (_tokens >= needed) {
+        return clock::duration::zero();
+    }
+    return std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>((needed - _tokens) / _rate));
+}
+
+void openair::TokenBucket::consume(double cost, clock::time_point now) {
+    if (_rate <= 0) {
+        return;
+    }
+    _refill(now);
+    _tokens -= cost;
+}
+
+void openair::TokenBucket::_refill(clock::time_point now) {
+    if (now <= _last) {
+        return;
+    }
+    double elapsed = std::chrono::duration<double>(now - _last).count();
+    _tokens = std::min(_burst, _tokens + elapsed * _rate);
+    _last = now;
+}
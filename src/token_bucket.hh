@@ -0,0 +1,81 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      token_bucket.hh
+ * \brief     Token bucket rate limiter.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file is private to the library (it is not installed). It
+ * contains the rate limiter used by the outbound scheduler, for both
+ * the requests and the bytes sent per second.
+ */
+
+#include <chrono>
+
+#ifndef TOKEN_BUCKET_INCLUDE_GUARD_HH
+#define TOKEN_BUCKET_INCLUDE_GUARD_HH 1
+
+namespace openair {
+
+   /*!
+    * \brief Token bucket, not thread safe.
+    *
+    * The bucket holds up to burst tokens and is refilled with rate
+    * tokens per second. A cost greater than the burst is admitted
+    * when the bucket is full, leaving it in debt, so big calls are
+    * slowed down instead of being blocked forever.
+    */
+    class TokenBucket {
+    public:
+        /*! Typedefinition of the clock used by the bucket. */
+        typedef std::chrono::steady_clock clock;
+
+        /*!
+         * \brief Constructor with two parameters.
+         * \param rate  - Tokens added per second. Zero or less
+         *                disables the limit.
+         * \param burst - Capacity of the bucket, that starts full.
+         */
+        TokenBucket(double rate, double burst);
+
+        /*!
+         * \brief Computes how long a cost has to wait.
+         * \param cost - Tokens needed.
+         * \param now  - Current time.
+         * \return Zero if the cost can be consumed now, otherwise
+         *         the time to wait.
+         */
+        clock::duration wait_time(double cost, clock::time_point now);
+
+        /*!
+         * \brief Consumes the tokens of a cost.
+         * \param cost - Tokens to consume.
+         * \param now  - Current time.
+         */
+        void consume(double cost, clock::time_point now);
+
+    private:
+        void _refill(clock::time_point now);
+
+        double _rate;
+        double _burst;
+        double _tokens;
+        clock::time_point _last;
+    };
+}
+#endif
@@ -0,0 +1,315 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      backlog_reader/backlog_reader.cc
+ * \brief     Test the checkpointed reader of the logged surveys.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the BacklogReader pages and
+ * checkpoint.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/backlog_reader.hh"
+#include "../../src/libopenair/survey_logger.hh"
+#include "../stub/http_stub_server.hh"
+#include "../support/test_support.hh"
+
+namespace {
+    void log_records(const std::string& path, int first, int count) {
+        openair::SurveyLogger logger(path);
+        for (int i = first; i < first + count; ++i) {
+            logger.log_survey(std::to_string(i));
+        }
+    }
+
+    std::set<int> received_records(
+        const std::vector<openair_test::StubRequest>& requests) {
+        std::set<int> records;
+        for (const auto& request : requests) {
+            std::istringstream json(request.body.substr(1));
+            int record;
+            char separator;
+            while (json >> record >> separator) {
+                records.insert(record);
+            }
+        }
+        return records;
+    }
+
+    std::string json_array(int first, int count) {
+        std::string json("[");
+        for (int i = first; i < first + count; ++i) {
+            if (i > first) {
+                json.push_back(',');
+            }
+            json.append(std::to_string(i));
+        }
+        return json + "]";
+    }
+}
+
+TEST_GROUP(BacklogReader) {
+    std::string path;
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        path = openair_test::temporary_database();
+    }
+    void teardown() {
+        openair_test::remove_database(path);
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE 1200 logged records and a reachable service
+ * WHEN the reader catches up
+ * THEN they are sent in order, in pages of 500 records, and the
+ *      checkpoint moves to the last one.
+ */
+TEST(BacklogReader, Test_01) {
+    log_records(path, 0, 1200);
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::BacklogReader reader(path, connector, "send/data");
+    UNSIGNED_LONGS_EQUAL(1200, reader.remaining());
+    UNSIGNED_LONGS_EQUAL(1200, reader.catch_up());
+    auto requests = server.received();
+    LONGS_EQUAL(3, requests.size());
+    CHECK_EQUAL(json_array(0, 500), requests[0].body);
+    CHECK_EQUAL(json_array(500, 500), requests[1].body);
+    CHECK_EQUAL(json_array(1000, 200), requests[2].body);
+    LONGS_EQUAL(1200, reader.checkpoint());
+    UNSIGNED_LONGS_EQUAL(0, reader.remaining());
+}
+
+/**
+ * HAVE A reader with pages of at most 100 bytes
+ * WHEN the pages are read
+ * THEN no page is larger than 100 bytes and no record is skipped.
+ */
+TEST(BacklogReader, Test_02) {
+    log_records(path, 1000, 100);
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::BacklogReaderOptions options;
+    options.page_bytes = 100;
+    openair::BacklogReader reader(path, connector, "send/data", options);
+    openair::BacklogPage page;
+    std::size_t records = 0;
+    while (reader.next(page)) {
+        CHECK(page.json.size() <= 100);
+        CHECK_EQUAL(json_array(1000 + records, page.records), page.json);
+        records += page.records;
+    }
+    UNSIGNED_LONGS_EQUAL(100, records);
+    LONGS_EQUAL(0, reader.checkpoint());
+}
+
+/**
+ * HAVE A service refusing the second page
+ * WHEN the reader catches up and a new reader catches up later
+ * THEN the first reader stops at the first page and the new one
+ *      resumes from the second page.
+ */
+TEST(BacklogReader, Test_03) {
+    log_records(path, 0, 1000);
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&calls](const openair_test::StubRequest&,
+                 openair_test::StubResponse& response) {
+            if (++calls == 2) {
+                response.status = 503;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address());
+    {
+        openair::BacklogReader reader(path, connector, "send/data");
+        UNSIGNED_LONGS_EQUAL(500, reader.catch_up());
+        LONGS_EQUAL(500, reader.checkpoint());
+    }
+    openair::BacklogReader reader(path, connector, "send/data");
+    LONGS_EQUAL(500, reader.checkpoint());
+    UNSIGNED_LONGS_EQUAL(500, reader.catch_up());
+    auto requests = server.received();
+    LONGS_EQUAL(3, requests.size());
+    CHECK_EQUAL(json_array(500, 500), requests[2].body);
+}
+
+/**
+ * HAVE A reader that read two pages ahead
+ * WHEN the second page is acknowledged before the first one
+ * THEN a const char* is thrown and the checkpoint does not move.
+ */
+TEST(BacklogReader, Test_04) {
+    log_records(path, 0, 20);
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::BacklogReaderOptions options;
+    options.page_records = 10;
+    openair::BacklogReader reader(path, connector, "send/data", options);
+    openair::BacklogPage first;
+    openair::BacklogPage second;
+    CHECK(reader.next(first));
+    CHECK(reader.next(second));
+    bool thrown = false;
+    try {
+        reader.acknowledge(second);
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    LONGS_EQUAL(0, reader.checkpoint());
+    reader.acknowledge(first);
+    reader.acknowledge(second);
+    LONGS_EQUAL(20, reader.checkpoint());
+}
+
+/**
+ * HAVE Two readers of different methods on the same database
+ * WHEN only the first one catches up
+ * THEN the checkpoint of the second one does not move.
+ */
+TEST(BacklogReader, Test_05) {
+    log_records(path, 0, 10);
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::BacklogReader first(path, connector, "send/data");
+    openair::BacklogReader second(path, connector, "send/archive");
+    UNSIGNED_LONGS_EQUAL(10, first.catch_up());
+    LONGS_EQUAL(0, second.checkpoint());
+    UNSIGNED_LONGS_EQUAL(10, second.remaining());
+}
+
+/**
+ * HAVE 1000 logged records, a slow service and a reader with 4
+ *      connections
+ * WHEN the reader catches up
+ * THEN the pages are sent at once and every record is acknowledged.
+ */
+TEST(BacklogReader, Test_06) {
+    log_records(path, 0, 1000);
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 5;
+        });
+    openair::CurlConnectorOptions connector_options;
+    connector_options.pool_size = 4;
+    openair::CurlServiceConnector connector(server.address(),
+                                            connector_options);
+    openair::BacklogReaderOptions options;
+    options.page_records = 10;
+    options.connections = 4;
+    openair::BacklogReader reader(path, connector, "send/data", options);
+    UNSIGNED_LONGS_EQUAL(1000, reader.catch_up());
+    LONGS_EQUAL(1000, reader.checkpoint());
+    auto requests = server.received();
+    LONGS_EQUAL(100, requests.size());
+    UNSIGNED_LONGS_EQUAL(1000, received_records(requests).size());
+    CHECK(server.max_in_flight() > 1);
+}
+
+/**
+ * HAVE A reader with 4 connections and a service refusing the page
+ *      starting at record 300 once
+ * WHEN the reader catches up twice
+ * THEN the first call stops the checkpoint before that page and the
+ *      second one sends the rest.
+ */
+TEST(BacklogReader, Test_07) {
+    log_records(path, 0, 1000);
+    std::atomic<bool> refused(false);
+    openair_test::HttpStubServer server(
+        [&refused](const openair_test::StubRequest& request,
+                   openair_test::StubResponse& response) {
+            if (request.body.compare(0, 5, "[300,") == 0 &&
+                !refused.exchange(true)) {
+                response.status = 503;
+            }
+        });
+    openair::CurlConnectorOptions connector_options;
+    connector_options.pool_size = 4;
+    openair::CurlServiceConnector connector(server.address(),
+                                            connector_options);
+    openair::BacklogReaderOptions options;
+    options.page_records = 10;
+    options.connections = 4;
+    openair::BacklogReader reader(path, connector, "send/data", options);
+    UNSIGNED_LONGS_EQUAL(300, reader.catch_up());
+    LONGS_EQUAL(300, reader.checkpoint());
+    UNSIGNED_LONGS_EQUAL(700, reader.catch_up());
+    LONGS_EQUAL(1000, reader.checkpoint());
+    UNSIGNED_LONGS_EQUAL(1000, received_records(server.received()).size());
+}
+
+/**
+ * HAVE A service answering the first page with a redirect
+ * WHEN the reader catches up
+ * THEN nothing is acknowledged and the checkpoint does not move.
+ */
+TEST(BacklogReader, Test_08) {
+    log_records(path, 0, 10);
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 302;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::BacklogReader reader(path, connector, "send/data");
+    UNSIGNED_LONGS_EQUAL(0, reader.catch_up());
+    LONGS_EQUAL(0, reader.checkpoint());
+    UNSIGNED_LONGS_EQUAL(10, reader.remaining());
+}
+
+/**
+ * HAVE A reader with 4 connections and a service redirecting the page
+ *      starting at record 50
+ * WHEN the reader catches up
+ * THEN the checkpoint stops before that page.
+ */
+TEST(BacklogReader, Test_09) {
+    log_records(path, 0, 100);
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest& request,
+           openair_test::StubResponse& response) {
+            if (request.body.compare(0, 4, "[50,") == 0) {
+                response.status = 307;
+            }
+        });
+    openair::CurlConnectorOptions connector_options;
+    connector_options.pool_size = 4;
+    openair::CurlServiceConnector connector(server.address(),
+                                            connector_options);
+    openair::BacklogReaderOptions options;
+    options.page_records = 10;
+    options.connections = 4;
+    openair::BacklogReader reader(path, connector, "send/data", options);
+    UNSIGNED_LONGS_EQUAL(50, reader.catch_up());
+    LONGS_EQUAL(50, reader.checkpoint());
+}
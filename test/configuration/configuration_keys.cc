@@ -90,3 +90,11 @@ TEST(ConfigurationKeys, Test_08) {
     CHECK_EQUAL(openair::SEND_ERRORS_METHOD_KEY,
                 "send_errors_method");
 }
+
+/**
+ * Expect SERVICE_ENDPOINTS_KEY to be "service_endpoints"
+ */
+TEST(ConfigurationKeys, Test_09) {
+    CHECK_EQUAL(openair::SERVICE_ENDPOINTS_KEY,
+                "service_endpoints");
+}
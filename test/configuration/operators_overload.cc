@@ -335,3 +335,43 @@ TEST(OverloadOperators, Test_16) {
     
     CHECK(config1 != config2);
 }
+
+/**
+ * HAVE A stream with a list of service endpoints
+ * WHEN use operator>> in a ConfigurationData object
+ * THEN service_endpoints contains the trimmed addresses, empty items
+ *      skipped.
+ */
+TEST(OverloadOperators, Test_17) {
+    std::stringstream ss;
+    ss << openair::SERVICE_ENDPOINTS_KEY
+       << " = https://a.service.com , https://b.service.com,,";
+    openair::ConfigurationData config;
+    ss >> config;
+    LONGS_EQUAL(2, config.service_endpoints.size());
+    CHECK_EQUAL(config.service_endpoints[0], "https://a.service.com");
+    CHECK_EQUAL(config.service_endpoints[1], "https://b.service.com");
+}
+
+/**
+ * HAVE A ConfigurationData with service endpoints
+ * WHEN print it through operator<< and read it back
+ * THEN the endpoints are printed after the service address and the
+ *      configuration read is equal to the printed one.
+ */
+TEST(OverloadOperators, Test_18) {
+    openair::ConfigurationData config;
+    config.service_address = "a";
+    config.service_endpoints.push_back("a");
+    config.service_endpoints.push_back("b");
+    std::stringstream ss;
+    ss << config;
+    CHECK(ss.str().find(openair::SERVICE_ADDRESS_KEY + "=a\n" +
+                        openair::SERVICE_ENDPOINTS_KEY + "=a,b\n") !=
+          std::string::npos);
+    openair::ConfigurationData read;
+    ss >> read;
+    CHECK_EQUAL(config, read);
+    read.service_endpoints.pop_back();
+    CHECK(config != read);
+}
@@ -0,0 +1,175 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      coroutines/coroutine_calls.cc
+ * \brief     Test the coroutine interface of the connector.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for AwaitableConnector, Task and
+ * spawn. It is built only with --enable-coroutines.
+ */
+
+#include <future>
+#include <string>
+#include <thread>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/coroutine_calls.hh"
+#include "../../src/libopenair/event_loop.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    /* Registration, then configuration fetch, then upload. */
+    openair::Task<std::string> register_and_upload(
+        const openair::AwaitableConnector& connector) {
+        auto registration = co_await connector.post("vpn/register", "{}");
+        auto settings = co_await connector.get("settings", "id=3");
+        auto upload = co_await connector.post("send/data",
+                                              settings.http_body);
+        co_return std::to_string(registration.http_code) + " " +
+            settings.http_body + " " + std::to_string(upload.http_code);
+    }
+
+    openair::Task<void> run(const openair::AwaitableConnector& connector,
+                            std::string& outcome) {
+        outcome = co_await register_and_upload(connector);
+    }
+
+    openair::Task<void> upload(const openair::AwaitableConnector& connector,
+                               int& succeeded) {
+        auto response = co_await connector.post("send/data", "{}");
+        if (response.http_code == 200) {
+            ++succeeded;
+        }
+    }
+
+    openair::Task<void> failing(
+        const openair::AwaitableConnector& connector,
+        std::string& caught) {
+        try {
+            co_await connector.get("settings");
+        } catch (const char *error) {
+            caught = error;
+        }
+    }
+}
+
+TEST_GROUP(CoroutineCalls) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector and a coroutine chaining three calls
+ * WHEN spawn the coroutine
+ * THEN the calls are made in order and the coroutine gets every
+ *      response.
+ */
+TEST(CoroutineCalls, Test_01) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest& request,
+           openair_test::StubResponse& response) {
+            response.body = "\"" + request.target + "\"";
+        });
+    openair::CurlServiceConnector base(server.address());
+    openair::AwaitableConnector connector(base);
+    std::string outcome;
+    std::promise<void> ended;
+    openair::spawn(run(connector, outcome),
+                   [&ended](std::exception_ptr) { ended.set_value(); });
+    ended.get_future().get();
+    CHECK_EQUAL(std::string("200 \"/settings?id=3\" 200"), outcome);
+    auto received = server.received();
+    LONGS_EQUAL(3, received.size());
+    CHECK_EQUAL(std::string("/vpn/register"), received[0].target);
+    CHECK_EQUAL(std::string("\"/settings?id=3\""), received[2].body);
+}
+
+/**
+ * HAVE A connector to an address where nobody listens
+ * WHEN a coroutine awaits a call
+ * THEN the curl error is thrown in the coroutine.
+ */
+TEST(CoroutineCalls, Test_02) {
+    std::string address;
+    {
+        openair_test::HttpStubServer server;
+        address = server.address();
+    }
+    openair::CurlServiceConnector base(address);
+    openair::AwaitableConnector connector(base);
+    std::string caught;
+    std::promise<std::exception_ptr> ended;
+    openair::spawn(failing(connector, caught),
+                   [&ended](std::exception_ptr error) {
+                       ended.set_value(error);
+                   });
+    CHECK(ended.get_future().get() == nullptr);
+    CHECK(!caught.empty());
+}
+
+/**
+ * HAVE A connector driven by an EpollLoop
+ * WHEN spawn hundreds of uploading coroutines and run the loop
+ * THEN every upload succeeds on the single loop thread.
+ */
+TEST(CoroutineCalls, Test_03) {
+    const int UPLOADS = 200;
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 50;
+        });
+    server.record_requests(false);
+    openair::EpollLoop loop;
+    openair::CurlConnectorOptions options;
+    options.event_loop = &loop;
+    openair::CurlServiceConnector base(server.address(), options);
+    openair::AwaitableConnector connector(base);
+    int succeeded = 0;
+    int ended = 0;
+    for (int i = 0; i < UPLOADS; ++i) {
+        openair::spawn(upload(connector, succeeded),
+                       [&ended](std::exception_ptr) { ++ended; });
+    }
+    loop.run_until([&ended]() { return ended == UPLOADS; });
+    LONGS_EQUAL(UPLOADS, succeeded);
+    CHECK(server.max_in_flight() > 1);
+}
+
+/**
+ * HAVE A task throwing before any call
+ * WHEN spawn it
+ * THEN the done handler gets the exception.
+ */
+TEST(CoroutineCalls, Test_04) {
+    auto thrower = []() -> openair::Task<void> {
+        throw "Broken task";
+        co_return;
+    };
+    std::exception_ptr error;
+    openair::spawn(thrower(),
+                   [&error](std::exception_ptr ended) { error = ended; });
+    CHECK(error != nullptr);
+}
@@ -1,6 +1,14 @@
 #include "CppUTest/CommandLineTestRunner.h"
+#include "CppUTest/MemoryLeakWarningPlugin.h"
 
 int main(int ac, char** av)
 {
-    return CommandLineTestRunner::RunAllTests(ac, av);
+    // The groups running the connector or background threads turn the
+    // new/delete leak detection off in their setup: libcurl and the
+    // worker threads keep process wide allocations alive across tests.
+    // The other groups keep it. Those allocations are freed at exit,
+    // so the detection stays off once the tests are done.
+    int result = CommandLineTestRunner::RunAllTests(ac, av);
+    MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    return result;
 }
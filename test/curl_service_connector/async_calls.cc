@@ -0,0 +1,171 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/async_calls.cc
+ * \brief     Test the asynchronous calls of the connector.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the post_call_async and
+ * get_call_async methods of the CurlServiceConnector.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+TEST_GROUP(AsyncCalls) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A service echoing the request body
+ * WHEN perform an async POST call and wait the future
+ * THEN the response contains the body sent.
+ */
+TEST(AsyncCalls, Test_01) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest& request,
+           openair_test::StubResponse& response) {
+            response.body = request.body;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto future = connector.post_call_async("send/data", "{\"v\":42}");
+    auto response = future.get();
+    LONGS_EQUAL(200, response.http_code);
+    CHECK_EQUAL(std::string("{\"v\":42}"), response.http_body);
+}
+
+/**
+ * HAVE A service answering after 300 ms
+ * WHEN perform 32 async GET calls at once
+ * THEN they are all in flight together and end in about one round
+ *      trip.
+ */
+TEST(AsyncCalls, Test_02) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 300;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::future<openair::HttpResponse> > futures;
+    for (int i = 0; i < 32; ++i) {
+        futures.push_back(connector.get_call_async("settings", "a=1"));
+    }
+    for (auto& future : futures) {
+        LONGS_EQUAL(200, future.get().http_code);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    CHECK(elapsed < std::chrono::milliseconds(3000));
+    LONGS_EQUAL(32, server.max_in_flight());
+}
+
+/**
+ * HAVE A connector to an unreachable service
+ * WHEN perform an async call
+ * THEN the future throws a const char* message.
+ */
+TEST(AsyncCalls, Test_03) {
+    std::string address;
+    {
+        openair_test::HttpStubServer server;
+        address = server.address();
+    }
+    openair::CurlServiceConnector connector(address);
+    auto future = connector.get_call_async("settings");
+    bool thrown = false;
+    try {
+        future.get();
+    } catch (const char *message) {
+        thrown = true;
+        CHECK(message != NULL);
+    }
+    CHECK(thrown);
+}
+
+/**
+ * HAVE A running service
+ * WHEN perform async calls with a completion handler
+ * THEN the handler is called once for each call without errors.
+ */
+TEST(AsyncCalls, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::atomic<int> ok(0);
+    std::promise<void> all_done;
+    const int calls = 50;
+    std::atomic<int> remaining(calls);
+    for (int i = 0; i < calls; ++i) {
+        connector.post_call_async(
+            "send/data", "{}",
+            [&](openair::HttpResponse&& response, const char *error) {
+                if (!error && response.http_code == 200) {
+                    ++ok;
+                }
+                if (--remaining == 0) {
+                    all_done.set_value();
+                }
+            });
+    }
+    all_done.get_future().wait();
+    LONGS_EQUAL(calls, ok.load());
+    LONGS_EQUAL(calls, server.requests());
+}
+
+/**
+ * HAVE A connector with async calls in flight
+ * WHEN the connector is destroyed
+ * THEN every pending future is completed.
+ */
+TEST(AsyncCalls, Test_05) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 2000;
+        });
+    std::future<openair::HttpResponse> future;
+    {
+        openair::CurlServiceConnector connector(server.address());
+        future = connector.get_call_async("settings");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    CHECK(future.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready);
+    bool thrown = false;
+    try {
+        future.get();
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
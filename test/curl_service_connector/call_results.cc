@@ -0,0 +1,142 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/call_results.cc
+ * \brief     Test the calls reporting failures without exceptions.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the try_ methods of the
+ * CurlServiceConnector and of the PreparedCall.
+ */
+
+#include <string>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+TEST_GROUP(CallResults) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A reachable service
+ * WHEN perform POST and GET calls without exceptions
+ * THEN the results are successful and carry the responses.
+ */
+TEST(CallResults, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto post = connector.try_post_call("send/data", "{\"a\":1}");
+    CHECK_TRUE(post.ok());
+    LONGS_EQUAL(0, post.curl_code);
+    CHECK(post.message == NULL);
+    LONGS_EQUAL(200, post.response.http_code);
+    auto get = connector.try_get_call("settings", "id=1");
+    CHECK_TRUE(get.ok());
+    CHECK_EQUAL(std::string("{}"), get.response.http_body);
+    CHECK_EQUAL(std::string("/settings?id=1"), server.received()[1].target);
+}
+
+/**
+ * HAVE A service answering with 500
+ * WHEN perform a POST call without exceptions
+ * THEN the call is completed and the http code is reported.
+ */
+TEST(CallResults, Test_02) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 500;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto result = connector.try_post_call("send/data", "{}");
+    CHECK_TRUE(result.ok());
+    LONGS_EQUAL(500, result.response.http_code);
+}
+
+/**
+ * HAVE A service not listening
+ * WHEN perform calls without exceptions
+ * THEN the results report a connection failure with its message.
+ */
+TEST(CallResults, Test_03) {
+    openair::CurlServiceConnector connector("http://127.0.0.1:1");
+    auto post = connector.try_post_call("send/data", "{}");
+    CHECK_FALSE(post.ok());
+    LONGS_EQUAL(openair::CALL_CONNECT_FAILED, post.error);
+    LONGS_EQUAL(7, post.curl_code);
+    CHECK(post.message != NULL);
+    auto get = connector.try_get_call("settings");
+    LONGS_EQUAL(openair::CALL_CONNECT_FAILED, get.error);
+}
+
+/**
+ * HAVE A service not listening
+ * WHEN perform a call with the throwing interface
+ * THEN the message of the failure is thrown, as before.
+ */
+TEST(CallResults, Test_04) {
+    openair::CurlServiceConnector connector("http://127.0.0.1:1");
+    auto result = connector.try_post_call("send/data", "{}");
+    const char *thrown = NULL;
+    try {
+        connector.post_call("send/data", "{}");
+    } catch (const char *error) {
+        thrown = error;
+    }
+    STRCMP_EQUAL(result.message, thrown);
+}
+
+/**
+ * HAVE A malformed service address
+ * WHEN perform a call without exceptions
+ * THEN the result reports a failure not related to the network.
+ */
+TEST(CallResults, Test_05) {
+    openair::CurlServiceConnector connector("nothing://");
+    auto result = connector.try_get_call("settings");
+    CHECK_FALSE(result.ok());
+    LONGS_EQUAL(openair::CALL_OTHER_ERROR, result.error);
+}
+
+/**
+ * HAVE A prepared call
+ * WHEN perform calls without exceptions to a reachable and to an
+ *      unreachable service
+ * THEN the results report the outcome of each call.
+ */
+TEST(CallResults, Test_06) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto call = connector.prepare("send/data");
+    CHECK_TRUE(call.try_post("{}").ok());
+    CHECK_TRUE(call.try_get().ok());
+    CHECK_TRUE(call.try_get("a=1").ok());
+    openair::CurlServiceConnector down("http://127.0.0.1:1");
+    auto failing = down.prepare("send/data");
+    LONGS_EQUAL(openair::CALL_CONNECT_FAILED,
+                failing.try_post("{}").error);
+}
@@ -0,0 +1,185 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/coalescing.cc
+ * \brief     Test the coalescing of identical concurrent GET calls.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the coalesce_gets option of the
+ * CurlServiceConnector.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    const int THREADS = 8;
+
+    /*
+     * Performs the same GET call from many threads started together,
+     * and returns the bodies received.
+     */
+    std::vector<std::string> concurrent_gets(
+        const openair::CurlServiceConnector& connector,
+        const std::string& params) {
+        std::vector<std::string> bodies(THREADS);
+        std::atomic<int> ready(0);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < THREADS; ++i) {
+            threads.emplace_back([&, i]() {
+                ++ready;
+                while (ready < THREADS) {
+                    std::this_thread::yield();
+                }
+                bodies[i] =
+                    connector.get_call("settings", params).http_body;
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        return bodies;
+    }
+
+    /* Slow service echoing the request target. */
+    void echo(const openair_test::StubRequest& request,
+              openair_test::StubResponse& response) {
+        response.delay_ms = 200;
+        response.body = "\"" + request.target + "\"";
+    }
+
+    openair::CurlConnectorOptions coalescing() {
+        openair::CurlConnectorOptions options;
+        options.pool_size = THREADS;
+        options.coalesce_gets = true;
+        return options;
+    }
+}
+
+TEST_GROUP(Coalescing) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector coalescing the GET calls and a slow service
+ * WHEN many threads perform the same GET call at the same time
+ * THEN only one request reaches the service and every thread gets
+ *      its response.
+ */
+TEST(Coalescing, Test_01) {
+    openair_test::HttpStubServer server(echo);
+    openair::CurlServiceConnector connector(server.address(),
+                                            coalescing());
+    auto bodies = concurrent_gets(connector, "id=3");
+    LONGS_EQUAL(1, server.requests());
+    for (const auto& body : bodies) {
+        CHECK_EQUAL(std::string("\"/settings?id=3\""), body);
+    }
+    LONGS_EQUAL(THREADS - 1, connector.coalesced_calls());
+}
+
+/**
+ * HAVE A connector coalescing the GET calls
+ * WHEN two threads perform GET calls with different parameters
+ * THEN each call gets its own request.
+ */
+TEST(Coalescing, Test_02) {
+    openair_test::HttpStubServer server(echo);
+    openair::CurlServiceConnector connector(server.address(),
+                                            coalescing());
+    std::string first, second;
+    std::thread other([&]() {
+        first = connector.get_call("settings", "id=1").http_body;
+    });
+    second = connector.get_call("settings", "id=2").http_body;
+    other.join();
+    LONGS_EQUAL(2, server.requests());
+    CHECK_EQUAL(std::string("\"/settings?id=1\""), first);
+    CHECK_EQUAL(std::string("\"/settings?id=2\""), second);
+}
+
+/**
+ * HAVE A connector coalescing the GET calls
+ * WHEN the same GET call is performed twice in sequence
+ * THEN the second call does not reuse the first result.
+ */
+TEST(Coalescing, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address(),
+                                            coalescing());
+    connector.get_call("settings");
+    connector.get_call("settings");
+    LONGS_EQUAL(2, server.requests());
+    LONGS_EQUAL(0, connector.coalesced_calls());
+}
+
+/**
+ * HAVE A connector with the default options and a slow service
+ * WHEN many threads perform the same GET call at the same time
+ * THEN each thread sends its own request.
+ */
+TEST(Coalescing, Test_04) {
+    openair_test::HttpStubServer server(echo);
+    openair::CurlConnectorOptions options;
+    options.pool_size = THREADS;
+    openair::CurlServiceConnector connector(server.address(), options);
+    concurrent_gets(connector, "id=3");
+    LONGS_EQUAL(THREADS, server.requests());
+}
+
+/**
+ * HAVE A connector coalescing the GET calls and a service answering
+ *      after 500 ms
+ * WHEN a call with a deadline of 50 ms joins a call without deadline
+ * THEN it fails with CALL_TIMEOUT without waiting for the first one.
+ */
+TEST(Coalescing, Test_05) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 500;
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            coalescing());
+    std::thread first([&]() { connector.get_call("settings"); });
+    while (server.in_flight() == 0) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto result = connector.try_get_call(
+        "settings", "", std::chrono::milliseconds(50));
+    auto waited = std::chrono::steady_clock::now() - start;
+    first.join();
+    LONGS_EQUAL(openair::CALL_TIMEOUT, result.error);
+    CHECK(waited < std::chrono::milliseconds(300));
+    LONGS_EQUAL(1, server.requests());
+}
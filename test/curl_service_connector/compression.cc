@@ -0,0 +1,191 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/compression.cc
+ * \brief     Test the compression of requests and responses.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the gzip request bodies and the
+ * decoding of the compressed responses.
+ */
+
+#include <string>
+#include <zlib.h>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../../src/gzip_codec.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    std::string survey_json(int records) {
+        std::string json = "[";
+        for (int i = 0; i < records; ++i) {
+            json += (i ? "," : "");
+            json += "{\"sensor\":\"pm10\",\"value\":" +
+                std::to_string(i % 50) + "}";
+        }
+        return json + "]";
+    }
+
+    /*
+     * Decodes a gzip body, as the service would. An invalid or
+     * truncated body decodes to an empty string.
+     */
+    std::string gunzip(const std::string& body) {
+        z_stream stream = z_stream();
+        // Window bits asking zlib for the gzip wrapper.
+        if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+            return std::string();
+        }
+        stream.next_in =
+            reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+        stream.avail_in = body.size();
+        std::string out;
+        char chunk[16384];
+        int result;
+        do {
+            stream.next_out = reinterpret_cast<Bytef*>(chunk);
+            stream.avail_out = sizeof(chunk);
+            result = inflate(&stream, Z_NO_FLUSH);
+            out.append(chunk, sizeof(chunk) - stream.avail_out);
+        } while (result == Z_OK);
+        inflateEnd(&stream);
+        return result == Z_STREAM_END ? out : std::string();
+    }
+}
+
+TEST_GROUP(Compression) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector with gzip request encoding
+ * WHEN a POST body bigger than the threshold is sent
+ * THEN the service receives a smaller gzip body that decodes to the
+ *      original one.
+ */
+TEST(Compression, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.request_encoding = openair::GZIP_ENCODING;
+    openair::CurlServiceConnector connector(server.address(), options);
+    std::string json = survey_json(200);
+    connector.post_call("send/data", json);
+    auto request = server.received().front();
+    CHECK_EQUAL(std::string("gzip"), request.header("content-encoding"));
+    CHECK(request.body.size() * 5 < json.size());
+    CHECK_EQUAL(json, gunzip(request.body));
+}
+
+/**
+ * HAVE A connector with gzip request encoding
+ * WHEN a POST body smaller than the threshold is sent
+ * THEN the body is sent as it is.
+ */
+TEST(Compression, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.request_encoding = openair::GZIP_ENCODING;
+    options.compression_threshold = 64;
+    openair::CurlServiceConnector connector(server.address(), options);
+    connector.post_call("send/data", "{\"a\":1}");
+    auto request = server.received().front();
+    CHECK_EQUAL(std::string(""), request.header("content-encoding"));
+    CHECK_EQUAL(std::string("{\"a\":1}"), request.body);
+}
+
+/**
+ * HAVE A connector with the default options
+ * WHEN a big POST body is sent
+ * THEN the body is not compressed.
+ */
+TEST(Compression, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::string json = survey_json(200);
+    connector.post_call("send/data", json);
+    auto request = server.received().front();
+    CHECK_EQUAL(std::string(""), request.header("content-encoding"));
+    CHECK_EQUAL(json, request.body);
+}
+
+/**
+ * HAVE A service answering with gzip when accepted
+ * WHEN a GET call is performed with the default options
+ * THEN the body is decoded transparently.
+ */
+TEST(Compression, Test_04) {
+    std::string json = survey_json(100);
+    openair_test::HttpStubServer server(
+        [&](const openair_test::StubRequest& request,
+            openair_test::StubResponse& response) {
+            if (request.header("accept-encoding").find("gzip") !=
+                std::string::npos) {
+                openair::gzip_compress(json.data(), json.size(),
+                                       response.body);
+                response.headers.push_back(
+                    std::make_pair("Content-Encoding", "gzip"));
+            } else {
+                response.body = json;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto response = connector.get_call("calibration");
+    CHECK_EQUAL(json, response.http_body);
+    CHECK(server.received().front().header("accept-encoding").find(
+              "gzip") != std::string::npos);
+}
+
+/**
+ * HAVE A connector with accept_encoding disabled
+ * WHEN a GET call is performed
+ * THEN no Accept-Encoding header is sent.
+ */
+TEST(Compression, Test_05) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.accept_encoding = false;
+    openair::CurlServiceConnector connector(server.address(), options);
+    connector.get_call("calibration");
+    CHECK_EQUAL(std::string(""),
+                server.received().front().header("accept-encoding"));
+}
+
+/**
+ * HAVE A connector with gzip request encoding
+ * WHEN a big body is sent with an async POST call
+ * THEN the service receives the gzip body.
+ */
+TEST(Compression, Test_06) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.request_encoding = openair::GZIP_ENCODING;
+    openair::CurlServiceConnector connector(server.address(), options);
+    std::string json = survey_json(200);
+    connector.post_call_async("send/data", json).get();
+    auto request = server.received().front();
+    CHECK_EQUAL(json, gunzip(request.body));
+}
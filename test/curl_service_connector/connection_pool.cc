@@ -0,0 +1,146 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/connection_pool.cc
+ * \brief     Test the reuse of the connections by the connector.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the pool of curl handles owned by
+ * the CurlServiceConnector.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../../src/curl_handle_pool.hh"
+#include "../stub/http_stub_server.hh"
+
+TEST_GROUP(ConnectionPool) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector with the default options
+ * WHEN perform thousands of POST calls to the same service
+ * THEN only one connection is opened to the service.
+ */
+TEST(ConnectionPool, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    for (int i = 0; i < 2000; ++i) {
+        auto response = connector.post_call("send/data", "{\"i\":1}");
+        LONGS_EQUAL(200, response.http_code);
+    }
+    LONGS_EQUAL(2000, server.requests());
+    LONGS_EQUAL(1, server.connections());
+}
+
+/**
+ * HAVE A connector with the default options
+ * WHEN perform thousands of GET calls to the same service
+ * THEN only one connection is opened to the service.
+ */
+TEST(ConnectionPool, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    for (int i = 0; i < 2000; ++i) {
+        auto response = connector.get_call("settings", "a=1");
+        LONGS_EQUAL(200, response.http_code);
+        CHECK_EQUAL(std::string("{}"), response.http_body);
+    }
+    LONGS_EQUAL(1, server.connections());
+}
+
+/**
+ * HAVE A connector with a pool size of zero
+ * WHEN perform some calls
+ * THEN each call opens its own connection.
+ */
+TEST(ConnectionPool, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.pool_size = 0;
+    openair::CurlServiceConnector connector(server.address(), options);
+    for (int i = 0; i < 20; ++i) {
+        connector.get_call("settings");
+    }
+    LONGS_EQUAL(20, server.connections());
+}
+
+/**
+ * HAVE A connector with an idle timeout of one second
+ * WHEN two calls are performed at more than one second of distance
+ * THEN the second call opens a new connection.
+ */
+TEST(ConnectionPool, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.idle_timeout = 1;
+    openair::CurlServiceConnector connector(server.address(), options);
+    connector.get_call("settings");
+    connector.get_call("settings");
+    LONGS_EQUAL(1, server.connections());
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    connector.get_call("settings");
+    LONGS_EQUAL(2, server.connections());
+}
+
+/**
+ * HAVE A pool with size two
+ * WHEN three handles are leased and released
+ * THEN only two handles are kept idle.
+ */
+TEST(ConnectionPool, Test_05) {
+    openair::CurlHandlePool pool(2, 60);
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        auto c = pool.acquire();
+        CHECK(a.get() != b.get());
+        CHECK(b.get() != c.get());
+        UNSIGNED_LONGS_EQUAL(0, pool.idle());
+    }
+    UNSIGNED_LONGS_EQUAL(2, pool.idle());
+}
+
+/**
+ * HAVE A pool with an idle handle
+ * WHEN a handle is leased
+ * THEN the idle handle is reused.
+ */
+TEST(ConnectionPool, Test_06) {
+    openair::CurlHandlePool pool(2, 60);
+    CURL *first;
+    {
+        auto lease = pool.acquire();
+        first = lease.get();
+    }
+    auto lease = pool.acquire();
+    CHECK(first == lease.get());
+    UNSIGNED_LONGS_EQUAL(0, pool.idle());
+}
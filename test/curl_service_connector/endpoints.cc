@@ -0,0 +1,161 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/endpoints.cc
+ * \brief     Test the connector with many service addresses.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the latency aware routing and the
+ * failover of a CurlServiceConnector with many endpoints.
+ */
+
+#include <string>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    void slow(const openair_test::StubRequest&,
+              openair_test::StubResponse& response) {
+        response.delay_ms = 20;
+    }
+
+    void unavailable(const openair_test::StubRequest&,
+                     openair_test::StubResponse& response) {
+        response.status = 503;
+    }
+
+    /* Address where nobody listens. */
+    std::string closed_address() {
+        openair_test::HttpStubServer server;
+        return server.address();
+    }
+}
+
+TEST_GROUP(Endpoints) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector on a degraded endpoint and a fast one
+ * WHEN perform many GET calls
+ * THEN most calls go to the fast endpoint.
+ */
+TEST(Endpoints, Test_01) {
+    openair_test::HttpStubServer degraded(slow);
+    openair_test::HttpStubServer fast;
+    std::vector<std::string> addresses;
+    addresses.push_back(degraded.address());
+    addresses.push_back(fast.address());
+    openair::CurlServiceConnector connector(addresses);
+    for (int i = 0; i < 100; ++i) {
+        LONGS_EQUAL(200, connector.get_call("get/data").http_code);
+    }
+    CHECK(fast.requests() >= 85);
+    CHECK(degraded.requests() <= 15);
+    auto stats = connector.endpoint_stats();
+    LONGS_EQUAL(2, stats.size());
+    CHECK(stats[0].latency_ms > stats[1].latency_ms);
+    CHECK(stats[0].healthy && stats[1].healthy);
+}
+
+/**
+ * HAVE A connector whose first endpoint refuses the connections
+ * WHEN perform POST and GET calls
+ * THEN every call fails over to the second endpoint and the first
+ *      one is ejected.
+ */
+TEST(Endpoints, Test_02) {
+    openair_test::HttpStubServer server;
+    std::vector<std::string> addresses;
+    addresses.push_back(closed_address());
+    addresses.push_back(server.address());
+    openair::CurlServiceConnector connector(addresses);
+    for (int i = 0; i < 5; ++i) {
+        LONGS_EQUAL(200, connector.post_call("send/data", "{}").http_code);
+        LONGS_EQUAL(200, connector.get_call("get/data").http_code);
+    }
+    LONGS_EQUAL(10, server.requests());
+    auto stats = connector.endpoint_stats();
+    CHECK(!stats[0].healthy);
+    CHECK(stats[0].failures >= 3);
+    LONGS_EQUAL(0, stats[1].failures);
+}
+
+/**
+ * HAVE A connector whose first endpoint answers 503
+ * WHEN perform GET calls
+ * THEN they fail over to the healthy endpoint, and after three
+ *      failures the first endpoint is not called anymore.
+ */
+TEST(Endpoints, Test_03) {
+    openair_test::HttpStubServer broken(unavailable);
+    openair_test::HttpStubServer server;
+    std::vector<std::string> addresses;
+    addresses.push_back(broken.address());
+    addresses.push_back(server.address());
+    openair::CurlConnectorOptions options;
+    options.endpoints.explore = 0;
+    openair::CurlServiceConnector connector(addresses, options);
+    for (int i = 0; i < 10; ++i) {
+        LONGS_EQUAL(200, connector.get_call("get/data").http_code);
+    }
+    CHECK(broken.requests() <= 3);
+    CHECK(!connector.endpoint_stats()[0].healthy);
+}
+
+/**
+ * HAVE A connector whose first endpoint answers 503
+ * WHEN perform a POST call
+ * THEN the call is not sent twice: the 503 is returned.
+ */
+TEST(Endpoints, Test_04) {
+    openair_test::HttpStubServer broken(unavailable);
+    openair_test::HttpStubServer server;
+    std::vector<std::string> addresses;
+    addresses.push_back(broken.address());
+    addresses.push_back(server.address());
+    openair::CurlConnectorOptions options;
+    options.endpoints.explore = 0;
+    openair::CurlServiceConnector connector(addresses, options);
+    // Both endpoints are unknown: the first one is chosen.
+    LONGS_EQUAL(503, connector.post_call("send/data", "{}").http_code);
+    LONGS_EQUAL(0, server.requests());
+}
+
+/**
+ * HAVE An empty list of addresses
+ * WHEN create a connector
+ * THEN a const char* is thrown.
+ */
+TEST(Endpoints, Test_05) {
+    std::vector<std::string> addresses;
+    try {
+        openair::CurlServiceConnector connector(addresses);
+        FAIL("Expected exception");
+    } catch (const char *) { }
+}
@@ -0,0 +1,152 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/hedging.cc
+ * \brief     Test the hedged GET calls.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the HedgingPolicy of the
+ * CurlServiceConnector.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+#include "../support/test_support.hh"
+
+namespace {
+    openair::CurlConnectorOptions hedging(double extra_load) {
+        openair::CurlConnectorOptions options;
+        options.hedging.enabled = true;
+        options.hedging.initial_delay_ms = 50;
+        options.hedging.max_extra_load = extra_load;
+        return options;
+    }
+}
+
+TEST_GROUP(Hedging) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector with hedging enabled and a service stalling on the
+ *      first request only
+ * WHEN perform a GET call
+ * THEN the hedge answers first, without waiting for the stalled
+ *      request, and it is counted as sent and won.
+ */
+TEST(Hedging, Test_01) {
+    std::atomic<int> seen(0);
+    openair_test::HttpStubServer server(
+        [&seen](const openair_test::StubRequest&,
+                openair_test::StubResponse& response) {
+            if (seen++ == 0) {
+                response.delay_ms = 1000;
+                response.body = "{\"from\":\"primary\"}";
+            } else {
+                response.body = "{\"from\":\"hedge\"}";
+            }
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            hedging(1));
+    auto start = std::chrono::steady_clock::now();
+    auto response = connector.get_call("get/data");
+    CHECK(openair_test::elapsed_ms(start) < 500);
+    LONGS_EQUAL(200, response.http_code);
+    STRCMP_EQUAL("{\"from\":\"hedge\"}", response.http_body.c_str());
+    auto stats = connector.hedging_stats();
+    LONGS_EQUAL(1, stats.calls);
+    LONGS_EQUAL(1, stats.hedges_sent);
+    LONGS_EQUAL(1, stats.hedges_won);
+}
+
+/**
+ * HAVE A connector with the default options and a slow service
+ * WHEN perform a GET call
+ * THEN no hedge is sent and every counter is zero.
+ */
+TEST(Hedging, Test_02) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 200;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto start = std::chrono::steady_clock::now();
+    auto response = connector.get_call("get/data");
+    CHECK(openair_test::elapsed_ms(start) >= 200);
+    LONGS_EQUAL(200, response.http_code);
+    auto stats = connector.hedging_stats();
+    LONGS_EQUAL(0, stats.calls);
+    LONGS_EQUAL(0, stats.hedges_sent);
+    LONGS_EQUAL(1, server.requests());
+}
+
+/**
+ * HAVE A connector allowing 50% of extra load and a service always
+ *      slower than the hedging delay
+ * WHEN perform four GET calls
+ * THEN only two hedges are sent, the others are denied by the budget.
+ */
+TEST(Hedging, Test_03) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 100;
+        });
+    auto options = hedging(0.5);
+    options.hedging.initial_delay_ms = 20;
+    openair::CurlServiceConnector connector(server.address(), options);
+    for (int i = 0; i < 4; ++i) {
+        LONGS_EQUAL(200, connector.get_call("get/data").http_code);
+    }
+    auto stats = connector.hedging_stats();
+    LONGS_EQUAL(4, stats.calls);
+    LONGS_EQUAL(2, stats.hedges_sent);
+    LONGS_EQUAL(2, stats.hedges_denied);
+}
+
+/**
+ * HAVE A connector with hedging enabled and a fast service
+ * WHEN perform enough GET calls to know the latencies
+ * THEN the delay drops from the initial one to the minimum delay.
+ */
+TEST(Hedging, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address(),
+                                            hedging(0.05));
+    LONGS_EQUAL(50, connector.hedging_stats().delay_ms);
+    for (int i = 0; i < 64; ++i) {
+        LONGS_EQUAL(200, connector.get_call("get/data").http_code);
+    }
+    auto stats = connector.hedging_stats();
+    LONGS_EQUAL(64, stats.calls);
+    LONGS_EQUAL(5, stats.delay_ms);
+    LONGS_EQUAL(0, stats.hedges_sent);
+}
@@ -0,0 +1,235 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/http2.cc
+ * \brief     Test the HTTP/2 mode of the connector.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the http_version option of the
+ * CurlServiceConnector: the fallback on servers speaking HTTP/1.1,
+ * the calls routed on the event loop and, on an h2 stub server, the
+ * multiplexing of concurrent calls on one connection.
+ */
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+#include "../stub/http2_stub_server.hh"
+
+namespace {
+    openair::CurlConnectorOptions http2_options() {
+        openair::CurlConnectorOptions options;
+        options.http_version = openair::HTTP_VERSION_2;
+        return options;
+    }
+}
+
+TEST_GROUP(Http2) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector with the default options
+ * WHEN perform a call
+ * THEN the response reports HTTP/1.1.
+ */
+TEST(Http2, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto response = connector.get_call("settings");
+    LONGS_EQUAL(200, response.http_code);
+    LONGS_EQUAL(openair::HTTP_VERSION_1_1, response.http_version);
+}
+
+/**
+ * HAVE A connector in HTTP/2 mode and a server speaking HTTP/1.1
+ * WHEN perform GET and POST calls
+ * THEN the calls fall back to HTTP/1.1 and succeed.
+ */
+TEST(Http2, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address(),
+                                            http2_options());
+    auto get = connector.get_call("settings", "a=1");
+    auto post = connector.post_call("send/data", "{\"a\":1}");
+    LONGS_EQUAL(200, get.http_code);
+    CHECK_EQUAL(std::string("{}"), get.http_body);
+    LONGS_EQUAL(openair::HTTP_VERSION_1_1, get.http_version);
+    LONGS_EQUAL(200, post.http_code);
+    LONGS_EQUAL(openair::HTTP_VERSION_1_1, post.http_version);
+    CHECK_EQUAL(std::string("{\"a\":1}"), server.received()[1].body);
+}
+
+/**
+ * HAVE A connector in HTTP/2 mode
+ * WHEN a call fails
+ * THEN the synchronous call still throws the curl error.
+ */
+TEST(Http2, Test_03) {
+    openair::CurlServiceConnector connector("http://127.0.0.1:1",
+                                            http2_options());
+    bool thrown = false;
+    try {
+        connector.get_call("settings");
+    } catch (const char *error) {
+        thrown = true;
+    }
+    CHECK_TRUE(thrown);
+}
+
+/**
+ * HAVE A connector in HTTP/2 mode
+ * WHEN many threads perform synchronous calls at the same time
+ * THEN every call completes on the event loop.
+ */
+TEST(Http2, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address(),
+                                            http2_options());
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 8; ++i) {
+        producers.push_back(std::thread([&]() {
+            for (int call = 0; call < 50; ++call) {
+                if (connector.post_call("send/data", "{}").http_code ==
+                    200) {
+                    ++succeeded;
+                }
+            }
+        }));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    LONGS_EQUAL(400, succeeded.load());
+    LONGS_EQUAL(400, server.requests());
+}
+
+/**
+ * HAVE A connector in HTTP/2 mode
+ * WHEN perform a streamed GET and a produced POST
+ * THEN both bodies go through the event loop unchanged.
+ */
+TEST(Http2, Test_05) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest& request,
+           openair_test::StubResponse& response) {
+            response.body = request.body.empty() ? "streamed" : "ok";
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            http2_options());
+    std::string streamed;
+    auto get = connector.get_call(
+        "settings", "",
+        [&streamed](const char *data, std::size_t size) {
+            streamed.append(data, size);
+            return true;
+        });
+    LONGS_EQUAL(200, get.http_code);
+    CHECK_EQUAL(std::string("streamed"), streamed);
+
+    bool sent = false;
+    auto post = connector.post_call(
+        "send/data",
+        [&sent](char *buffer, std::size_t size) -> std::size_t {
+            if (sent || size < 2) {
+                return 0;
+            }
+            sent = true;
+            buffer[0] = '{';
+            buffer[1] = '}';
+            return 2;
+        });
+    LONGS_EQUAL(200, post.http_code);
+    CHECK_EQUAL(std::string("ok"), post.http_body);
+}
+
+/**
+ * HAVE A connector in HTTP/2 mode and a server speaking h2
+ * WHEN 8 threads perform slow synchronous calls at the same time
+ * THEN the calls are multiplexed as concurrent streams of a single
+ *      connection.
+ */
+TEST(Http2, Test_06) {
+    openair_test::Http2StubServer server(50);
+    openair::CurlConnectorOptions options = http2_options();
+    options.ca_file = server.ca_file();
+    openair::CurlServiceConnector connector(server.address(), options);
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 8; ++i) {
+        producers.push_back(std::thread([&]() {
+            for (int call = 0; call < 5; ++call) {
+                auto response = connector.post_call("send/data", "{}");
+                if (response.http_code == 200 &&
+                    response.http_version == openair::HTTP_VERSION_2 &&
+                    response.http_body == "{}") {
+                    ++succeeded;
+                }
+            }
+        }));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    LONGS_EQUAL(40, succeeded.load());
+    LONGS_EQUAL(40, server.requests());
+    LONGS_EQUAL(1, server.connections());
+    CHECK_TRUE(server.max_streams() > 1);
+}
+
+/**
+ * HAVE A connector in HTTP/2 mode and a server speaking h2
+ * WHEN a completion handler performs a synchronous call
+ * THEN the call completes instead of waiting on the engine running
+ *      the handler.
+ */
+TEST(Http2, Test_07) {
+    openair_test::Http2StubServer server;
+    openair::CurlConnectorOptions options = http2_options();
+    options.ca_file = server.ca_file();
+    openair::CurlServiceConnector connector(server.address(), options);
+    std::promise<long> nested;
+    connector.get_call_async(
+        "settings", "",
+        [&](openair::HttpResponse&& response, const char *error) {
+            if (error || response.http_code != 200) {
+                nested.set_value(-1);
+                return;
+            }
+            nested.set_value(
+                connector.post_call("send/data", "{}").http_code);
+        });
+    auto result = nested.get_future();
+    CHECK_TRUE(result.wait_for(std::chrono::seconds(5)) ==
+               std::future_status::ready);
+    LONGS_EQUAL(200, result.get());
+}
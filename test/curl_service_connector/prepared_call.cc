@@ -0,0 +1,230 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/prepared_call.cc
+ * \brief     Test the calls prepared once.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the PreparedCall returned by
+ * CurlServiceConnector::prepare. The soak test, a million calls, runs
+ * only when OPENAIR_SOAK_TESTS is set in the environment.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    long rss_kb() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmRSS:") == 0) {
+                return std::atol(line.c_str() + 6);
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * Performs warm_up, then rounds, couples of prepared and plain
+     * POST calls and returns the growth, in KiB, of the resident
+     * memory over the rounds. The warm up settles the connection and
+     * the allocator.
+     */
+    long post_growth_kb(const openair::CurlServiceConnector& connector,
+                        int warm_up, int rounds) {
+        auto call = connector.prepare("send/data");
+        const std::string body("{\"value\":1}");
+        for (int i = 0; i < warm_up; ++i) {
+            call.post(body);
+            connector.post_call("send/data", body);
+        }
+        long before = rss_kb();
+        for (int i = 0; i < rounds; ++i) {
+            call.post(body);
+            connector.post_call("send/data", body);
+        }
+        return rss_kb() - before;
+    }
+}
+
+TEST_GROUP(PreparedCall) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A call prepared with a fixed header
+ * WHEN perform some POST calls
+ * THEN each call reaches the method with the JSON content type, the
+ *      fixed header and its own body.
+ */
+TEST(PreparedCall, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto call = connector.prepare("send/data", {"X-Station: 12"});
+    LONGS_EQUAL(200, call.post("{\"a\":1}").http_code);
+    const char body[] = "{\"b\":2}";
+    LONGS_EQUAL(200, call.post(body, sizeof(body) - 1).http_code);
+    auto received = server.received();
+    LONGS_EQUAL(2, received.size());
+    for (const auto& request : received) {
+        CHECK_EQUAL(std::string("POST"), request.verb);
+        CHECK_EQUAL(std::string("/send/data"), request.target);
+        CHECK_EQUAL(std::string("application/json"),
+                    request.header("content-type"));
+        CHECK_EQUAL(std::string("12"), request.header("x-station"));
+    }
+    CHECK_EQUAL(std::string("{\"a\":1}"), received[0].body);
+    CHECK_EQUAL(std::string("{\"b\":2}"), received[1].body);
+}
+
+/**
+ * HAVE A prepared call
+ * WHEN perform GET calls with and without parameters
+ * THEN the targets are the method with the parameters passed.
+ */
+TEST(PreparedCall, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto call = connector.prepare("settings");
+    CHECK_EQUAL(std::string("{}"), call.get().http_body);
+    LONGS_EQUAL(200, call.get("id=3").http_code);
+    auto received = server.received();
+    CHECK_EQUAL(std::string("/settings"), received[0].target);
+    CHECK_EQUAL(std::string("/settings?id=3"), received[1].target);
+}
+
+/**
+ * HAVE A connector compressing the requests and a prepared call
+ * WHEN perform a POST call over the compression threshold
+ * THEN the body is sent compressed, with the fixed header.
+ */
+TEST(PreparedCall, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.request_encoding = openair::GZIP_ENCODING;
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto call = connector.prepare("send/data", {"X-Station: 12"});
+    call.post("[" + std::string(4096, '1') + "]");
+    auto request = server.received()[0];
+    CHECK_EQUAL(std::string("gzip"), request.header("content-encoding"));
+    CHECK_EQUAL(std::string("12"), request.header("x-station"));
+    CHECK(request.body.size() < 4096);
+}
+
+/**
+ * HAVE A connector and a prepared call
+ * WHEN perform twenty thousand POST calls
+ * THEN the memory of the process does not grow.
+ */
+TEST(PreparedCall, Test_04) {
+    openair_test::HttpStubServer server;
+    server.record_requests(false);
+    openair::CurlServiceConnector connector(server.address());
+    long growth = post_growth_kb(connector, 1000, 10000);
+    LONGS_EQUAL(22000, server.requests());
+    CHECK(growth < 1024);
+}
+
+/**
+ * HAVE A connector and a prepared call
+ * WHEN perform a million POST calls
+ * THEN the memory of the process does not grow.
+ */
+TEST(PreparedCall, Test_05) {
+    if (!std::getenv("OPENAIR_SOAK_TESTS")) {
+        return;
+    }
+    openair_test::HttpStubServer server;
+    server.record_requests(false);
+    openair::CurlServiceConnector connector(server.address());
+    long growth = post_growth_kb(connector, 10000, 500000);
+    LONGS_EQUAL(1020000, server.requests());
+    CHECK(growth < 1024);
+}
+
+/**
+ * HAVE A call prepared with a fixed header
+ * WHEN perform a POST, a GET and a POST call again, on the same
+ *      handle
+ * THEN the POST calls send the fixed header and their body, the GET
+ *      call sends neither and every call keeps the options of the
+ *      connector.
+ */
+TEST(PreparedCall, Test_06) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto call = connector.prepare("settings", {"X-Station: 12"});
+    call.post("{\"a\":1}");
+    LONGS_EQUAL(200, call.get("id=3").http_code);
+    call.post("{\"b\":2}");
+    auto received = server.received();
+    LONGS_EQUAL(3, received.size());
+    CHECK_EQUAL(std::string("POST"), received[0].verb);
+    CHECK_EQUAL(std::string("GET"), received[1].verb);
+    CHECK_EQUAL(std::string("/settings?id=3"), received[1].target);
+    CHECK_EQUAL(std::string(), received[1].header("x-station"));
+    CHECK_EQUAL(std::string(), received[1].header("content-type"));
+    CHECK_EQUAL(std::string(), received[1].body);
+    CHECK_EQUAL(std::string("POST"), received[2].verb);
+    CHECK_EQUAL(std::string("12"), received[2].header("x-station"));
+    CHECK_EQUAL(std::string("{\"b\":2}"), received[2].body);
+    for (const auto& request : received) {
+        CHECK(!request.header("accept-encoding").empty());
+    }
+}
+
+/**
+ * HAVE A connector retrying three times and a prepared call
+ * WHEN the service answers 503 to the first POST attempt
+ * THEN the call is retried and succeeds on the second attempt.
+ */
+TEST(PreparedCall, Test_07) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&calls](const openair_test::StubRequest&,
+                 openair_test::StubResponse& response) {
+            if (++calls == 1) {
+                response.status = 503;
+            }
+        });
+    openair::CurlConnectorOptions options;
+    options.retry.max_attempts = 3;
+    options.retry.initial_backoff_ms = 10;
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto call = connector.prepare("send/data");
+    auto result = call.try_post("{\"a\":1}");
+    CHECK_TRUE(result.ok());
+    LONGS_EQUAL(200, result.response.http_code);
+    UNSIGNED_LONGS_EQUAL(2, result.attempts);
+    LONGS_EQUAL(2, server.received().size());
+}
@@ -0,0 +1,152 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/request_bodies.cc
+ * \brief     Test the zero copy and streaming POST bodies.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the post_call overloads taking a
+ * pointer and a size, a list of buffers or a body producer.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+TEST_GROUP(RequestBodies) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A body containing a NUL byte
+ * WHEN it is sent as pointer and size
+ * THEN the service receives every byte.
+ */
+TEST(RequestBodies, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    const char data[] = "{\"a\":\"\0\"}";
+    connector.post_call("send/data", data, sizeof(data) - 1);
+    auto request = server.received().front();
+    LONGS_EQUAL(sizeof(data) - 1, request.body.size());
+    CHECK(std::memcmp(data, request.body.data(), request.body.size())
+          == 0);
+}
+
+/**
+ * HAVE Three buffers
+ * WHEN they are sent as a scatter list
+ * THEN the service receives their concatenation with a
+ *      Content-Length.
+ */
+TEST(RequestBodies, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::string first = "[{\"i\":1}";
+    std::string second = ",{\"i\":2}";
+    std::string third = "]";
+    std::vector<openair::ConstBuffer> buffers = {
+        {first.data(), first.size()},
+        {second.data(), second.size()},
+        {third.data(), third.size()}
+    };
+    auto response = connector.post_call("send/data", buffers);
+    LONGS_EQUAL(200, response.http_code);
+    auto request = server.received().front();
+    CHECK_EQUAL(first + second + third, request.body);
+    CHECK_EQUAL(std::to_string(request.body.size()),
+                request.header("content-length"));
+}
+
+/**
+ * HAVE Many buffers for several megabytes
+ * WHEN they are sent as a scatter list
+ * THEN the service receives all of them.
+ */
+TEST(RequestBodies, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::string block(64 * 1024, 'x');
+    std::vector<openair::ConstBuffer> buffers(
+        64, openair::ConstBuffer{block.data(), block.size()});
+    connector.post_call("send/data", buffers);
+    LONGS_EQUAL(64 * block.size(), server.received().front().body.size());
+}
+
+/**
+ * HAVE A producer generating five chunks
+ * WHEN it is used as body of a POST call
+ * THEN the body is sent chunked and received entirely.
+ */
+TEST(RequestBodies, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    int produced = 0;
+    auto response = connector.post_call(
+        "send/data",
+        [&](char *buffer, std::size_t capacity) -> std::size_t {
+            if (produced == 5) {
+                return 0;
+            }
+            ++produced;
+            std::string chunk = "chunk" + std::to_string(produced);
+            CHECK(chunk.size() <= capacity);
+            std::memcpy(buffer, chunk.data(), chunk.size());
+            return chunk.size();
+        });
+    LONGS_EQUAL(200, response.http_code);
+    auto request = server.received().front();
+    CHECK_EQUAL(std::string("chunked"),
+                request.header("transfer-encoding"));
+    CHECK_EQUAL(std::string("chunk1chunk2chunk3chunk4chunk5"),
+                request.body);
+}
+
+/**
+ * HAVE A producer throwing an exception
+ * WHEN it is used as body of a POST call
+ * THEN post_call rethrows the producer exception.
+ */
+TEST(RequestBodies, Test_05) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    bool thrown = false;
+    try {
+        connector.post_call(
+            "send/data",
+            [](char *, std::size_t) -> std::size_t {
+                throw std::runtime_error("producer failure");
+            });
+    } catch (const std::runtime_error& error) {
+        thrown = true;
+        CHECK_EQUAL(std::string("producer failure"), error.what());
+    }
+    CHECK(thrown);
+}
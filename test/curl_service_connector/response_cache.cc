@@ -0,0 +1,277 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/response_cache.cc
+ * \brief     Test the response headers and the response cache.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the headers of HttpResponse and
+ * for the conditional GET cache of the CurlServiceConnector.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    /*
+     * Service answering 304 when the request carries the validator
+     * of the current version, otherwise the full body.
+     */
+    openair_test::HttpStubServer::handler_t versioned(
+        const std::string& header, const std::string& value,
+        const std::string& condition, const std::string& body) {
+        return [=](const openair_test::StubRequest& request,
+                   openair_test::StubResponse& response) {
+            response.headers.push_back(std::make_pair(header, value));
+            if (request.header(condition) == value) {
+                response.status = 304;
+                response.body.clear();
+            } else {
+                response.body = body;
+            }
+        };
+    }
+
+    openair::CurlConnectorOptions caching() {
+        openair::CurlConnectorOptions options;
+        options.cache.enabled = true;
+        return options;
+    }
+}
+
+TEST_GROUP(ResponseCache) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector capturing the headers and a service answering
+ *      with custom headers
+ * WHEN perform a GET call
+ * THEN the response contains the headers with lower case names.
+ */
+TEST(ResponseCache, Test_01) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.headers.push_back(
+                std::make_pair("X-Station", " 12 "));
+        });
+    openair::CurlConnectorOptions options;
+    options.capture_headers = true;
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto response = connector.get_call("get/data");
+    CHECK_EQUAL(std::string("12"), response.header("x-station"));
+    CHECK_EQUAL(std::string("2"), response.header("content-length"));
+    CHECK_EQUAL(std::string(), response.header("etag"));
+    CHECK(!response.from_cache);
+}
+
+/**
+ * HAVE A connector with the cache and a service sending an ETag
+ * WHEN perform the same GET call twice
+ * THEN the second call sends If-None-Match and gets the cached body
+ *      with the original code.
+ */
+TEST(ResponseCache, Test_02) {
+    openair_test::HttpStubServer server(
+        versioned("ETag", "\"v1\"", "if-none-match",
+                  "{\"calibration\":1}"));
+    openair::CurlServiceConnector connector(server.address(), caching());
+    auto first = connector.get_call("settings", "id=3");
+    auto second = connector.get_call("settings", "id=3");
+    LONGS_EQUAL(200, second.http_code);
+    CHECK(!first.from_cache);
+    CHECK(second.from_cache);
+    CHECK_EQUAL(first.http_body, second.http_body);
+    auto received = server.received();
+    LONGS_EQUAL(2, received.size());
+    CHECK_EQUAL(std::string(), received[0].header("if-none-match"));
+    CHECK_EQUAL(std::string("\"v1\""),
+                received[1].header("if-none-match"));
+    auto stats = connector.cache_stats();
+    LONGS_EQUAL(1, stats.hits);
+    LONGS_EQUAL(1, stats.misses);
+    LONGS_EQUAL(1, stats.entries);
+}
+
+/**
+ * HAVE A connector with the cache and a service sending only a
+ *      Last-Modified header
+ * WHEN perform the same GET call twice
+ * THEN the second call sends If-Modified-Since and is served from the
+ *      cache.
+ */
+TEST(ResponseCache, Test_03) {
+    const std::string date("Wed, 21 Oct 2015 07:28:00 GMT");
+    openair_test::HttpStubServer server(
+        versioned("Last-Modified", date, "if-modified-since",
+                  "{\"settings\":1}"));
+    openair::CurlServiceConnector connector(server.address(), caching());
+    connector.get_call("settings");
+    auto response = connector.get_call("settings");
+    CHECK(response.from_cache);
+    CHECK_EQUAL(std::string("{\"settings\":1}"), response.http_body);
+    CHECK_EQUAL(date, server.received()[1].header("if-modified-since"));
+}
+
+/**
+ * HAVE A connector with a cache of 300 bytes
+ * WHEN perform GET calls to three methods with 80 bytes bodies
+ * THEN the least recently used response is evicted and its method is
+ *      downloaded again.
+ */
+TEST(ResponseCache, Test_04) {
+    openair_test::HttpStubServer server(
+        versioned("ETag", "\"v1\"", "if-none-match",
+                  std::string(80, 'x')));
+    auto options = caching();
+    options.cache.max_bytes = 300;
+    openair::CurlServiceConnector connector(server.address(), options);
+    connector.get_call("a");
+    connector.get_call("b");
+    connector.get_call("a");
+    connector.get_call("c");
+    auto stats = connector.cache_stats();
+    LONGS_EQUAL(1, stats.evictions);
+    LONGS_EQUAL(2, stats.entries);
+    CHECK(stats.bytes <= 300);
+    CHECK(connector.get_call("a").from_cache);
+    CHECK(!connector.get_call("b").from_cache);
+}
+
+/**
+ * HAVE A connector with a cache file
+ * WHEN a second connector with the same file calls the same method
+ * THEN its first call is already served from the cache.
+ */
+TEST(ResponseCache, Test_05) {
+    openair_test::HttpStubServer server(
+        versioned("ETag", "\"v7\"", "if-none-match", "{\"remote\":7}"));
+    auto options = caching();
+    options.cache.path = "/tmp/openair_cache_" +
+        std::to_string(getpid());
+    {
+        openair::CurlServiceConnector connector(server.address(),
+                                                options);
+        connector.get_call("settings");
+    }
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto response = connector.get_call("settings");
+    CHECK(response.from_cache);
+    CHECK_EQUAL(std::string("{\"remote\":7}"), response.http_body);
+    std::remove(options.cache.path.c_str());
+}
+
+/**
+ * HAVE A connector with the default options and a service sending an
+ *      ETag
+ * WHEN perform the same GET call twice
+ * THEN no conditional header is sent and the body is downloaded twice.
+ */
+TEST(ResponseCache, Test_06) {
+    openair_test::HttpStubServer server(
+        versioned("ETag", "\"v1\"", "if-none-match", "{}"));
+    openair::CurlServiceConnector connector(server.address());
+    connector.get_call("settings");
+    auto response = connector.get_call("settings");
+    CHECK(!response.from_cache);
+    CHECK_EQUAL(std::string(), server.received()[1].header("if-none-match"));
+    LONGS_EQUAL(0, connector.cache_stats().misses);
+}
+
+/**
+ * HAVE A connector with the cache and a service sending an ETag with
+ *      "Cache-Control: no-store"
+ * WHEN perform the same GET call twice
+ * THEN the response is not cached and the body is downloaded twice.
+ */
+TEST(ResponseCache, Test_07) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.headers.push_back(std::make_pair("ETag", "\"v1\""));
+            response.headers.push_back(
+                std::make_pair("Cache-Control", "private, No-Store"));
+        });
+    openair::CurlServiceConnector connector(server.address(), caching());
+    connector.get_call("settings");
+    auto response = connector.get_call("settings");
+    CHECK(!response.from_cache);
+    CHECK_EQUAL(std::string(), server.received()[1].header("if-none-match"));
+    LONGS_EQUAL(0, connector.cache_stats().entries);
+}
+
+/**
+ * HAVE A cache file whose second entry declares a body larger than
+ *      the cache budget
+ * WHEN a connector loads it
+ * THEN the first entry is loaded and the corrupt one is dropped.
+ */
+TEST(ResponseCache, Test_08) {
+    auto options = caching();
+    options.cache.path = "/tmp/openair_cache_" +
+        std::to_string(getpid());
+    {
+        std::ofstream out(options.cache.path.c_str(), std::ios::binary);
+        out << "openair-response-cache 1\n"
+            << "8 4 0 2 200\nsettings\"v1\"{}"
+            << "5 4 0 18446744073709551615 200\nother\"v2\"";
+    }
+    openair::CurlServiceConnector connector("http://127.0.0.1:1",
+                                            options);
+    auto stats = connector.cache_stats();
+    LONGS_EQUAL(1, stats.entries);
+    LONGS_EQUAL(14, stats.bytes);
+    std::remove(options.cache.path.c_str());
+}
+
+/**
+ * HAVE A connector without cache nor header capture and a service
+ *      answering with custom headers and a Retry-After
+ * WHEN perform a GET call
+ * THEN the response keeps no header but still reads the Retry-After.
+ */
+TEST(ResponseCache, Test_09) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.headers.push_back(
+                std::make_pair("X-Station", "12"));
+            response.headers.push_back(
+                std::make_pair("Retry-After", "3"));
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto response = connector.get_call("get/data");
+    LONGS_EQUAL(200, response.http_code);
+    LONGS_EQUAL(0, response.http_headers.size());
+    CHECK_EQUAL(std::string(), response.header("x-station"));
+    LONGS_EQUAL(3, response.retry_after_s);
+}
@@ -0,0 +1,161 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/response_sink.cc
+ * \brief     Test the streamed response bodies.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the get_call overloads streaming
+ * the response body to a sink or a stream.
+ */
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    std::string firmware(std::size_t size) {
+        std::string data(size, '\0');
+        for (std::size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>('a' + i % 26);
+        }
+        return data;
+    }
+}
+
+TEST_GROUP(ResponseSink) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A service returning a body of 2 MiB
+ * WHEN a GET call streams it to a sink
+ * THEN the sink receives the whole body in many chunks and the
+ *      response body is empty.
+ */
+TEST(ResponseSink, Test_01) {
+    std::string body = firmware(2 * 1024 * 1024);
+    openair_test::HttpStubServer server(
+        [&](const openair_test::StubRequest&,
+            openair_test::StubResponse& response) {
+            response.body = body;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    std::string received;
+    int chunks = 0;
+    auto response = connector.get_call(
+        "firmware", "",
+        [&](const char *data, std::size_t size) {
+            received.append(data, size);
+            ++chunks;
+            return true;
+        });
+    LONGS_EQUAL(200, response.http_code);
+    CHECK(response.http_body.empty());
+    CHECK(chunks > 1);
+    CHECK(body == received);
+}
+
+/**
+ * HAVE A service returning a body
+ * WHEN a GET call writes it to a stream
+ * THEN the stream contains the body.
+ */
+TEST(ResponseSink, Test_02) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.body = "calibration table";
+        });
+    openair::CurlServiceConnector connector(server.address());
+    std::ostringstream out;
+    connector.get_call("calibration", "v=2", out);
+    CHECK_EQUAL(std::string("calibration table"), out.str());
+    CHECK_EQUAL(std::string("/calibration?v=2"),
+                server.received().front().target);
+}
+
+/**
+ * HAVE A sink refusing the data
+ * WHEN a GET call streams to it
+ * THEN a const char* is thrown.
+ */
+TEST(ResponseSink, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    bool thrown = false;
+    try {
+        connector.get_call("firmware", "",
+                           [](const char *, std::size_t) {
+                               return false;
+                           });
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * HAVE A sink throwing an exception
+ * WHEN a GET call streams to it
+ * THEN get_call rethrows the sink exception.
+ */
+TEST(ResponseSink, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    bool thrown = false;
+    try {
+        connector.get_call(
+            "firmware", "",
+            [](const char *, std::size_t) -> bool {
+                throw std::runtime_error("disk full");
+            });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * HAVE A service returning a body with its Content-Length
+ * WHEN a buffered GET call is performed
+ * THEN the body is reserved once with the announced size.
+ */
+TEST(ResponseSink, Test_05) {
+    std::string body = firmware(1000000);
+    openair_test::HttpStubServer server(
+        [&](const openair_test::StubRequest&,
+            openair_test::StubResponse& response) {
+            response.body = body;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto response = connector.get_call("firmware");
+    CHECK(body == response.http_body);
+    UNSIGNED_LONGS_EQUAL(body.size(), response.http_body.capacity());
+}
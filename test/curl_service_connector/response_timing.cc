@@ -0,0 +1,106 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/response_timing.cc
+ * \brief     Test the timing breakdown of the responses.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the HttpTiming filled by the
+ * connector calls.
+ */
+
+#include <string>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+TEST_GROUP(ResponseTiming) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A new response
+ * WHEN it is default constructed
+ * THEN every timing value is zero.
+ */
+TEST(ResponseTiming, Test_01) {
+    openair::HttpResponse response;
+    LONGS_EQUAL(0, response.timing.total_us);
+    LONGS_EQUAL(0, response.timing.bytes_received);
+    CHECK_FALSE(response.timing.connection_reused);
+}
+
+/**
+ * HAVE A service answering after 50 ms
+ * WHEN a POST call is performed
+ * THEN the phases are ordered and the server time shows in the
+ *      start transfer phase.
+ */
+TEST(ResponseTiming, Test_02) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 50;
+            response.body = "{\"ok\":true}";
+        });
+    openair::CurlServiceConnector connector(server.address());
+    auto response = connector.post_call("send/data", "{\"v\":1}");
+    const openair::HttpTiming& timing = response.timing;
+    CHECK(timing.connect_us >= timing.namelookup_us);
+    CHECK(timing.pretransfer_us >= timing.connect_us);
+    CHECK(timing.starttransfer_us >= timing.pretransfer_us);
+    CHECK(timing.total_us >= timing.starttransfer_us);
+    CHECK(timing.starttransfer_us - timing.pretransfer_us >= 50000);
+    LONGS_EQUAL(7, timing.bytes_sent);
+    LONGS_EQUAL(11, timing.bytes_received);
+}
+
+/**
+ * HAVE A connector with a warm connection
+ * WHEN two calls are performed
+ * THEN only the second call reuses the connection.
+ */
+TEST(ResponseTiming, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto first = connector.get_call("settings");
+    auto second = connector.get_call("settings");
+    CHECK_FALSE(first.timing.connection_reused);
+    CHECK(second.timing.connection_reused);
+}
+
+/**
+ * HAVE A running service
+ * WHEN an async call is performed
+ * THEN its timing is filled too.
+ */
+TEST(ResponseTiming, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    auto response = connector.get_call_async("settings").get();
+    CHECK(response.timing.total_us > 0);
+    LONGS_EQUAL(2, response.timing.bytes_received);
+}
@@ -0,0 +1,316 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/retries.cc
+ * \brief     Test the timeouts, the retries and the deadlines.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the timeouts, the RetryPolicy and
+ * the deadlines of the CurlServiceConnector.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+#include "../support/test_support.hh"
+
+namespace {
+    openair::CurlConnectorOptions retrying(unsigned attempts) {
+        openair::CurlConnectorOptions options;
+        options.retry.max_attempts = attempts;
+        options.retry.initial_backoff_ms = 10;
+        return options;
+    }
+}
+
+TEST_GROUP(Retries) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector with a timeout of 200 ms and a hung service
+ * WHEN perform a call
+ * THEN the call fails as timed out without waiting for the service.
+ */
+TEST(Retries, Test_01) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 1000;
+        });
+    openair::CurlConnectorOptions options;
+    options.timeout_ms = 200;
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto start = std::chrono::steady_clock::now();
+    auto result = connector.try_post_call("send/data", "{}");
+    LONGS_EQUAL(openair::CALL_TIMEOUT, result.error);
+    CHECK(openair_test::elapsed_ms(start) < 900);
+}
+
+/**
+ * HAVE A connector with three attempts and a service failing twice
+ *      with 503
+ * WHEN perform a POST call
+ * THEN the third attempt succeeds with the same body.
+ */
+TEST(Retries, Test_02) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&calls](const openair_test::StubRequest&,
+                 openair_test::StubResponse& response) {
+            if (++calls <= 2) {
+                response.status = 503;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            retrying(3));
+    auto result = connector.try_post_call("send/data", "{\"a\":1}");
+    CHECK_TRUE(result.ok());
+    LONGS_EQUAL(200, result.response.http_code);
+    UNSIGNED_LONGS_EQUAL(3, result.attempts);
+    auto received = server.received();
+    LONGS_EQUAL(3, received.size());
+    CHECK_EQUAL(std::string("{\"a\":1}"), received[2].body);
+}
+
+/**
+ * HAVE A connector with retries and a service answering 400
+ * WHEN perform a call
+ * THEN the call is not retried.
+ */
+TEST(Retries, Test_03) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 400;
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            retrying(5));
+    auto response = connector.post_call("send/data", "{}");
+    LONGS_EQUAL(400, response.http_code);
+    LONGS_EQUAL(1, server.requests());
+}
+
+/**
+ * HAVE A connector with retries and a service asking to retry after
+ *      one second
+ * WHEN perform a call
+ * THEN the second attempt waits at least one second.
+ */
+TEST(Retries, Test_04) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&calls](const openair_test::StubRequest&,
+                 openair_test::StubResponse& response) {
+            if (++calls == 1) {
+                response.status = 429;
+                response.headers.push_back({"Retry-After", "1"});
+            }
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            retrying(2));
+    auto start = std::chrono::steady_clock::now();
+    auto response = connector.get_call("settings");
+    LONGS_EQUAL(200, response.http_code);
+    CHECK(openair_test::elapsed_ms(start) >= 1000);
+}
+
+/**
+ * HAVE A connector with many attempts, a deadline of 350 ms and a
+ *      service always answering 503
+ * WHEN perform a call
+ * THEN the call gives up within the deadline with the last answer.
+ */
+TEST(Retries, Test_05) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 503;
+        });
+    openair::CurlConnectorOptions options = retrying(50);
+    options.retry.initial_backoff_ms = 100;
+    options.deadline_ms = 350;
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto start = std::chrono::steady_clock::now();
+    auto result = connector.try_get_call("settings");
+    CHECK(openair_test::elapsed_ms(start) <= 400);
+    CHECK_TRUE(result.ok());
+    LONGS_EQUAL(503, result.response.http_code);
+    CHECK(result.attempts < 50);
+}
+
+/**
+ * HAVE A connector with retries and a hung service
+ * WHEN perform a call with a deadline of 300 ms
+ * THEN every attempt is cut to the time left and the call ends
+ *      within the deadline.
+ */
+TEST(Retries, Test_06) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 1000;
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            retrying(10));
+    auto start = std::chrono::steady_clock::now();
+    auto result = connector.try_post_call(
+        "send/data", "{}", std::chrono::milliseconds(300));
+    LONGS_EQUAL(openair::CALL_TIMEOUT, result.error);
+    CHECK(openair_test::elapsed_ms(start) < 450);
+}
+
+/**
+ * HAVE A connector with three attempts and a service not listening
+ * WHEN perform a call
+ * THEN the call is attempted three times before failing.
+ */
+TEST(Retries, Test_07) {
+    openair::CurlServiceConnector connector("http://127.0.0.1:1",
+                                            retrying(3));
+    auto result = connector.try_post_call("send/data", "{}");
+    LONGS_EQUAL(openair::CALL_CONNECT_FAILED, result.error);
+    UNSIGNED_LONGS_EQUAL(3, result.attempts);
+}
+
+/**
+ * HAVE A connector with three attempts and a service answering 503
+ *      to the first call
+ * WHEN send three buffers as a scatter list
+ * THEN the call is retried and the second request carries the whole
+ *      body again.
+ */
+TEST(Retries, Test_08) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&calls](const openair_test::StubRequest&,
+                 openair_test::StubResponse& response) {
+            if (++calls == 1) {
+                response.status = 503;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            retrying(3));
+    std::string first = "[1";
+    std::string second = ",2";
+    std::string third = "]";
+    std::vector<openair::ConstBuffer> buffers = {
+        {first.data(), first.size()},
+        {second.data(), second.size()},
+        {third.data(), third.size()}
+    };
+    LONGS_EQUAL(200, connector.post_call("send/data", buffers).http_code);
+    auto received = server.received();
+    LONGS_EQUAL(2, received.size());
+    CHECK_EQUAL(std::string("[1,2]"), received[0].body);
+    CHECK_EQUAL(std::string("[1,2]"), received[1].body);
+}
+
+/**
+ * HAVE A connector with three attempts and a service always
+ *      answering 503
+ * WHEN send a body from a producer
+ * THEN the call is not retried: the body can not be produced twice.
+ */
+TEST(Retries, Test_09) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 503;
+        });
+    openair::CurlServiceConnector connector(server.address(),
+                                            retrying(3));
+    bool produced = false;
+    auto response = connector.post_call(
+        "send/data",
+        [&](char *buffer, std::size_t) -> std::size_t {
+            if (produced) {
+                return 0;
+            }
+            produced = true;
+            std::memcpy(buffer, "{}", 2);
+            return 2;
+        });
+    LONGS_EQUAL(503, response.http_code);
+    LONGS_EQUAL(1, server.received().size());
+}
+
+/**
+ * HAVE A connector with three attempts and a service not listening
+ * WHEN send a body from a producer
+ * THEN the call is attempted three times, the producer is never
+ *      called and the call fails.
+ */
+TEST(Retries, Test_10) {
+    openair::CurlServiceConnector connector("http://127.0.0.1:1",
+                                            retrying(3));
+    int produced = 0;
+    bool thrown = false;
+    try {
+        connector.post_call("send/data",
+                            [&](char *, std::size_t) -> std::size_t {
+                                ++produced;
+                                return 0;
+                            });
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK_TRUE(thrown);
+    LONGS_EQUAL(0, produced);
+}
+
+/**
+ * HAVE A connector with a deadline of 300 ms and a hung service
+ * WHEN perform a GET call into a sink
+ * THEN the call is cut to the deadline and fails.
+ */
+TEST(Retries, Test_11) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 1000;
+        });
+    openair::CurlConnectorOptions options = retrying(3);
+    options.deadline_ms = 300;
+    openair::CurlServiceConnector connector(server.address(), options);
+    auto start = std::chrono::steady_clock::now();
+    bool thrown = false;
+    try {
+        connector.get_call("settings", "",
+                           [](const char *, std::size_t) {
+                               return true;
+                           });
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK_TRUE(thrown);
+    CHECK(openair_test::elapsed_ms(start) < 450);
+}
@@ -0,0 +1,133 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/shared_caches.cc
+ * \brief     Test the process wide shared caches.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the share_caches option of the
+ * CurlServiceConnector.
+ */
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    openair::CurlConnectorOptions shared_options() {
+        openair::CurlConnectorOptions options;
+        options.share_caches = true;
+        return options;
+    }
+}
+
+TEST_GROUP(SharedCaches) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE Two connectors sharing the caches
+ * WHEN each of them calls the same service
+ * THEN each connector opens its own connection.
+ */
+TEST(SharedCaches, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector data(server.address(), shared_options());
+    openair::CurlServiceConnector errors(server.address(),
+                                         shared_options());
+    data.post_call("send/data", "{}");
+    auto response = errors.post_call("send/errors", "{}");
+    LONGS_EQUAL(200, response.http_code);
+    CHECK_FALSE(response.timing.connection_reused);
+    LONGS_EQUAL(2, server.connections());
+}
+
+/**
+ * HAVE Two connectors not sharing the caches
+ * WHEN each of them calls the same service
+ * THEN each connector opens its own connection.
+ */
+TEST(SharedCaches, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector data(server.address());
+    openair::CurlServiceConnector errors(server.address());
+    data.post_call("send/data", "{}");
+    errors.post_call("send/errors", "{}");
+    LONGS_EQUAL(2, server.connections());
+}
+
+/**
+ * HAVE Eight threads, each with its own sharing connector
+ * WHEN they call the service one after the other
+ * THEN each connector reuses its own connection.
+ */
+TEST(SharedCaches, Test_03) {
+    openair_test::HttpStubServer server;
+    for (int i = 0; i < 8; ++i) {
+        std::thread worker([&]() {
+            openair::CurlServiceConnector connector(server.address(),
+                                                    shared_options());
+            for (int call = 0; call < 10; ++call) {
+                connector.get_call("settings");
+            }
+        });
+        worker.join();
+    }
+    LONGS_EQUAL(80, server.requests());
+    LONGS_EQUAL(8, server.connections());
+}
+
+/**
+ * HAVE Eight threads, each with its own sharing connector
+ * WHEN they call the service at the same time
+ * THEN every call succeeds.
+ */
+TEST(SharedCaches, Test_04) {
+    openair_test::HttpStubServer server;
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 8; ++i) {
+        workers.push_back(std::thread([&]() {
+            openair::CurlServiceConnector connector(server.address(),
+                                                    shared_options());
+            for (int call = 0; call < 50; ++call) {
+                if (connector.post_call("send/data", "{}").http_code ==
+                    200) {
+                    ++succeeded;
+                }
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    LONGS_EQUAL(400, succeeded.load());
+    LONGS_EQUAL(400, server.requests());
+}
@@ -0,0 +1,154 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      curl_service_connector/thread_safety.cc
+ * \brief     Test the connector shared by many threads.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the stress test suite of one CurlServiceConnector
+ * called at the same time by many producer threads.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../../src/curl_handle_pool.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    const int THREADS = 8;
+    const int CALLS = 250;
+}
+
+TEST_GROUP(ThreadSafety) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A connector with a pool as big as the number of threads
+ * WHEN many threads perform POST calls at the same time
+ * THEN every call succeeds and each thread keeps a warm connection.
+ */
+TEST(ThreadSafety, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlConnectorOptions options;
+    options.pool_size = THREADS;
+    openair::CurlServiceConnector connector(server.address(), options);
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < THREADS; ++i) {
+        producers.push_back(std::thread([&]() {
+            for (int call = 0; call < CALLS; ++call) {
+                auto response = connector.post_call("send/data",
+                                                    "{\"t\":1}");
+                if (response.http_code == 200) {
+                    ++succeeded;
+                }
+            }
+        }));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    LONGS_EQUAL(THREADS * CALLS, succeeded.load());
+    LONGS_EQUAL(THREADS * CALLS, server.requests());
+    CHECK(server.connections() <= THREADS);
+}
+
+/**
+ * HAVE A connector shared by many threads
+ * WHEN the threads mix synchronous and asynchronous calls
+ * THEN every call completes with the expected body.
+ */
+TEST(ThreadSafety, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> producers;
+    for (int i = 0; i < THREADS; ++i) {
+        producers.push_back(std::thread([&, i]() {
+            for (int call = 0; call < CALLS / 5; ++call) {
+                openair::HttpResponse response(
+                    (i + call) % 2 == 0 ?
+                    connector.get_call_async("settings").get() :
+                    connector.get_call("settings"));
+                if (response.http_code == 200 &&
+                    response.http_body == "{}") {
+                    ++succeeded;
+                }
+            }
+        }));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    LONGS_EQUAL(THREADS * (CALLS / 5), succeeded.load());
+}
+
+/**
+ * HAVE A pool of four handles
+ * WHEN many threads lease and release handles at the same time
+ * THEN no handle is ever leased twice and at most four stay idle.
+ */
+TEST(ThreadSafety, Test_03) {
+    openair::CurlHandlePool pool(4, 60);
+    std::atomic<int> collisions(0);
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::vector<CURL*> leased;
+    for (int i = 0; i < THREADS; ++i) {
+        workers.push_back(std::thread([&]() {
+            for (int round = 0; round < 1000; ++round) {
+                auto lease = pool.acquire();
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (CURL *other : leased) {
+                        if (other == lease.get()) {
+                            ++collisions;
+                        }
+                    }
+                    leased.push_back(lease.get());
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                for (auto it = leased.begin(); it != leased.end(); ++it) {
+                    if (*it == lease.get()) {
+                        leased.erase(it);
+                        break;
+                    }
+                }
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    LONGS_EQUAL(0, collisions.load());
+    CHECK(pool.idle() <= 4);
+}
@@ -0,0 +1,219 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      event_loop/event_loop.cc
+ * \brief     Test the connector driven by an application event loop.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for EpollLoop and for the async calls
+ * of a CurlServiceConnector created with an event loop.
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/curl_service_connector.hh"
+#include "../../src/libopenair/event_loop.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    /* Client counting the timeouts. */
+    struct TimerClient : public openair::EventLoopClient {
+        int timeouts;
+
+        TimerClient() : timeouts(0) { }
+        void on_socket(int, int) { }
+        void on_timeout() { ++timeouts; }
+    };
+
+    /* Client destroying its peer, timer cancelled, on its timeout. */
+    struct PeerClient : public openair::EventLoopClient {
+        openair::EventLoop& loop;
+        std::unique_ptr<PeerClient> *peer;
+        int timeouts;
+
+        explicit PeerClient(openair::EventLoop& loop)
+            : loop(loop), peer(NULL), timeouts(0) { }
+        void on_socket(int, int) { }
+        void on_timeout() {
+            ++timeouts;
+            if (*peer) {
+                loop.schedule(**peer, -1);
+                peer->reset();
+            }
+        }
+    };
+
+    openair::CurlConnectorOptions on_loop(openair::EventLoop& loop) {
+        openair::CurlConnectorOptions options;
+        options.event_loop = &loop;
+        return options;
+    }
+}
+
+TEST_GROUP(EventLoop) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE An EpollLoop and a client scheduling its timer
+ * WHEN run the loop, then cancel a new timer
+ * THEN the timer fires once and the cancelled one leaves the loop
+ *      empty.
+ */
+TEST(EventLoop, Test_01) {
+    openair::EpollLoop loop;
+    TimerClient client;
+    CHECK(loop.empty());
+    auto start = std::chrono::steady_clock::now();
+    loop.schedule(client, 20);
+    loop.run_until([&client]() { return client.timeouts > 0; });
+    CHECK(std::chrono::steady_clock::now() - start >=
+          std::chrono::milliseconds(20));
+    LONGS_EQUAL(1, client.timeouts);
+    CHECK(loop.empty());
+    loop.schedule(client, 20);
+    loop.schedule(client, -1);
+    CHECK(loop.empty());
+}
+
+/**
+ * HAVE A connector driven by an EpollLoop
+ * WHEN perform many async GET calls and run the loop
+ * THEN every call completes on the loop thread.
+ */
+TEST(EventLoop, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::EpollLoop loop;
+    openair::CurlServiceConnector connector(server.address(),
+                                            on_loop(loop));
+    const std::thread::id loop_thread = std::this_thread::get_id();
+    int completed = 0;
+    int succeeded = 0;
+    for (int i = 0; i < 20; ++i) {
+        connector.get_call_async(
+            "get/data", "id=" + std::to_string(i),
+            [&](openair::HttpResponse&& response, const char *error) {
+                ++completed;
+                if (!error && response.http_code == 200 &&
+                    std::this_thread::get_id() == loop_thread) {
+                    ++succeeded;
+                }
+            });
+    }
+    loop.run_until([&completed]() { return completed == 20; });
+    LONGS_EQUAL(20, succeeded);
+    LONGS_EQUAL(20, server.requests());
+}
+
+/**
+ * HAVE A connector driven by an EpollLoop and a slow service
+ * WHEN perform ten async POST calls from the loop thread
+ * THEN they are in flight together: all complete in about one
+ *      service delay.
+ */
+TEST(EventLoop, Test_03) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 200;
+        });
+    openair::EpollLoop loop;
+    openair::CurlServiceConnector connector(server.address(),
+                                            on_loop(loop));
+    int completed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; ++i) {
+        connector.post_call_async(
+            "send/data", "{\"value\":1}",
+            [&completed](openair::HttpResponse&& response,
+                         const char *error) {
+                if (!error && response.http_code == 200) {
+                    ++completed;
+                }
+            });
+    }
+    loop.run_until([&completed]() { return completed == 10; });
+    LONGS_EQUAL(10, completed);
+    CHECK(std::chrono::steady_clock::now() - start <
+          std::chrono::milliseconds(1000));
+    LONGS_EQUAL(10, server.max_in_flight());
+}
+
+/**
+ * HAVE A connector driven by an EpollLoop with a call in flight
+ * WHEN the connector is destroyed
+ * THEN the call completes with an error and the loop is left empty.
+ */
+TEST(EventLoop, Test_04) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 500;
+        });
+    openair::EpollLoop loop;
+    const char *failure = NULL;
+    {
+        openair::CurlServiceConnector connector(server.address(),
+                                                on_loop(loop));
+        connector.get_call_async(
+            "get/data", "",
+            [&failure](openair::HttpResponse&&, const char *error) {
+                failure = error;
+            });
+        // Until the request is sent.
+        for (int i = 0; i < 10; ++i) {
+            loop.run_once(10);
+        }
+        CHECK(!loop.empty());
+    }
+    CHECK(failure != NULL);
+    CHECK(loop.empty());
+}
+
+/**
+ * HAVE Two clients due at once, each destroying the other on its
+ *      timeout after cancelling its timer
+ * WHEN run the loop
+ * THEN only the first timeout fires and the loop is left empty.
+ */
+TEST(EventLoop, Test_05) {
+    openair::EpollLoop loop;
+    std::unique_ptr<PeerClient> first(new PeerClient(loop));
+    std::unique_ptr<PeerClient> second(new PeerClient(loop));
+    first->peer = &second;
+    second->peer = &first;
+    loop.schedule(*first, 0);
+    loop.schedule(*second, 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    LONGS_EQUAL(1, loop.run_once(0));
+    PeerClient *survivor = first ? first.get() : second.get();
+    CHECK(!first || !second);
+    LONGS_EQUAL(1, survivor->timeouts);
+    CHECK(loop.empty());
+}
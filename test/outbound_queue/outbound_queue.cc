@@ -0,0 +1,249 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      outbound_queue/outbound_queue.cc
+ * \brief     Test the durable store-and-forward queue.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the OutboundQueue persistence and
+ * in order replay.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/outbound_queue.hh"
+#include "../../src/sqlite_support.hh"
+#include "../stub/http_stub_server.hh"
+#include "../support/test_support.hh"
+
+TEST_GROUP(OutboundQueue) {
+    std::string path;
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        path = openair_test::temporary_database();
+    }
+    void teardown() {
+        openair_test::remove_database(path);
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A queue to a reachable service
+ * WHEN 100 calls are enqueued
+ * THEN they are all sent in the enqueue order.
+ */
+TEST(OutboundQueue, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundQueue queue(path, connector);
+    for (int i = 0; i < 100; ++i) {
+        queue.enqueue("send/data", std::to_string(i));
+    }
+    CHECK(openair_test::wait_for([&]() { return queue.size() == 0; }));
+    auto requests = server.received();
+    LONGS_EQUAL(100, requests.size());
+    for (int i = 0; i < 100; ++i) {
+        CHECK_EQUAL(std::to_string(i), requests[i].body);
+    }
+    UNSIGNED_LONGS_EQUAL(100, queue.sent());
+}
+
+/**
+ * HAVE A queue to an unreachable service
+ * WHEN calls are enqueued and the queue is destroyed
+ * THEN a new queue on the same database sends them to the service.
+ */
+TEST(OutboundQueue, Test_02) {
+    std::string address;
+    {
+        openair_test::HttpStubServer server;
+        address = server.address();
+    }
+    {
+        openair::CurlServiceConnector connector(address);
+        openair::OutboundQueue queue(path, connector);
+        for (int i = 0; i < 10; ++i) {
+            queue.enqueue("send/data", std::to_string(i));
+        }
+        queue.sync();
+        UNSIGNED_LONGS_EQUAL(10, queue.size());
+    }
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundQueue queue(path, connector);
+    UNSIGNED_LONGS_EQUAL(10, queue.size());
+    CHECK(openair_test::wait_for([&]() { return queue.size() == 0; }));
+    auto requests = server.received();
+    LONGS_EQUAL(10, requests.size());
+    CHECK_EQUAL(std::string("0"), requests.front().body);
+    CHECK_EQUAL(std::string("9"), requests.back().body);
+}
+
+/**
+ * HAVE A service unavailable for its first three requests
+ * WHEN calls are enqueued
+ * THEN the queue retries and delivers every call in order.
+ */
+TEST(OutboundQueue, Test_03) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&](const openair_test::StubRequest&,
+            openair_test::StubResponse& response) {
+            if (++calls <= 3) {
+                response.status = 503;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundQueueOptions options;
+    options.retry_interval_ms = 20;
+    openair::OutboundQueue queue(path, connector, options);
+    for (int i = 0; i < 5; ++i) {
+        queue.enqueue("send/data", std::to_string(i));
+    }
+    CHECK(openair_test::wait_for([&]() { return queue.size() == 0; }));
+    auto requests = server.received();
+    LONGS_EQUAL(8, requests.size());
+    for (int i = 0; i < 5; ++i) {
+        CHECK_EQUAL(std::to_string(i), requests[3 + i].body);
+    }
+}
+
+/**
+ * HAVE A service refusing a call with 400
+ * WHEN the call is enqueued
+ * THEN it is dropped and the next calls are sent.
+ */
+TEST(OutboundQueue, Test_04) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest& request,
+           openair_test::StubResponse& response) {
+            if (request.body == "bad") {
+                response.status = 400;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundQueue queue(path, connector);
+    queue.enqueue("send/data", "bad");
+    queue.enqueue("send/data", "good");
+    CHECK(openair_test::wait_for([&]() { return queue.size() == 0; }));
+    UNSIGNED_LONGS_EQUAL(1, queue.dropped());
+    UNSIGNED_LONGS_EQUAL(1, queue.sent());
+}
+
+/**
+ * HAVE A queue to an unreachable service
+ * WHEN 2000 calls are enqueued, synced and the queue is closed
+ * THEN the calls are in the database when sync returns, no call is
+ *      lost and further enqueue calls throw.
+ */
+TEST(OutboundQueue, Test_05) {
+    std::string address;
+    {
+        openair_test::HttpStubServer server;
+        address = server.address();
+    }
+    openair::CurlServiceConnector connector(address);
+    openair::OutboundQueue queue(path, connector);
+    for (int i = 0; i < 2000; ++i) {
+        queue.enqueue("send/data", std::to_string(i));
+    }
+    queue.sync();
+    {
+        openair::SqliteDatabase db(path);
+        openair::SqliteStatement count(
+            db, "SELECT COUNT(*) FROM outbound_queue");
+        CHECK(count.step());
+        LONGS_EQUAL(2000, count.column_int64(0));
+    }
+    UNSIGNED_LONGS_EQUAL(0, queue.close());
+    bool thrown = false;
+    try {
+        queue.enqueue("send/data", "late");
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ * HAVE A service answering 429 to its first two requests
+ * WHEN calls are enqueued
+ * THEN the calls are kept, retried and all delivered in order.
+ */
+TEST(OutboundQueue, Test_06) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&](const openair_test::StubRequest&,
+            openair_test::StubResponse& response) {
+            if (++calls <= 2) {
+                response.status = 429;
+            }
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundQueueOptions options;
+    options.retry_interval_ms = 20;
+    openair::OutboundQueue queue(path, connector, options);
+    for (int i = 0; i < 3; ++i) {
+        queue.enqueue("send/data", std::to_string(i));
+    }
+    CHECK(openair_test::wait_for([&]() { return queue.size() == 0; }));
+    auto requests = server.received();
+    LONGS_EQUAL(5, requests.size());
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQUAL(std::to_string(i), requests[2 + i].body);
+    }
+    UNSIGNED_LONGS_EQUAL(3, queue.sent());
+    UNSIGNED_LONGS_EQUAL(0, queue.dropped());
+}
+
+/**
+ * HAVE A service redirecting its first request with 302
+ * WHEN a call is enqueued
+ * THEN the call is not counted as sent until a 2xx accepts it.
+ */
+TEST(OutboundQueue, Test_07) {
+    std::atomic<int> calls(0);
+    openair_test::HttpStubServer server(
+        [&](const openair_test::StubRequest&,
+            openair_test::StubResponse& response) {
+            if (++calls == 1) {
+                response.status = 302;
+                response.headers.push_back(
+                    std::make_pair("Location", "/moved"));
+            }
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundQueueOptions options;
+    options.retry_interval_ms = 20;
+    openair::OutboundQueue queue(path, connector, options);
+    queue.enqueue("send/data", "0");
+    CHECK(openair_test::wait_for([&]() { return queue.size() == 0; }));
+    LONGS_EQUAL(2, server.requests());
+    UNSIGNED_LONGS_EQUAL(1, queue.sent());
+    UNSIGNED_LONGS_EQUAL(0, queue.dropped());
+}
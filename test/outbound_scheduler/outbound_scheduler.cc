@@ -0,0 +1,263 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      outbound_scheduler/outbound_scheduler.cc
+ * \brief     Test the prioritized, rate limited scheduler.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the OutboundScheduler.
+ */
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/event_loop.hh"
+#include "../../src/libopenair/outbound_scheduler.hh"
+#include "../stub/http_stub_server.hh"
+#include "../support/test_support.hh"
+
+TEST_GROUP(OutboundScheduler) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A scheduler with the default options
+ * WHEN calls are queued in every lane
+ * THEN every call completes with the response of the service.
+ */
+TEST(OutboundScheduler, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundScheduler scheduler(connector);
+    auto high = scheduler.post_call(openair::HIGH_PRIORITY,
+                                    "send/errors", "{\"e\":1}");
+    auto normal = scheduler.post_call(openair::NORMAL_PRIORITY,
+                                      "send/data", "{\"n\":1}");
+    auto low = scheduler.post_call(openair::LOW_PRIORITY,
+                                   "send/data", "{\"l\":1}");
+    LONGS_EQUAL(200, high.get().http_code);
+    LONGS_EQUAL(200, normal.get().http_code);
+    LONGS_EQUAL(200, low.get().http_code);
+    LONGS_EQUAL(3, server.requests());
+}
+
+/**
+ * HAVE A scheduler with one call in flight and a slow service
+ * WHEN many low priority calls are queued and then an error report
+ * THEN the error report is sent before the queued low priority calls.
+ */
+TEST(OutboundScheduler, Test_02) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.delay_ms = 20;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundSchedulerOptions options;
+    options.max_in_flight = 1;
+    openair::OutboundScheduler scheduler(connector, options);
+    std::vector<std::future<openair::HttpResponse> > calls;
+    for (int i = 0; i < 5; ++i) {
+        calls.push_back(scheduler.post_call(openair::LOW_PRIORITY,
+                                            "send/data", "{}"));
+    }
+    auto error = scheduler.post_call(openair::HIGH_PRIORITY,
+                                     "send/errors", "{}");
+    LONGS_EQUAL(200, error.get().http_code);
+    for (auto& call : calls) {
+        call.get();
+    }
+    auto received = server.received();
+    LONGS_EQUAL(6, received.size());
+    // Only the call already in flight, if any, goes before it.
+    CHECK(received[0].target == "/send/errors" ||
+          received[1].target == "/send/errors");
+}
+
+/**
+ * HAVE A scheduler limited to 20 requests per second, burst of one
+ * WHEN 6 calls are queued
+ * THEN sending them takes at least 250 ms.
+ */
+TEST(OutboundScheduler, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundSchedulerOptions options;
+    options.max_requests_per_second = 20;
+    options.burst_requests = 1;
+    openair::OutboundScheduler scheduler(connector, options);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<openair::HttpResponse> > calls;
+    for (int i = 0; i < 6; ++i) {
+        calls.push_back(scheduler.post_call(openair::NORMAL_PRIORITY,
+                                            "send/data", "{}"));
+    }
+    for (auto& call : calls) {
+        LONGS_EQUAL(200, call.get().http_code);
+    }
+    CHECK(openair_test::elapsed_ms(start) >= 240);
+}
+
+/**
+ * HAVE A scheduler limited to 2000 bytes per second, burst of 500
+ * WHEN 3 calls of 500 bytes are queued
+ * THEN sending them takes at least 500 ms.
+ */
+TEST(OutboundScheduler, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundSchedulerOptions options;
+    options.max_bytes_per_second = 2000;
+    options.burst_bytes = 500;
+    openair::OutboundScheduler scheduler(connector, options);
+    const std::string body(500, ' ');
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<openair::HttpResponse> > calls;
+    for (int i = 0; i < 3; ++i) {
+        calls.push_back(scheduler.post_call(openair::LOW_PRIORITY,
+                                            "send/data", body));
+    }
+    for (auto& call : calls) {
+        LONGS_EQUAL(200, call.get().http_code);
+    }
+    CHECK(openair_test::elapsed_ms(start) >= 490);
+}
+
+/**
+ * HAVE A scheduler limited to 10 requests per second, burst of one
+ * WHEN 3 calls are queued in the low lane
+ * THEN the lane metrics report the depth, the dispatched calls and
+ *      the time waited.
+ */
+TEST(OutboundScheduler, Test_05) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::OutboundSchedulerOptions options;
+    options.max_requests_per_second = 10;
+    options.burst_requests = 1;
+    openair::OutboundScheduler scheduler(connector, options);
+    std::vector<std::future<openair::HttpResponse> > calls;
+    for (int i = 0; i < 3; ++i) {
+        calls.push_back(scheduler.post_call(openair::LOW_PRIORITY,
+                                            "send/data", "{}"));
+    }
+    CHECK(scheduler.metrics(openair::LOW_PRIORITY).depth >= 1);
+    for (auto& call : calls) {
+        call.get();
+    }
+    auto low = scheduler.metrics(openair::LOW_PRIORITY);
+    UNSIGNED_LONGS_EQUAL(0, low.depth);
+    UNSIGNED_LONGS_EQUAL(3, low.dispatched);
+    CHECK(low.max_wait_ms >= 190);
+    CHECK(low.mean_wait_ms > 0);
+    UNSIGNED_LONGS_EQUAL(0,
+        scheduler.metrics(openair::HIGH_PRIORITY).dispatched);
+}
+
+/**
+ * HAVE A scheduler limited to one request per second, burst of one
+ * WHEN it is destroyed with calls still queued
+ * THEN the queued calls fail without being sent.
+ */
+TEST(OutboundScheduler, Test_06) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::future<openair::HttpResponse> first;
+    std::future<openair::HttpResponse> queued;
+    {
+        openair::OutboundSchedulerOptions options;
+        options.max_requests_per_second = 1;
+        options.burst_requests = 1;
+        openair::OutboundScheduler scheduler(connector, options);
+        first = scheduler.post_call(openair::LOW_PRIORITY,
+                                    "send/data", "{}");
+        queued = scheduler.post_call(openair::LOW_PRIORITY,
+                                     "send/data", "{}");
+        LONGS_EQUAL(200, first.get().http_code);
+    }
+    bool failed = false;
+    try {
+        queued.get();
+    } catch (const char *) {
+        failed = true;
+    }
+    CHECK_TRUE(failed);
+    LONGS_EQUAL(1, server.requests());
+}
+
+/**
+ * HAVE A connector driven by an event loop
+ * WHEN a scheduler is created on it
+ * THEN a const char* is thrown.
+ */
+TEST(OutboundScheduler, Test_07) {
+    openair_test::HttpStubServer server;
+    openair::EpollLoop loop;
+    openair::CurlConnectorOptions connector_options;
+    connector_options.event_loop = &loop;
+    openair::CurlServiceConnector connector(server.address(),
+                                            connector_options);
+    bool thrown = false;
+    try {
+        openair::OutboundScheduler scheduler(connector);
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK_TRUE(thrown);
+}
+
+/**
+ * HAVE A scheduler limited to one request per second, burst of one
+ * WHEN it is destroyed with a call still queued
+ * THEN the completion of the queued call runs on the destroying
+ *      thread, with an error.
+ */
+TEST(OutboundScheduler, Test_08) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    std::thread::id completed_on;
+    const char *queued_error = NULL;
+    {
+        openair::OutboundSchedulerOptions options;
+        options.max_requests_per_second = 1;
+        options.burst_requests = 1;
+        openair::OutboundScheduler scheduler(connector, options);
+        auto first = scheduler.post_call(openair::LOW_PRIORITY,
+                                         "send/data", "{}");
+        scheduler.post_call(
+            openair::LOW_PRIORITY, "send/data", "{}",
+            [&](openair::HttpResponse&&, const char *error) {
+                completed_on = std::this_thread::get_id();
+                queued_error = error;
+            });
+        LONGS_EQUAL(200, first.get().http_code);
+    }
+    CHECK(completed_on == std::this_thread::get_id());
+    CHECK(queued_error != NULL);
+}
@@ -0,0 +1,89 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      outbound_scheduler/token_bucket.cc
+ * \brief     Test the token bucket rate limiter.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the TokenBucket used by the
+ * OutboundScheduler.
+ */
+
+#include <chrono>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/token_bucket.hh"
+
+namespace {
+    typedef openair::TokenBucket::clock clock;
+
+    double wait_ms(openair::TokenBucket& bucket, double cost,
+                   clock::time_point now) {
+        return std::chrono::duration<double, std::milli>(
+            bucket.wait_time(cost, now)).count();
+    }
+}
+
+TEST_GROUP(TokenBucket) {
+    void setup() { }
+    void teardown() {
+        mock().clear();
+    }
+};
+
+/**
+ * HAVE A bucket without rate
+ * WHEN any cost is consumed
+ * THEN nothing ever waits.
+ */
+TEST(TokenBucket, Test_01) {
+    openair::TokenBucket bucket(0, 1);
+    auto now = clock::now();
+    for (int i = 0; i < 100; ++i) {
+        bucket.consume(1000, now);
+    }
+    DOUBLES_EQUAL(0, wait_ms(bucket, 1000, now), 0.001);
+}
+
+/**
+ * HAVE A full bucket of 10 tokens refilled with 10 tokens/s
+ * WHEN the burst is consumed
+ * THEN the next token waits 100 ms, and is available 100 ms later.
+ */
+TEST(TokenBucket, Test_02) {
+    openair::TokenBucket bucket(10, 10);
+    auto now = clock::now();
+    DOUBLES_EQUAL(0, wait_ms(bucket, 10, now), 0.001);
+    bucket.consume(10, now);
+    DOUBLES_EQUAL(100, wait_ms(bucket, 1, now), 0.5);
+    now += std::chrono::milliseconds(100);
+    DOUBLES_EQUAL(0, wait_ms(bucket, 1, now), 0.5);
+}
+
+/**
+ * HAVE A full bucket of 100 tokens refilled with 100 tokens/s
+ * WHEN a cost of 300 tokens is consumed
+ * THEN it is admitted and the bucket stays in debt for 3 seconds.
+ */
+TEST(TokenBucket, Test_03) {
+    openair::TokenBucket bucket(100, 100);
+    auto now = clock::now();
+    DOUBLES_EQUAL(0, wait_ms(bucket, 300, now), 0.001);
+    bucket.consume(300, now);
+    DOUBLES_EQUAL(3000, wait_ms(bucket, 100, now), 0.5);
+}
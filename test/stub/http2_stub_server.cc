@@ -0,0 +1,390 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      stub/http2_stub_server.cc
+ * \brief     Loopback h2 server used by the HTTP/2 connector tests.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ */
+
+#include "http2_stub_server.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+namespace __HTTP2_STUB_SERVER_INTERNAL__ {
+    typedef std::chrono::steady_clock clock;
+
+    const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    const std::size_t PREFACE_SIZE = sizeof(PREFACE) - 1;
+    const std::size_t FRAME_HEADER_SIZE = 9;
+
+    const unsigned char DATA = 0x0;
+    const unsigned char HEADERS = 0x1;
+    const unsigned char RST_STREAM = 0x3;
+    const unsigned char SETTINGS = 0x4;
+    const unsigned char PING = 0x6;
+    const unsigned char GOAWAY = 0x7;
+    const unsigned char WINDOW_UPDATE = 0x8;
+
+    const unsigned char END_STREAM = 0x1;
+    const unsigned char ACK = 0x1;
+    const unsigned char END_HEADERS = 0x4;
+
+    std::string frame(unsigned char type, unsigned char flags,
+                      unsigned long stream, const std::string& payload) {
+        std::string out;
+        out += static_cast<char>((payload.size() >> 16) & 0xff);
+        out += static_cast<char>((payload.size() >> 8) & 0xff);
+        out += static_cast<char>(payload.size() & 0xff);
+        out += static_cast<char>(type);
+        out += static_cast<char>(flags);
+        out += static_cast<char>((stream >> 24) & 0x7f);
+        out += static_cast<char>((stream >> 16) & 0xff);
+        out += static_cast<char>((stream >> 8) & 0xff);
+        out += static_cast<char>(stream & 0xff);
+        return out + payload;
+    }
+
+    std::string window_update(unsigned long stream, std::size_t size) {
+        std::string increment;
+        increment += static_cast<char>((size >> 24) & 0x7f);
+        increment += static_cast<char>((size >> 16) & 0xff);
+        increment += static_cast<char>((size >> 8) & 0xff);
+        increment += static_cast<char>(size & 0xff);
+        return frame(WINDOW_UPDATE, 0, stream, increment);
+    }
+
+    /*
+     * Answer of every request: ":status 200" from the static table
+     * of HPACK, then the body ending the stream.
+     */
+    std::string response(unsigned long stream) {
+        return frame(HEADERS, END_HEADERS, stream, "\x88") +
+            frame(DATA, END_STREAM, stream, "{}");
+    }
+
+    bool send_all(SSL *tls, const std::string& data) {
+        return data.empty() || SSL_write(tls, data.data(),
+                                         static_cast<int>(data.size())) ==
+            static_cast<int>(data.size());
+    }
+
+    int select_h2(SSL *, const unsigned char **out, unsigned char *size,
+                  const unsigned char *offered, unsigned int length,
+                  void *) {
+        static const unsigned char h2[] = "\x02h2";
+        unsigned char *selected = NULL;
+        if (SSL_select_next_proto(&selected, size, h2, sizeof(h2) - 1,
+                                  offered, length) !=
+            OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_ALERT_FATAL;
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+
+    bool add_extension(X509 *cert, int nid, const char *value) {
+        X509V3_CTX context;
+        X509V3_set_ctx_nodb(&context);
+        X509V3_set_ctx(&context, cert, cert, NULL, NULL, 0);
+        X509_EXTENSION *extension =
+            X509V3_EXT_conf_nid(NULL, &context, nid, value);
+        if (!extension) {
+            return false;
+        }
+        bool added = X509_add_ext(cert, extension, -1) == 1;
+        X509_EXTENSION_free(extension);
+        return added;
+    }
+
+    /*
+     * Creates the TLS context of the server, with a key and a
+     * self-signed certificate for 127.0.0.1 valid for one day. The
+     * certificate is written in a temporary file, whose path is
+     * stored in ca_file.
+     */
+    SSL_CTX *create_tls(std::string& ca_file) {
+        EVP_PKEY *key = EVP_EC_gen("P-256");
+        X509 *cert = X509_new();
+        SSL_CTX *tls = NULL;
+        char path[] = "/tmp/openair_h2_stub_XXXXXX";
+        int fd = -1;
+        if (key && cert && X509_set_version(cert, 2) &&
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), 1) &&
+            X509_gmtime_adj(X509_getm_notBefore(cert), -60) &&
+            X509_gmtime_adj(X509_getm_notAfter(cert), 86400) &&
+            X509_set_pubkey(cert, key) &&
+            X509_NAME_add_entry_by_txt(
+                X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+                reinterpret_cast<const unsigned char*>("127.0.0.1"),
+                -1, -1, 0) &&
+            X509_set_issuer_name(cert, X509_get_subject_name(cert)) &&
+            add_extension(cert, NID_basic_constraints, "CA:TRUE") &&
+            add_extension(cert, NID_subject_alt_name, "IP:127.0.0.1") &&
+            X509_sign(cert, key, EVP_sha256()) &&
+            (fd = mkstemp(path)) >= 0) {
+            FILE *file = fdopen(fd, "w");
+            bool written = file && PEM_write_X509(file, cert);
+            if (file) {
+                std::fclose(file);
+            } else {
+                close(fd);
+            }
+            tls = written ? SSL_CTX_new(TLS_server_method()) : NULL;
+            if (tls && (SSL_CTX_use_certificate(tls, cert) != 1 ||
+                        SSL_CTX_use_PrivateKey(tls, key) != 1)) {
+                SSL_CTX_free(tls);
+                tls = NULL;
+            }
+            if (tls) {
+                SSL_CTX_set_alpn_select_cb(tls, select_h2, NULL);
+                ca_file = path;
+            } else {
+                std::remove(path);
+            }
+        }
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return tls;
+    }
+}
+
+openair_test::Http2StubServer::Http2StubServer(long delay_ms)
+    : _delay_ms(delay_ms), _tls(NULL), _ca_file(), _listen_fd(-1),
+      _port(0), _running(false), _connections(0), _requests(0),
+      _max_streams(0) {
+    _tls = __HTTP2_STUB_SERVER_INTERNAL__::create_tls(_ca_file);
+    if (!_tls) {
+        throw "Unable to create the http2 stub server certificate";
+    }
+    _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr),
+             sizeof(addr)) != 0 ||
+        listen(_listen_fd, 512) != 0) {
+        close(_listen_fd);
+        SSL_CTX_free(_tls);
+        std::remove(_ca_file.c_str());
+        throw "Unable to start the http2 stub server";
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(_listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    _port = ntohs(addr.sin_port);
+    _running = true;
+    _acceptor = std::thread(&Http2StubServer::_accept_loop, this);
+}
+
+openair_test::Http2StubServer::~Http2StubServer() {
+    stop();
+    SSL_CTX_free(_tls);
+    std::remove(_ca_file.c_str());
+}
+
+std::string openair_test::Http2StubServer::address() const {
+    return "https://127.0.0.1:" + std::to_string(_port);
+}
+
+std::string openair_test::Http2StubServer::ca_file() const {
+    return _ca_file;
+}
+
+long openair_test::Http2StubServer::connections() const {
+    return _connections.load();
+}
+
+long openair_test::Http2StubServer::requests() const {
+    return _requests.load();
+}
+
+long openair_test::Http2StubServer::max_streams() const {
+    return _max_streams.load();
+}
+
+void openair_test::Http2StubServer::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    shutdown(_listen_fd, SHUT_RDWR);
+    close(_listen_fd);
+    if (_acceptor.joinable()) {
+        _acceptor.join();
+    }
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (int fd : _client_fds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        workers.swap(_workers);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void openair_test::Http2StubServer::_accept_loop() {
+    while (_running) {
+        int fd = accept(_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (!_running) {
+                break;
+            }
+            continue;
+        }
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        ++_connections;
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_running) {
+            close(fd);
+            break;
+        }
+        _client_fds.push_back(fd);
+        _workers.push_back(std::thread(&Http2StubServer::_serve, this, fd));
+    }
+}
+
+void openair_test::Http2StubServer::_serve(int fd) {
+    using namespace __HTTP2_STUB_SERVER_INTERNAL__;
+    SSL *tls = SSL_new(_tls);
+    SSL_set_fd(tls, fd);
+    std::string buffer;
+    bool preface = false;
+    bool open = SSL_accept(tls) == 1 &&
+        send_all(tls, frame(SETTINGS, 0, 0, std::string()));
+    // Streams opened by the client, with the time to answer them:
+    // the end of time until their request is complete.
+    std::map<unsigned long, clock::time_point> streams;
+    while (open) {
+        std::string out;
+        clock::time_point now = clock::now();
+        int timeout = -1;
+        for (auto it = streams.begin(); it != streams.end(); ) {
+            if (it->second <= now) {
+                out += response(it->first);
+                it = streams.erase(it);
+                ++_requests;
+                continue;
+            }
+            if (it->second != clock::time_point::max()) {
+                long left = std::chrono::duration_cast<
+                    std::chrono::milliseconds>(it->second - now).count();
+                if (timeout < 0 || left + 1 < timeout) {
+                    timeout = static_cast<int>(left + 1);
+                }
+            }
+            ++it;
+        }
+        if (!send_all(tls, out)) {
+            break;
+        }
+        if (SSL_pending(tls) == 0) {
+            pollfd polled = { fd, POLLIN, 0 };
+            if (poll(&polled, 1, timeout) < 0) {
+                break;
+            }
+            if (!(polled.revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+        }
+        char chunk[16384];
+        int got = SSL_read(tls, chunk, sizeof(chunk));
+        if (got <= 0) {
+            break;
+        }
+        buffer.append(chunk, got);
+        if (!preface) {
+            if (buffer.size() < PREFACE_SIZE) {
+                continue;
+            }
+            if (buffer.compare(0, PREFACE_SIZE, PREFACE) != 0) {
+                break;
+            }
+            buffer.erase(0, PREFACE_SIZE);
+            preface = true;
+        }
+        out.clear();
+        while (buffer.size() >= FRAME_HEADER_SIZE) {
+            const unsigned char *head =
+                reinterpret_cast<const unsigned char*>(buffer.data());
+            std::size_t size = (head[0] << 16) | (head[1] << 8) | head[2];
+            if (buffer.size() < FRAME_HEADER_SIZE + size) {
+                break;
+            }
+            unsigned char type = head[3];
+            unsigned char flags = head[4];
+            unsigned long stream = ((head[5] & 0x7fUL) << 24) |
+                (head[6] << 16) | (head[7] << 8) | head[8];
+            std::string payload = buffer.substr(FRAME_HEADER_SIZE, size);
+            buffer.erase(0, FRAME_HEADER_SIZE + size);
+            if (type == HEADERS) {
+                streams[stream] = clock::time_point::max();
+                long open_streams = static_cast<long>(streams.size());
+                long seen = _max_streams.load();
+                while (open_streams > seen &&
+                       !_max_streams.compare_exchange_weak(
+                           seen, open_streams)) { }
+            } else if (type == DATA && size > 0) {
+                out += window_update(0, size);
+                if (!(flags & END_STREAM)) {
+                    out += window_update(stream, size);
+                }
+            } else if (type == SETTINGS && !(flags & ACK)) {
+                out += frame(SETTINGS, ACK, 0, std::string());
+            } else if (type == PING && !(flags & ACK)) {
+                out += frame(PING, ACK, 0, payload);
+            } else if (type == RST_STREAM) {
+                streams.erase(stream);
+            } else if (type == GOAWAY) {
+                open = false;
+            }
+            if ((type == HEADERS || type == DATA) &&
+                (flags & END_STREAM) && streams.count(stream)) {
+                streams[stream] = clock::now() +
+                    std::chrono::milliseconds(_delay_ms);
+            }
+        }
+        if (!send_all(tls, out)) {
+            break;
+        }
+    }
+    SSL_free(tls);
+    shutdown(fd, SHUT_RDWR);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _client_fds.erase(
+        std::remove(_client_fds.begin(), _client_fds.end(), fd),
+        _client_fds.end());
+    close(fd);
+}
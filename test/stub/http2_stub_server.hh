@@ -0,0 +1,112 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      stub/http2_stub_server.hh
+ * \brief     Loopback h2 server used by the HTTP/2 connector tests.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains a minimal HTTP/2 server speaking h2 over TLS,
+ * negotiated with ALPN, with a self-signed certificate generated at
+ * start. It decodes only the framing: every request, whatever its
+ * headers, is answered with "200" and an empty JSON object. It counts
+ * the streams open at once on a connection, so tests can check that
+ * concurrent calls are multiplexed.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef HTTP2_STUB_SERVER_INCLUDE_GUARD_HH
+#define HTTP2_STUB_SERVER_INCLUDE_GUARD_HH 1
+
+struct ssl_ctx_st;
+
+namespace openair_test {
+
+   /*!
+    * \brief Minimal loopback h2 server.
+    *
+    * Each accepted connection is served by its own thread, that
+    * answers the streams of the connection in any order once their
+    * delay is elapsed.
+    */
+    class Http2StubServer {
+    public:
+        /*!
+         * \brief Constructor with one parameter.
+         * \param delay_ms - Milliseconds to wait before answering
+         *                   each request.
+         *
+         * Writes the certificate of the server in a temporary file
+         * and starts listening on an ephemeral loopback port.
+         */
+        explicit Http2StubServer(long delay_ms = 0);
+
+        /*! Stops the server and joins all its threads. */
+        ~Http2StubServer();
+
+        /*!
+         * \brief Gets the address of the server.
+         * \return The address in the form https://127.0.0.1:port
+         */
+        std::string address() const;
+
+        /*!
+         * \brief Gets the certificate to trust to call the server.
+         * \return The path of the certificate, in PEM format.
+         */
+        std::string ca_file() const;
+
+        /*! \return Number of accepted TCP connections. */
+        long connections() const;
+
+        /*! \return Number of served requests. */
+        long requests() const;
+
+        /*! \return Maximum number of streams open at once on a
+         *          single connection. */
+        long max_streams() const;
+
+        /*! Stops accepting and closes every open connection. */
+        void stop();
+
+    private:
+        void _accept_loop();
+        void _serve(int fd);
+
+        Http2StubServer(const Http2StubServer&);
+
+        long _delay_ms;
+        ssl_ctx_st *_tls;
+        std::string _ca_file;
+        int _listen_fd;
+        int _port;
+        std::atomic<bool> _running;
+        std::atomic<long> _connections;
+        std::atomic<long> _requests;
+        std::atomic<long> _max_streams;
+        std::thread _acceptor;
+        std::mutex _mutex;
+        std::vector<std::thread> _workers;
+        std::vector<int> _client_fds;
+    };
+}
+#endif
@@ -0,0 +1,338 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      stub/http_stub_server.cc
+ * \brief     Loopback HTTP/1.1 server used by the connector tests.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ */
+
+#include "http_stub_server.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace __HTTP_STUB_SERVER_INTERNAL__ {
+    std::string lower(std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        return value;
+    }
+
+    std::string trim(const std::string& value) {
+        std::string::size_type begin = value.find_first_not_of(" \t");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        std::string::size_type end = value.find_last_not_of(" \t\r");
+        return value.substr(begin, end - begin + 1);
+    }
+
+    /*
+     * Buffered reader over a socket: it keeps the bytes received
+     * after the current request so pipelined and keep-alive requests
+     * are parsed correctly.
+     */
+    class socket_reader {
+    public:
+        explicit socket_reader(int fd) : _fd(fd) { }
+
+        bool read_line(std::string& line) {
+            std::string::size_type pos;
+            while ((pos = _buffer.find("\r\n")) == std::string::npos) {
+                if (!_fill()) {
+                    return false;
+                }
+            }
+            line = _buffer.substr(0, pos);
+            _buffer.erase(0, pos + 2);
+            return true;
+        }
+
+        bool read_bytes(std::string& out, std::size_t size) {
+            while (_buffer.size() < size) {
+                if (!_fill()) {
+                    return false;
+                }
+            }
+            out.append(_buffer, 0, size);
+            _buffer.erase(0, size);
+            return true;
+        }
+
+    private:
+        bool _fill() {
+            char chunk[16384];
+            ssize_t got = recv(_fd, chunk, sizeof(chunk), 0);
+            if (got <= 0) {
+                return false;
+            }
+            _buffer.append(chunk, got);
+            return true;
+        }
+
+        int _fd;
+        std::string _buffer;
+    };
+
+    bool read_request(socket_reader& reader,
+                      openair_test::StubRequest& request) {
+        std::string line;
+        if (!reader.read_line(line)) {
+            return false;
+        }
+        std::istringstream start(line);
+        std::string version;
+        start >> request.verb >> request.target >> version;
+        while (reader.read_line(line) && !line.empty()) {
+            std::string::size_type colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            request.headers[lower(trim(line.substr(0, colon)))] =
+                trim(line.substr(colon + 1));
+        }
+        if (lower(request.header("transfer-encoding")) == "chunked") {
+            for (;;) {
+                if (!reader.read_line(line)) {
+                    return false;
+                }
+                std::size_t size = std::strtoul(line.c_str(), NULL, 16);
+                if (size == 0) {
+                    // Trailer section, terminated by an empty line.
+                    while (reader.read_line(line) && !line.empty()) { }
+                    break;
+                }
+                if (!reader.read_bytes(request.body, size) ||
+                    !reader.read_line(line)) {
+                    return false;
+                }
+            }
+        } else if (!request.header("content-length").empty()) {
+            std::size_t size = std::strtoul(
+                request.header("content-length").c_str(), NULL, 10);
+            if (!reader.read_bytes(request.body, size)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool send_all(int fd, const std::string& data) {
+        std::size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t done = send(fd, data.data() + sent,
+                                data.size() - sent, MSG_NOSIGNAL);
+            if (done <= 0) {
+                return false;
+            }
+            sent += done;
+        }
+        return true;
+    }
+}
+
+std::string openair_test::StubRequest::header(
+    const std::string& name) const {
+    auto it = headers.find(name);
+    return it == headers.end() ? std::string() : it->second;
+}
+
+openair_test::StubResponse::StubResponse()
+    : status(200), body("{}"), delay_ms(0), close(false) { }
+
+openair_test::HttpStubServer::HttpStubServer()
+    : _handler(), _listen_fd(-1), _port(0), _running(false),
+      _recording(true), _connections(0), _requests(0), _in_flight(0),
+      _max_in_flight(0) {
+    _start();
+}
+
+openair_test::HttpStubServer::HttpStubServer(const handler_t& handler)
+    : _handler(handler), _listen_fd(-1), _port(0), _running(false),
+      _recording(true), _connections(0), _requests(0), _in_flight(0),
+      _max_in_flight(0) {
+    _start();
+}
+
+openair_test::HttpStubServer::~HttpStubServer() {
+    stop();
+}
+
+std::string openair_test::HttpStubServer::address() const {
+    return "http://127.0.0.1:" + std::to_string(_port);
+}
+
+int openair_test::HttpStubServer::port() const {
+    return _port;
+}
+
+long openair_test::HttpStubServer::connections() const {
+    return _connections.load();
+}
+
+long openair_test::HttpStubServer::requests() const {
+    return _requests.load();
+}
+
+long openair_test::HttpStubServer::in_flight() const {
+    return _in_flight.load();
+}
+
+long openair_test::HttpStubServer::max_in_flight() const {
+    return _max_in_flight.load();
+}
+
+std::vector<openair_test::StubRequest>
+openair_test::HttpStubServer::received() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _received;
+}
+
+void openair_test::HttpStubServer::record_requests(bool enabled) {
+    _recording = enabled;
+}
+
+void openair_test::HttpStubServer::stop() {
+    if (!_running.exchange(false)) {
+        return;
+    }
+    shutdown(_listen_fd, SHUT_RDWR);
+    close(_listen_fd);
+    if (_acceptor.joinable()) {
+        _acceptor.join();
+    }
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (int fd : _client_fds) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        workers.swap(_workers);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void openair_test::HttpStubServer::_start() {
+    _listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if (bind(_listen_fd, reinterpret_cast<sockaddr*>(&addr),
+             sizeof(addr)) != 0 ||
+        listen(_listen_fd, 512) != 0) {
+        close(_listen_fd);
+        throw "Unable to start the http stub server";
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(_listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    _port = ntohs(addr.sin_port);
+    _running = true;
+    _acceptor = std::thread(&HttpStubServer::_accept_loop, this);
+}
+
+void openair_test::HttpStubServer::_accept_loop() {
+    while (_running) {
+        int fd = accept(_listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (!_running) {
+                break;
+            }
+            continue;
+        }
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        ++_connections;
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_running) {
+            close(fd);
+            break;
+        }
+        _client_fds.push_back(fd);
+        _workers.push_back(std::thread(&HttpStubServer::_serve, this, fd));
+    }
+}
+
+void openair_test::HttpStubServer::_serve(int fd) {
+    using namespace __HTTP_STUB_SERVER_INTERNAL__;
+    socket_reader reader(fd);
+    for (;;) {
+        StubRequest request;
+        if (!read_request(reader, request)) {
+            break;
+        }
+        long now = ++_in_flight;
+        long seen = _max_in_flight.load();
+        while (now > seen &&
+               !_max_in_flight.compare_exchange_weak(seen, now)) { }
+        if (_recording) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _received.push_back(request);
+        }
+        StubResponse response;
+        if (_handler) {
+            _handler(request, response);
+        }
+        if (response.delay_ms > 0) {
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(response.delay_ms));
+        }
+        bool close_after = response.close ||
+            lower(request.header("connection")) == "close";
+        std::ostringstream out;
+        out << "HTTP/1.1 " << response.status << " Stub\r\n"
+            << "Content-Length: " << response.body.size() << "\r\n";
+        if (response.status != 304) {
+            out << "Content-Type: application/json\r\n";
+        }
+        for (const auto& header : response.headers) {
+            out << header.first << ": " << header.second << "\r\n";
+        }
+        if (close_after) {
+            out << "Connection: close\r\n";
+        }
+        out << "\r\n";
+        if (response.status != 304 && request.verb != "HEAD") {
+            out << response.body;
+        }
+        ++_requests;
+        bool sent = send_all(fd, out.str());
+        --_in_flight;
+        if (!sent || close_after) {
+            break;
+        }
+    }
+    shutdown(fd, SHUT_RDWR);
+    std::lock_guard<std::mutex> lock(_mutex);
+    _client_fds.erase(
+        std::remove(_client_fds.begin(), _client_fds.end(), fd),
+        _client_fds.end());
+    close(fd);
+}
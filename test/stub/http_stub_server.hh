@@ -0,0 +1,174 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      stub/http_stub_server.hh
+ * \brief     Loopback HTTP/1.1 server used by the connector tests.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains a minimal HTTP/1.1 server listening on the
+ * loopback interface. It supports keep-alive, Content-Length and
+ * chunked request bodies and counts the accepted connections and the
+ * served requests, so tests can check how the connector uses the
+ * network.
+ */
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef HTTP_STUB_SERVER_INCLUDE_GUARD_HH
+#define HTTP_STUB_SERVER_INCLUDE_GUARD_HH 1
+
+namespace openair_test {
+
+   /*!
+    * \brief Request received by the stub server.
+    */
+    struct StubRequest {
+        /*! Http verb (GET, POST, ...). */
+        std::string verb;
+        /*! Request target: path and query string. */
+        std::string target;
+        /*! Request headers, names are lower case. */
+        std::map<std::string, std::string> headers;
+        /*! Request body, de-chunked if needed. */
+        std::string body;
+
+        /*!
+         * \brief Gets a request header.
+         * \param name - Lower case name of the header.
+         * \return The header value or an empty string.
+         */
+        std::string header(const std::string& name) const;
+    };
+
+   /*!
+    * \brief Response sent by the stub server.
+    */
+    struct StubResponse {
+        /*! Http status code, 200 by default. */
+        long status;
+        /*! Additional headers to send. */
+        std::vector<std::pair<std::string, std::string> > headers;
+        /*! Response body. */
+        std::string body;
+        /*! Milliseconds to wait before answering. */
+        long delay_ms;
+        /*! Close the connection after the response. */
+        bool close;
+
+        /*! Default constructor. */
+        StubResponse();
+    };
+
+   /*!
+    * \brief Minimal loopback HTTP/1.1 server.
+    *
+    * Each accepted connection is served by its own thread. By
+    * default every request is answered with "200 OK" and an empty
+    * JSON object; a handler can be installed to customize the
+    * answer.
+    */
+    class HttpStubServer {
+    public:
+        /*! Typedefinition of the request handler. */
+        typedef std::function<void(const StubRequest&,
+                                   StubResponse&)> handler_t;
+
+        /*!
+         * \brief Default constructor.
+         *
+         * Starts listening on an ephemeral loopback port.
+         */
+        HttpStubServer();
+
+        /*!
+         * \brief Constructor with one parameter.
+         * \param handler - Handler called for each request.
+         */
+        explicit HttpStubServer(const handler_t& handler);
+
+        /*! Stops the server and joins all its threads. */
+        ~HttpStubServer();
+
+        /*!
+         * \brief Gets the address of the server.
+         * \return The address in the form http://127.0.0.1:port
+         */
+        std::string address() const;
+
+        /*! \return The port the server is listening on. */
+        int port() const;
+
+        /*! \return Number of accepted TCP connections. */
+        long connections() const;
+
+        /*! \return Number of served requests. */
+        long requests() const;
+
+        /*! \return Number of requests currently being served. */
+        long in_flight() const;
+
+        /*! \return Maximum number of requests served at once. */
+        long max_in_flight() const;
+
+        /*!
+         * \brief Gets a copy of the requests received so far.
+         * \return Received requests, in arrival order.
+         */
+        std::vector<StubRequest> received() const;
+
+        /*!
+         * \brief Enables or disables the copy of the received
+         *        requests, enabled by default. Long runs disable it
+         *        to keep the memory of the server flat.
+         * \param enabled - True to keep a copy of each request.
+         */
+        void record_requests(bool enabled);
+
+        /*! Stops accepting and closes every open connection. */
+        void stop();
+
+    private:
+        void _start();
+        void _accept_loop();
+        void _serve(int fd);
+
+        HttpStubServer(const HttpStubServer&);
+
+        handler_t _handler;
+        int _listen_fd;
+        int _port;
+        std::atomic<bool> _running;
+        std::atomic<bool> _recording;
+        std::atomic<long> _connections;
+        std::atomic<long> _requests;
+        std::atomic<long> _in_flight;
+        std::atomic<long> _max_in_flight;
+        std::thread _acceptor;
+        mutable std::mutex _mutex;
+        std::vector<std::thread> _workers;
+        std::vector<int> _client_fds;
+        std::vector<StubRequest> _received;
+    };
+}
+#endif
@@ -0,0 +1,48 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      support/test_support.cc
+ * \brief     Helpers shared by the test suites.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ */
+
+#include "test_support.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+std::string openair_test::temporary_database() {
+    char path[] = "/tmp/openair_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        throw "Unable to create a temporary database";
+    }
+    close(fd);
+    return path;
+}
+
+void openair_test::remove_database(const std::string& path) {
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+
+long openair_test::elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
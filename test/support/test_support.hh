@@ -0,0 +1,72 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      support/test_support.hh
+ * \brief     Helpers shared by the test suites.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains the small helpers used by several test suites:
+ * temporary sqlite databases, polling for a condition and timing.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#ifndef TEST_SUPPORT_INCLUDE_GUARD_HH
+#define TEST_SUPPORT_INCLUDE_GUARD_HH 1
+
+namespace openair_test {
+
+    /*!
+     * \brief Creates an empty temporary file for a sqlite database.
+     * \return The path of the file.
+     */
+    std::string temporary_database();
+
+    /*!
+     * \brief Removes a database and its WAL and shared memory files.
+     * \param path - Path of the database.
+     */
+    void remove_database(const std::string& path);
+
+    /*!
+     * \brief Gets the milliseconds elapsed since a time point.
+     * \param start - Start of the measure.
+     * \return Milliseconds elapsed since start.
+     */
+    long elapsed_ms(std::chrono::steady_clock::time_point start);
+
+    /*!
+     * \brief Waits for a condition, polling it every 10 ms.
+     * \param predicate  - Condition to wait for.
+     * \param timeout_ms - Maximum time to wait, in milliseconds.
+     * \return True if the condition became true in time.
+     */
+    template<typename Predicate>
+    bool wait_for(Predicate predicate, int timeout_ms = 5000) {
+        for (int waited = 0; waited < timeout_ms; waited += 10) {
+            if (predicate()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return predicate();
+    }
+}
+#endif
@@ -0,0 +1,215 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      survey_batcher/survey_batcher.cc
+ * \brief     Test the batching uploader of surveys.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the SurveyBatcher flush
+ * thresholds and shutdown.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/survey_batcher.hh"
+#include "../stub/http_stub_server.hh"
+
+namespace {
+    long count_records(const std::string& json) {
+        return std::count(json.begin(), json.end(), '{');
+    }
+}
+
+TEST_GROUP(SurveyBatcher) {
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+    }
+    void teardown() {
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A batcher with a limit of 100 records
+ * WHEN 250 records are added and the batcher is shut down
+ * THEN three JSON arrays of 100, 100 and 50 records are sent.
+ */
+TEST(SurveyBatcher, Test_01) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcherOptions options;
+    options.max_records = 100;
+    openair::SurveyBatcher batcher(connector, "send/data", options);
+    for (int i = 0; i < 250; ++i) {
+        batcher.add("{\"i\":" + std::to_string(i) + "}");
+    }
+    batcher.shutdown();
+    auto requests = server.received();
+    LONGS_EQUAL(3, requests.size());
+    LONGS_EQUAL(100, count_records(requests[0].body));
+    LONGS_EQUAL(100, count_records(requests[1].body));
+    LONGS_EQUAL(50, count_records(requests[2].body));
+    CHECK_EQUAL('[', requests[0].body.front());
+    CHECK_EQUAL(']', requests[0].body.back());
+    CHECK_EQUAL(std::string("/send/data"), requests[0].target);
+    CHECK(requests[2].body.find("{\"i\":249}]") != std::string::npos);
+    UNSIGNED_LONGS_EQUAL(250, batcher.sent_records());
+    UNSIGNED_LONGS_EQUAL(3, batcher.sent_batches());
+}
+
+/**
+ * HAVE A batcher with a limit of 1000 bytes
+ * WHEN records of 100 bytes are added
+ * THEN no batch sent is bigger than 1000 bytes.
+ */
+TEST(SurveyBatcher, Test_02) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcherOptions options;
+    options.max_bytes = 1000;
+    openair::SurveyBatcher batcher(connector, "send/data", options);
+    std::string record = "{\"v\":\"" + std::string(92, 'x') + "\"}";
+    for (int i = 0; i < 50; ++i) {
+        batcher.add(record);
+    }
+    batcher.shutdown();
+    long total = 0;
+    for (const auto& request : server.received()) {
+        CHECK(request.body.size() <= 1000);
+        total += count_records(request.body);
+    }
+    LONGS_EQUAL(50, total);
+}
+
+/**
+ * HAVE A batcher with a max latency of 100 ms
+ * WHEN a single record is added
+ * THEN it is sent without reaching the other thresholds.
+ */
+TEST(SurveyBatcher, Test_03) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcherOptions options;
+    options.max_latency_ms = 100;
+    openair::SurveyBatcher batcher(connector, "send/data", options);
+    batcher.add("{}");
+    for (int i = 0; i < 50 && server.requests() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    LONGS_EQUAL(1, server.requests());
+    UNSIGNED_LONGS_EQUAL(0, batcher.pending());
+}
+
+/**
+ * HAVE A batcher with some pending records
+ * WHEN flush is called
+ * THEN the records are sent before flush returns.
+ */
+TEST(SurveyBatcher, Test_04) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcher batcher(connector, "send/data");
+    batcher.add("{}");
+    batcher.add("{}");
+    batcher.add("{}");
+    UNSIGNED_LONGS_EQUAL(3, batcher.pending());
+    batcher.flush();
+    LONGS_EQUAL(1, server.requests());
+    UNSIGNED_LONGS_EQUAL(0, batcher.pending());
+    CHECK_EQUAL(std::string("[{},{},{}]"), server.received()[0].body);
+}
+
+/**
+ * HAVE A service answering with 500
+ * WHEN a batch is sent
+ * THEN the batch is counted as failed and the error handler receives
+ *      it.
+ */
+TEST(SurveyBatcher, Test_05) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 500;
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcher batcher(connector, "send/data");
+    std::string failed;
+    batcher.on_error([&](const std::string& batch, const char *error) {
+        CHECK(error != NULL);
+        failed = batch;
+    });
+    batcher.add("{}");
+    batcher.flush();
+    UNSIGNED_LONGS_EQUAL(1, batcher.failed_batches());
+    UNSIGNED_LONGS_EQUAL(0, batcher.sent_records());
+    CHECK_EQUAL(std::string("[{}]"), failed);
+}
+
+/**
+ * HAVE A batcher shut down
+ * WHEN a record is added
+ * THEN a const char* is thrown.
+ */
+TEST(SurveyBatcher, Test_06) {
+    openair_test::HttpStubServer server;
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcher batcher(connector, "send/data");
+    batcher.shutdown();
+    bool thrown = false;
+    try {
+        batcher.add("{}");
+    } catch (const char *) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    LONGS_EQUAL(0, server.requests());
+}
+
+/**
+ * HAVE A service answering with a 302 redirect
+ * WHEN a batch is sent
+ * THEN the batch is counted as failed and the error handler receives
+ *      it.
+ */
+TEST(SurveyBatcher, Test_07) {
+    openair_test::HttpStubServer server(
+        [](const openair_test::StubRequest&,
+           openair_test::StubResponse& response) {
+            response.status = 302;
+            response.headers.push_back(
+                std::make_pair("Location", "/moved"));
+        });
+    openair::CurlServiceConnector connector(server.address());
+    openair::SurveyBatcher batcher(connector, "send/data");
+    std::string failed;
+    batcher.on_error([&](const std::string& batch, const char *error) {
+        CHECK(error != NULL);
+        failed = batch;
+    });
+    batcher.add("{}");
+    batcher.flush();
+    UNSIGNED_LONGS_EQUAL(1, batcher.failed_batches());
+    UNSIGNED_LONGS_EQUAL(0, batcher.sent_batches());
+    CHECK_EQUAL(std::string("[{}]"), failed);
+}
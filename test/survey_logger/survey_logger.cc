@@ -0,0 +1,220 @@
+/* libopenair - Library containing openair system's component.
+ * Copyright (C) 2018 Gabriele Labita
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \file      survey_logger/survey_logger.cc
+ * \brief     Test the logger of surveys and errors.
+ * \copyright GNU Public License.
+ * \author    NutriaLUG
+ *
+ * This file contains test suite for the SurveyLogger group commit and
+ * log order.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <CppUTest/MemoryLeakWarningPlugin.h>
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include "../../src/libopenair/survey_logger.hh"
+#include "../../src/sqlite_support.hh"
+#include "../support/test_support.hh"
+
+namespace {
+    std::vector<std::string> column(const std::string& path,
+                                    const char *sql) {
+        openair::SqliteDatabase db(path);
+        openair::SqliteStatement select(db, sql);
+        std::vector<std::string> values;
+        while (select.step()) {
+            values.push_back(select.column_text(0));
+        }
+        return values;
+    }
+}
+
+TEST_GROUP(SurveyLogger) {
+    std::string path;
+    void setup() {
+        MemoryLeakWarningPlugin::turnOffNewDeleteOverloads();
+        path = openair_test::temporary_database();
+    }
+    void teardown() {
+        openair_test::remove_database(path);
+        mock().clear();
+        MemoryLeakWarningPlugin::turnOnNewDeleteOverloads();
+    }
+};
+
+/**
+ * HAVE A logger
+ * WHEN 1000 records are logged and the logger is flushed
+ * THEN they are all in the survey_log table in the log order.
+ */
+TEST(SurveyLogger, Test_01) {
+    openair::SurveyLogger logger(path);
+    for (int i = 0; i < 1000; ++i) {
+        logger.log_survey(std::to_string(i));
+    }
+    logger.flush();
+    UNSIGNED_LONGS_EQUAL(1000, logger.committed());
+    UNSIGNED_LONGS_EQUAL(0, logger.pending());
+    auto records = column(path,
+                          "SELECT record FROM survey_log ORDER BY id");
+    LONGS_EQUAL(1000, records.size());
+    for (int i = 0; i < 1000; ++i) {
+        CHECK_EQUAL(std::to_string(i), records[i]);
+    }
+}
+
+/**
+ * HAVE A logger
+ * WHEN an error is logged and the logger is flushed
+ * THEN the error_log table contains its code and message.
+ */
+TEST(SurveyLogger, Test_02) {
+    openair::SurveyLogger logger(path);
+    logger.log_error(503, "service unavailable");
+    logger.flush();
+    auto errors = column(path,
+                         "SELECT code || ' ' || message FROM error_log");
+    LONGS_EQUAL(1, errors.size());
+    CHECK_EQUAL(std::string("503 service unavailable"), errors[0]);
+    LONGS_EQUAL(0, column(path, "SELECT record FROM survey_log").size());
+}
+
+/**
+ * HAVE A logger with a long commit interval and 100 rows per commit
+ * WHEN 100 records are logged
+ * THEN they are committed without waiting for the interval.
+ */
+TEST(SurveyLogger, Test_03) {
+    openair::SurveyLoggerOptions options;
+    options.commit_rows = 100;
+    options.commit_interval_ms = 60000;
+    openair::SurveyLogger logger(path, options);
+    for (int i = 0; i < 100; ++i) {
+        logger.log_survey("{}");
+    }
+    CHECK(openair_test::wait_for([&]() { return logger.committed() == 100; }));
+}
+
+/**
+ * HAVE A logger with a short commit interval
+ * WHEN one record is logged
+ * THEN it is committed within the interval.
+ */
+TEST(SurveyLogger, Test_04) {
+    openair::SurveyLoggerOptions options;
+    options.commit_interval_ms = 20;
+    openair::SurveyLogger logger(path, options);
+    logger.log_survey("{}");
+    CHECK(openair_test::wait_for([&]() { return logger.committed() == 1; }));
+    UNSIGNED_LONGS_EQUAL(1, logger.transactions());
+}
+
+/**
+ * HAVE A logger with a long commit interval
+ * WHEN 1000 records are logged and the logger is flushed
+ * THEN they are written by a single transaction.
+ */
+TEST(SurveyLogger, Test_05) {
+    openair::SurveyLoggerOptions options;
+    options.commit_interval_ms = 60000;
+    openair::SurveyLogger logger(path, options);
+    for (int i = 0; i < 1000; ++i) {
+        logger.log_survey("{}");
+    }
+    logger.flush();
+    UNSIGNED_LONGS_EQUAL(1000, logger.committed());
+    UNSIGNED_LONGS_EQUAL(1, logger.transactions());
+}
+
+/**
+ * HAVE A logger
+ * WHEN 4 threads log 10000 records each
+ * THEN every record is committed, in the order of its thread.
+ */
+TEST(SurveyLogger, Test_06) {
+    openair::SurveyLoggerOptions options;
+    options.commit_rows = 512;
+    {
+        openair::SurveyLogger logger(path, options);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&logger, t]() {
+                for (int i = 0; i < 10000; ++i) {
+                    logger.log_survey(std::to_string(t * 100000 + i));
+                }
+            });
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+    }
+    auto records = column(path,
+                          "SELECT record FROM survey_log ORDER BY id");
+    LONGS_EQUAL(40000, records.size());
+    std::vector<int> next(4, 0);
+    for (const auto& record : records) {
+        int value = std::atoi(record.c_str());
+        LONGS_EQUAL(next[value / 100000], value % 100000);
+        ++next[value / 100000];
+    }
+}
+
+/**
+ * HAVE A logger committing small transactions
+ * WHEN 4 threads log 10000 records each while pending is polled
+ * THEN pending never exceeds the records logged and ends at zero.
+ */
+TEST(SurveyLogger, Test_07) {
+    openair::SurveyLoggerOptions options;
+    options.commit_rows = 16;
+    options.commit_interval_ms = 1;
+    openair::SurveyLogger logger(path, options);
+    std::atomic<bool> done(false);
+    std::atomic<std::size_t> worst(0);
+    std::thread monitor([&]() {
+        while (!done) {
+            std::size_t pending = logger.pending();
+            if (pending > worst) {
+                worst = pending;
+            }
+        }
+    });
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&logger]() {
+            for (int i = 0; i < 10000; ++i) {
+                logger.log_survey("{}");
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    logger.flush();
+    done = true;
+    monitor.join();
+    CHECK(worst.load() <= 40000);
+    UNSIGNED_LONGS_EQUAL(0, logger.pending());
+}